@@ -1,13 +1,637 @@
 #include "../include/save64.h"
 
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+typedef HANDLE ThreadHandle;
+typedef SOCKET SocketHandle;
+#define THREAD_LOCAL __declspec(thread)
+#define atomicFetchAdd(p, v) InterlockedExchangeAdd((volatile LONG*)(p), (LONG)(v))
+#define atomicCompareSwap64(p, expected, desired) \
+    (uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), (LONG64)(desired), (LONG64)(expected))
+#define atomicLoad32(p) (*(volatile uint32_t*)(p))
+#define atomicStore32(p, v) (*(volatile uint32_t*)(p) = (v))
+#define THREAD_FUNC(name) DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN return 0
+#else
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+typedef pthread_t ThreadHandle;
+typedef int SocketHandle;
+#define THREAD_LOCAL __thread
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#if defined(__APPLE__)
+#define STAT_MTIME_NS(st) ((int64_t)(st).st_mtimespec.tv_sec * 1000000000 + (st).st_mtimespec.tv_nsec)
+#elif defined(__linux__)
+#define STAT_MTIME_NS(st) ((int64_t)(st).st_mtim.tv_sec * 1000000000 + (st).st_mtim.tv_nsec)
+#else
+#define STAT_MTIME_NS(st) ((int64_t)(st).st_mtime * 1000000000)
+#endif
+#define atomicFetchAdd(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define atomicCompareSwap64(p, expected, desired) __sync_val_compare_and_swap((p), (expected), (desired))
+#define atomicLoad32(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atomicStore32(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define THREAD_FUNC(name) void* name(void* arg)
+#define THREAD_RETURN return NULL
+#endif
+
+// Field accessors for the big endian save data compile to plain loads on big endian hosts
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SAVE64_BIG_ENDIAN_HOST 1
+#define be16(x) ((uint16_t)(x))
+#define be32(x) ((uint32_t)(x))
+#else
+#define be16(x) _byteswap_ushort(x)
+#define be32(x) _byteswap_ulong(x)
+#endif
+
+// SIMD kernels: SSE2 is the x86 baseline, AVX2 is picked at runtime where the compiler allows it
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAVE64_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__AVX2__)
+#define SAVE64_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+#define SAVE_MAP_THRESHOLD 0x10000   // files this large are mapped instead of read
+#define SCAN_MAX_THREADS 64
+#define WATCH_MAX_PATHS 64           // directories (and command line paths) --watch follows
+#define CARVE_CHUNK     (1 << 24)    // bytes searched per call, so the hit offsets fit 32 bits
+#define CARVE_MAX_HITS  4096
+#define CARVE_STARTS    3            // places a magic word can have in a save
+#define SERVE_MAX_REQUEST (16u << 20) // largest request frame the daemon accepts
+
+// Stage timers and counters, compiled out with -DSAVE64_STATS=0
+#ifndef SAVE64_STATS
+#define SAVE64_STATS 1
+#endif
+
+#define MAX_SLOT_BLOCKS  16
+#define MAX_EDITS        64
+
+typedef enum { LoadOK, LoadOpenFailed, LoadUnknownGame, LoadTooShort, LoadNoMemory } LoadStatus;
+
+// Location of one checksummed block (save slot, backup or menu data) in an image
+typedef struct {
+    const char*   name;
+    uint32_t      offset;           // start of the block in the image
+    uint16_t      chkOffset;        // checksum position, also the number of bytes summed
+    uint8_t       width;            // 16 = big endian halfword sum, 8 = byte sum
+    uint8_t       backup;           // backup copy of the block before it
+    uint16_t      magicOffset;      // where the block keeps its magic when it holds a save
+    const char*   magic;
+    uint8_t       hasFields;        // the block is a save file the field table applies to
+} SlotLayout;
+
+#define MAX_SELECTED_FIELDS 64
+
+// How a field's value is shown
+typedef enum {
+    FormatDec, FormatSigned, FormatHex, FormatBool, FormatBinary, FormatText, FormatName
+} FieldFormat;
+
+// Named field (or array of fields) of a save slot
+typedef struct {
+    const char*   name;
+    uint16_t      offset;           // from the start of the slot
+    uint8_t       width;            // in bytes, of one element
+    uint8_t       count;            // number of elements, 1 for plain fields
+    Endian        endian;           // byte order in the normalized image
+    FieldFormat   format;
+} SaveField;
+
+#define SAVE_FIELD(type, member, format) \
+    { #member, offsetof(type, member), sizeof(((type*)0)->member), 1, BigE, format }
+#define SAVE_ARRAY(type, member, format) \
+    { #member, offsetof(type, member), sizeof(((type*)0)->member[0]), \
+      sizeof(((type*)0)->member) / sizeof(((type*)0)->member[0]), BigE, format }
+
+typedef enum { OutputHuman, OutputJson, OutputCsv } OutputFormat;
+
+// Growable output buffer, reused between records and written out in one call
+typedef struct {
+    char*         data;
+    size_t        len;
+    size_t        cap;
+    int           fixed;            // caller-owned storage: never grown, output past cap is dropped
+    int           truncated;        // output was dropped
+} OutBuf;
+
+// Result of checking one block of an image
+typedef struct {
+    const SlotLayout* layout;
+    uint16_t      stored;
+    uint16_t      actual;
+    uint8_t       present;          // the block's magic is there, so it holds a save
+} SlotCheck;
+
+// Which copy of a primary/backup pair can be trusted
+typedef enum { PairSynced, PairDiverged, PairPrimary, PairBackup, PairCorrupt, PairEmpty } PairStatus;
+
+// A primary block and its backup copy, compared over the checksummed bytes
+typedef struct {
+    const SlotCheck* primary;
+    const SlotCheck* backup;
+    PairStatus    status;
+    uint32_t      length;           // bytes compared, checksum included
+    uint32_t      firstDiff;        // first differing offset, length when identical
+} SlotPair;
+
+// Save file loaded with a single open, byteswapped to big endian in place
+typedef struct {
+    FileInfo      info;
+    uint8_t*      data;
+    size_t        size;
+    int           mapped;           // data is a private file mapping, not a heap buffer
+    int           borrowed;         // data belongs to an arena or the caller, freeSaveData leaves it
+    int64_t       mtime;            // modification time, in the units of getFileStamp()
+} SaveImage;
+
+// Caller-owned memory that loadSaveFile reads images into instead of the heap.
+// Reset it between files and a batch does no allocations once it is sized.
+typedef struct {
+    uint8_t*      base;
+    size_t        size;
+    size_t        used;
+} SaveArena;
+
+// Everything checked in one image. pairs point into checks, so the report must not be copied.
+typedef struct {
+    int           blockCount;
+    SlotCheck     checks[MAX_SLOT_BLOCKS];
+    int           pairCount;
+    SlotPair      pairs[MAX_SLOT_BLOCKS];
+} SaveReport;
+
+#define MARIO_FILES 4
+
+// One Super Mario 64 save file as the game loads it: the primary copy unless only the backup checks out
+typedef struct {
+    const SlotPair* pair;
+    const uint8_t* data;            // copy in use, NULL when neither holds a valid save
+    int           fromBackup;
+    int           stars;
+    int           coins;            // sum of the course coin scores
+} MarioFile;
+
+// A whole Super Mario 64 EEPROM, decoded in one pass. Like the report it holds, it must not be copied.
+typedef struct {
+    SaveReport    report;
+    MarioFile     files[MARIO_FILES];
+    const SlotPair* menuPair;
+    const uint8_t* menu;            // menu data in use, NULL when neither copy is valid
+    int           menuFromBackup;
+} MarioEeprom;
+
+// Processing stages timed by --stats, and the counters kept next to them
+typedef enum { StageLoad, StageIdentify, StageSwap, StageChecksum, StageRender, StageOutput, StageCount } Stage;
+typedef enum {
+    CounterFiles, CounterBytesRead, CounterSyscalls, CounterSwapBytes, CounterChecksumBytes, CounterOutputBytes,
+    CounterCount
+} Counter;
+
+// Latencies go into log2 buckets split 8 ways, so percentiles are within 12.5%
+#define STATS_BUCKETS 512
+
+typedef struct {
+    uint64_t      calls;
+    uint64_t      totalNs;
+    uint64_t      buckets[STATS_BUCKETS];
+} StageTimer;
+
+// One per thread, merged after the threads are joined
+typedef struct {
+    StageTimer    stages[StageCount];
+    uint64_t      counters[CounterCount];
+} StageStats;
+
+#if SAVE64_STATS
+#define STATS_BEGIN(name) uint64_t name = currentStats ? getTimeNs() : 0
+#define STATS_END(stage, name) do { if (currentStats) statsRecord(stage, name); } while (0)
+#define STATS_COUNT(counter, n) do { if (currentStats) currentStats->counters[counter] += (n); } while (0)
+#else
+#define STATS_BEGIN(name) (void)0
+#define STATS_END(stage, name) (void)0
+#define STATS_COUNT(counter, n) (void)0
+#endif
+
+// Read-only view of a whole file
+typedef struct {
+    const uint8_t* data;
+    size_t        size;
+} MappedFile;
+
+#define CACHE_MAGIC   "S64CACHE"
+#define CACHE_VERSION 1
+
+// Scan cache file: header, entries sorted by path hash, then the path strings.
+// It is written in host byte order and mapped as is.
+typedef struct {
+    char          magic[8];
+    uint32_t      version;
+    uint32_t      count;
+    uint64_t      stringsOffset;
+    uint64_t      stringsSize;
+} CacheHeader;
+
+typedef struct {
+    uint16_t      stored;
+    uint16_t      actual;
+    uint8_t       present;
+    uint8_t       layout;           // index into the game's slot layout table
+    char          name[8];          // decoded player name, empty for blocks without one
+    uint16_t      reserved;
+} CacheBlock;
+
+typedef struct {
+    uint64_t      pathHash;
+    uint64_t      size;
+    int64_t       mtime;
+    uint64_t      contentHash;      // of the normalized image
+    uint32_t      pathOffset;       // into the string table
+    uint16_t      pathLen;
+    uint8_t       status;           // LoadStatus
+    uint8_t       game;
+    uint8_t       endian;
+    uint8_t       blockCount;
+    uint8_t       reserved[6];
+    CacheBlock    blocks[MAX_SLOT_BLOCKS];
+} CacheEntry;
+
+// Entry found or refreshed during this run
+typedef struct {
+    CacheEntry    entry;
+    const char*   path;
+} CacheRecord;
+
+// The previous run's cache, mapped read-only and shared by the workers
+typedef struct {
+    const char*   path;
+    MappedFile    file;
+    const CacheEntry* entries;
+    uint32_t      count;
+    const char*   strings;
+    uint64_t      stringsSize;
+} ScanCache;
+
+#define PACK_MAGIC   "S64PACK"
+#define PACK_VERSION 1
+#define PACK_ALIGN   4096           // payloads start on page boundaries, so members map in place
+
+// Save pack: header, the original files at aligned offsets, a fixed size index, then the
+// member names. All integers are little endian.
+typedef struct {
+    char          magic[8];
+    uint32_t      version;
+    uint32_t      count;
+    uint64_t      indexOffset;
+    uint64_t      namesOffset;
+    uint64_t      namesSize;
+    uint32_t      alignment;
+    uint32_t      reserved;
+} PackHeader;
+
+typedef struct {
+    uint64_t      offset;           // of the payload, a multiple of the header's alignment
+    uint64_t      length;
+    uint64_t      contentHash;      // of the payload as stored
+    uint32_t      nameOffset;       // into the names, which are NUL terminated
+    uint16_t      nameLen;
+    uint8_t       status;           // LoadStatus when the member was packed
+    uint8_t       game;
+    uint8_t       endian;           // byte order of the payload
+    uint8_t       blockCount;
+    uint8_t       failedBlocks;     // present blocks with a checksum mismatch
+    uint8_t       reserved[5];
+} PackEntry;
+
+// A pack mapped read-only, shared by every thread reading its members
+typedef struct {
+    MappedFile    file;
+    const PackEntry* entries;
+    uint32_t      count;
+    const char*   names;
+    PackEntry*    converted;        // host order copy of the index on big endian hosts
+} PackFile;
+
+#define AGG_MAX_COLUMNS  16
+#define AGG_DEFAULT_BINS 16
+#define AGG_MAX_BINS     256
+#define AGG_STAGES       15         // SM64 courses, one byte of star flags each
+
+// One selected field of every save in the corpus. Signed values are stored biased by
+// 0x80000000, so one set of unsigned kernels orders both kinds.
+typedef struct {
+    const char*   name;
+    const SaveField* fields[3];     // the field in each game, NULL where it doesn't exist
+    int           isSigned;
+    int           derived;          // "stars", counted from the SM64 stage flags
+    uint32_t*     values;
+    size_t        count;
+    size_t        cap;
+} Column;
+
+typedef struct {
+    uint64_t      count;
+    uint32_t      min;
+    uint32_t      max;
+    uint64_t      sum;
+    int           binCount;
+    uint32_t      binWidth;
+    uint64_t      bins[AGG_MAX_BINS];
+} ColumnSummary;
+
+// Request frame: u32 length, then kind, format, flags, a reserved byte, u32 length of the
+// field list, the field list and the rest of the frame as a path or a raw image.
+// All integers are little endian.
+typedef enum { RequestPath = 1, RequestImage = 2 } RequestKind;
+
+#define REQUEST_ALL_SLOTS 0x01
+#define REQUEST_HEADER_SIZE 8
+
+// Response frame: u32 length, a ResponseStatus byte, then the rendered record or the error
+typedef enum { ResponseOK, ResponseLoadError, ResponseBadRequest } ResponseStatus;
+
+// Thread of the daemon: serves one connection at a time and keeps its buffers between requests
+typedef struct {
+    ThreadHandle  thread;
+    SocketHandle  listener;
+    uint8_t*      request;          // receive buffer, grown to the largest request seen
+    size_t        requestCap;
+    OutBuf        out;              // response frame
+    SaveArena     arena;            // the image of the current path request, unless it is mapped
+} ServeWorker;
+
+// Shared table of block checksums keyed by the block's hash, so each distinct block is summed
+// once per scan. Slots are claimed with a compare-and-swap and never removed.
+#define DEDUP_READY 0x10000         // set in result once the checksum is stored
+#define DEDUP_MAX_PROBES 64
+
+typedef struct {
+    uint64_t      key;              // block hash, 0 while the slot is free
+    uint32_t      result;           // DEDUP_READY | checksum
+    uint32_t      reserved;
+} DedupSlot;
+
+typedef struct {
+    DedupSlot*    slots;
+    size_t        mask;             // slot count - 1, a power of two
+} DedupTable;
+
+// One block seen by a scan worker, for the duplicate group report
+typedef struct {
+    uint64_t      hash;
+    uint32_t      file;             // index into the queue
+    uint16_t      length;           // bytes hashed, the checksummed part of the block
+    uint8_t       layout;           // index into the game's slot layout table
+    uint8_t       game;
+} DedupRef;
+
+#define NAMES_MAGIC   "S64NAMES"
+#define NAMES_VERSION 1
+
+// Name index file: header, entries sorted by folded name, then the path strings.
+// Like the scan cache it is written in host byte order and mapped as is.
+typedef struct {
+    char          magic[8];
+    uint32_t      version;
+    uint32_t      count;
+    uint64_t      stringsOffset;
+    uint64_t      stringsSize;
+} NameHeader;
+
+typedef struct {
+    char          key[8];           // the name in upper case, NUL padded, which the entries are sorted by
+    char          name[8];          // as decoded, NUL padded
+    uint32_t      pathOffset;       // into the string table, shared by the entries of one file
+    uint16_t      pathLen;
+    uint8_t       game;
+    uint8_t       layout;           // index into the game's slot layout table
+    uint8_t       valid;            // the block's checksum matched when it was indexed
+    uint8_t       reserved[7];
+} NameEntry;
+
+// Player name seen by a scan worker, for the name index
+typedef struct {
+    char          key[8];
+    char          name[8];
+    uint32_t      file;             // index into the queue
+    uint8_t       layout;
+    uint8_t       game;
+    uint8_t       valid;
+} NameRef;
+
+// Consistency rule of a game's save: a field compared with a constant, or with a multiple of
+// another field. Rules sharing a name are reported as one.
+typedef enum { RuleAtMost, RuleAtLeast, RuleBits } RuleKind;
+
+typedef struct {
+    const char*   name;
+    const char*   field;
+    RuleKind      kind;
+    const char*   other;            // field the limit is a multiple of, NULL for a constant limit
+    int32_t       scale;
+    int64_t       limit;            // constant, added to scale * other
+    uint32_t      mask;             // bits of the field compared, 0 for all; the bits allowed for RuleBits
+} SaveRule;
+
+#define RULE_MAX_RULES 64           // one bit per rule name in a slot's result
+#define RULE_MAX_STEPS 128
+
+// Field operand of a step: big endian word at offset, shifted, masked and sign extended
+typedef struct {
+    uint16_t      offset;
+    uint8_t       shift;
+    uint8_t       reserved;
+    uint32_t      mask;
+    uint32_t      sign;             // sign bit of signed fields, 0 otherwise
+} RuleOperand;
+
+// One comparison of a compiled rule set. A slot breaks the rule when
+// factor * a + otherFactor * b + bias > 0, so every kind runs the same code.
+typedef struct {
+    RuleOperand   a;
+    RuleOperand   b;                // a's operand again with otherFactor 0 when there is no other field
+    int32_t       factor;
+    int32_t       otherFactor;
+    int64_t       bias;
+    uint32_t      rule;             // bit of the rule name
+    uint32_t      reserved;
+} RuleStep;
+
+// Rule set of one game compiled to a flat list of steps, with what reporting needs kept apart
+typedef struct {
+    RuleStep      steps[RULE_MAX_STEPS];
+    const SaveRule* sources[RULE_MAX_STEPS];
+    const SaveField* fields[RULE_MAX_STEPS][2];
+    int           stepCount;
+    const char*   names[RULE_MAX_RULES];
+    int           ruleCount;
+    uint32_t      blockSize;        // bytes of a save slot that can be read
+} RuleProgram;
+
+// Controller Pak: 128 pages of 256 bytes. Page 0 holds the ID area, pages 1 and 2 the inode
+// table and its backup, pages 3 and 4 the note table; the notes' data fills the rest.
+#define MPK_SIZE        0x8000
+#define MPK_PAGE_SIZE   0x100
+#define MPK_PAGES       128
+#define MPK_FIRST_PAGE  5
+#define MPK_INDEX_SIZE  (MPK_FIRST_PAGE * MPK_PAGE_SIZE)
+#define MPK_NOTES       16
+#define MPK_CHAIN_END   0x01          // inode value ending a note's chain of pages
+#define MPK_FREE_PAGE   0x03
+
+// One note (a game's save) of a Controller Pak, as listed in the note table
+typedef struct {
+    char          gameCode[5];      // NUL terminated, '?' for unprintable bytes
+    char          publisher[3];
+    char          name[22];         // decoded name, then '.' and the extension if there is one
+    uint8_t       entry;            // position in the note table
+    uint8_t       startPage;
+    uint8_t       pages;            // length of its chain of pages
+    uint8_t       chainOK;          // the chain ends without leaving the data pages or looping
+} MpkNote;
+
+// What listing a pak needs, decoded from its first MPK_INDEX_SIZE bytes only.
+// The note data isn't read until a note is asked for.
+typedef struct {
+    int           idBlocks;         // copies of the ID block with a valid checksum, out of 4
+    int           inodeCopy;        // inode table in use: 1 primary, 2 backup, 0 if both are corrupt
+    int           freePages;
+    int           noteCount;
+    uint8_t       next[MPK_PAGES];  // next page of each page's chain, 0 for entries outside the pak
+    MpkNote       notes[MPK_NOTES];
+} MpkIndex;
+
+// File followed by --watch, with its image as of the last event
+typedef struct {
+    char*         path;
+    uint8_t*      previous;         // normalized image, NULL before the first event
+    size_t        size;
+    Game          game;
+} WatchedFile;
+
+// Directory holding watched files. Writers that replace a file by renaming a new one over it
+// leave a watch on the file itself behind, so the directories are watched instead.
+typedef struct {
+    int           wd;
+    char*         path;
+    int           all;              // follow every save file in it, not just the named ones
+} WatchedDir;
+
+// Queue of files for the batch scanner, filled by the directory walk
+typedef struct {
+    char**        paths;
+    size_t        count;
+    size_t        capacity;
+    volatile long next;             // index of the next unclaimed path
+    OutputFormat  format;
+    const SaveField* fields[3][MAX_SELECTED_FIELDS];   // fields to print per game, NULL if missing
+    int           fieldCount[3];
+    ScanCache*    cache;            // NULL unless --cache was given
+    int           useCache;         // answer unchanged files from the cache
+    int           allSlots;         // cross-validate primary/backup pairs
+    PackFile      pack;             // the paths are its member names when a pack was given
+    DedupTable*   dedup;            // NULL unless --dedup was given
+    int           names;            // collect player names for --names
+    int           paks;             // the walk collects Controller Paks (.mpk) instead of saves
+} ScanQueue;
+
+// Per-thread state for the batch scanner
+typedef struct {
+    ScanQueue*    queue;
+    ThreadHandle  thread;
+    size_t        files;            // files successfully identified and read
+    size_t        errors;           // files that couldn't be identified or read
+    size_t        slots;            // non-empty slots checked
+    size_t        failed;           // slots with a checksum mismatch
+    size_t        cached;           // files answered from the cache
+    OutBuf        out;              // records of the current file
+    SaveArena     arena;            // the image of the current file, unless it is mapped
+    CacheRecord*  added;            // files read by this worker, for the next cache
+    size_t        addedCount;
+    size_t        addedCapacity;
+    StageStats*   stats;            // NULL unless --stats was given
+    DedupRef*     refs;             // blocks hashed by this worker, with --dedup
+    size_t        refCount;
+    size_t        refCapacity;
+    size_t        reused;           // block checksums taken from the dedup table
+    NameRef*      names;            // player names seen by this worker, with --names
+    size_t        nameCount;
+    size_t        nameCapacity;
+} ScanWorker;
+
+// Library functions: reentrant, and allocation free when given an arena
+void arenaInit(SaveArena* arena, void* memory, size_t size);
+void* arenaAlloc(SaveArena* arena, size_t size);
+void arenaReset(SaveArena* arena);
+LoadStatus loadSaveFile(const char* path, SaveArena* arena, SaveImage* image);
+LoadStatus parseSaveData(uint8_t* data, size_t size, const char* name, SaveImage* image);
+int checkSaveData(const SaveImage* image, int withPairs, SaveReport* report);
+int checkSaveDataDedup(const SaveImage* image, int withPairs, DedupTable* table, uint64_t* hashes, int* reused,
+                       SaveReport* report);
+void outInit(OutBuf* out, char* memory, size_t cap);
+
 // File handling functions
-FileInfo* getFileInfo(FilePath savefile);
-void* readSaveData(FilePath file_name, size_t file_size, Endian endian);
+int getFileInfo(FileInfo* file, const uint8_t* data, size_t size);
+LoadStatus readSaveData(FilePath file_name, SaveImage* image);
+LoadStatus prepareSaveData(SaveImage* image);
+int writeSaveData(SaveImage* image);
+void freeSaveData(SaveImage* image);
+int writeFileAtomic(const char* path, const void* data, size_t size);
+int getFileStamp(const char* path, uint64_t* size, int64_t* mtime);
+int mapFile(const char* path, MappedFile* file);
+void unmapFile(MappedFile* file);
+uint64_t hashBytes64(const void* data, size_t len, uint64_t seed);
+uint64_t hashBlock64(const uint8_t* data, size_t len, uint64_t seed);
+const char* getLoadError(LoadStatus status);
 
 // Binary functions
+char decodeNameChar(unsigned char c, Region charset);
+size_t decodeName(const uint8_t* raw, size_t len, Region charset, char* text);
+int encodeName(const char* text, Region charset, uint8_t* raw, size_t len);
 void decodePlayerName(char* name, Region charset, FILE* fp);
+void swapWords32(uint8_t* data, size_t size);
 uint16_t getChecksum16(uint8_t* buffer, uint16_t cs_offset, int width);
 int countSetBits(uint8_t b);
+uint16_t checksumBytes(const uint8_t* data, size_t len);
+uint16_t checksumWords16(const uint8_t* data, size_t len);
+size_t getSaveSize(Game game);
+size_t getMediaSize(Game game);
+size_t getSlotOffset(Game game, int slot);
+const char* getGameName(Game game);
+uint16_t verifySlot(uint8_t* buffer, const FileInfo* file, int slot, uint16_t* stored);
+const SlotLayout* getSlotLayout(Game game, int* count);
+int verifyImage(const uint8_t* data, size_t size, Game game, SlotCheck* results);
+void checkBlock(const uint8_t* block, const SlotLayout* slot, SlotCheck* result);
+size_t compareBlocks(const uint8_t* a, const uint8_t* b, size_t len);
+size_t findMagic(const uint8_t* data, size_t len, uint32_t* hits, size_t capacity, size_t* end);
+int verifyImageDedup(const uint8_t* data, size_t size, Game game, SlotCheck* results, DedupTable* table,
+                     uint64_t* hashes, int* reused);
+int pairSlots(const uint8_t* data, const SlotCheck* checks, int count, SlotPair* pairs);
+const char* getPairStatus(PairStatus status);
 
 // Print functions
 void printHeader(const ootHeader* header);
@@ -18,100 +642,508 @@ void printSave_oot(ootSave* savedata, FileInfo* file, int slot);
 void printSave_maj(majSave* savedata);
 void printSave_mario(marioSave* savedata);
 
+// Super Mario 64 functions
+int decodeMarioEeprom(const SaveImage* image, MarioEeprom* eeprom);
+int countMarioStars(const uint8_t* block);
+int sumMarioCoins(const uint8_t* block);
+void printMarioEeprom(const MarioEeprom* eeprom);
+void printMarioMenu(const uint8_t* block);
+
+// Field schema functions
+const SaveField* getFieldTable(Game game, size_t* count);
+const SaveField* findField(Game game, const char* name);
+int selectFields(Game game, const char* list, const SaveField** selected, int max, int strict);
+const char* getListedField(const char* list, int index, int* len);
+uint32_t readField(const uint8_t* data, int width, Endian endian);
+int modifyField(SaveImage* image, int slot, const char* assignment);
+
+// Output functions
+int parseOutputFormat(const char* name, OutputFormat* format);
+void outPut(OutBuf* out, const char* data, size_t len);
+void outPuts(OutBuf* out, const char* str);
+void outPutc(OutBuf* out, char c);
+void outPutUint(OutBuf* out, uint32_t value);
+void outPutHex(OutBuf* out, uint32_t value, int digits);
+void outPrintf(OutBuf* out, const char* format, ...);
+void outFlush(OutBuf* out, FILE* fp);
+void outFree(OutBuf* out);
+void putField(OutBuf* out, OutputFormat format, const SaveField* field, const uint8_t* block, Region charset);
+void renderCsvHeader(OutBuf* out, const char* const* names, int count);
+void renderError(OutBuf* out, OutputFormat format, const char* path, const char* error, int fieldCount);
+void renderRecord(OutBuf* out, OutputFormat format, const SaveImage* image, const SlotCheck* checks, int count,
+                  const SaveField* const* fields, int fieldCount, const SlotPair* pairs, int pairCount);
+
+// Batch scan functions
+int runScan(int argc, char* argv[]);
+THREAD_FUNC(scanThread);
+int collectSaveFiles(const char* root, ScanQueue* queue);
+LoadStatus loadQueuedSave(const ScanQueue* queue, size_t index, SaveArena* arena, SaveImage* image);
+void releaseQueue(ScanQueue* queue);
+void scanFile(size_t index, ScanWorker* worker);
+int getCpuCount(void);
+double getTimeSeconds(void);
+
+// Instrumentation functions
+uint64_t getTimeNs(void);
+void statsRecord(Stage stage, uint64_t start);
+void statsMerge(StageStats* into, const StageStats* from);
+void printStats(const StageStats* stats, double elapsed, int threads, FILE* fp);
+
+// Daemon functions
+int runServe(int argc, char* argv[]);
+THREAD_FUNC(serveThread);
+void serveRequest(ServeWorker* worker, uint8_t* request, size_t len);
+
+// Aggregate functions
+int runAggregate(int argc, char* argv[]);
+void columnMinMaxSum(const uint32_t* values, size_t count, uint32_t* min, uint32_t* max, uint64_t* sum);
+void columnHistogram(const uint32_t* values, size_t count, uint32_t min, uint32_t width, int binCount, uint64_t* bins);
+void countStarRows(const uint8_t* rows, size_t count, uint32_t* stars);
+void benchColumns(long iterations);
+
+// Rule functions
+const SaveRule* getRuleTable(Game game, size_t* count);
+int compileRules(Game game, const char* selection, RuleProgram* program);
+uint64_t evaluateRules(const RuleProgram* program, const uint8_t* block);
+int runLint(int argc, char* argv[]);
+THREAD_FUNC(lintThread);
+
+// Scan cache functions
+int openScanCache(const char* path, ScanCache* cache);
+const CacheEntry* findCacheEntry(const ScanCache* cache, const char* path, uint64_t pathHash);
+void fillCacheEntry(CacheEntry* entry, const SaveImage* image, LoadStatus status, const SlotCheck* checks, int count);
+int saveScanCache(ScanCache* cache, ScanWorker* workers, int jobs);
+void closeScanCache(ScanCache* cache);
+
+// Dedup functions
+int initDedupTable(DedupTable* table, size_t blocks);
+void freeDedupTable(DedupTable* table);
+int writeDedupReport(const char* path, OutputFormat format, const ScanQueue* queue, ScanWorker* workers, int jobs,
+                     size_t* unique, size_t* groups);
+
+// Name index functions
+int writeNameIndex(const char* path, const ScanQueue* queue, ScanWorker* workers, int jobs, size_t* count);
+int runFindName(int argc, char* argv[]);
+
+// Watch functions
+int runWatch(int argc, char* argv[]);
+
+// Convert functions
+int runConvert(int argc, char* argv[]);
+THREAD_FUNC(convertThread);
+
+// Carve functions
+int runCarve(int argc, char* argv[]);
+
+// Controller Pak functions
+int parseMpkIndex(const uint8_t* data, MpkIndex* index);
+LoadStatus readMpkIndex(const char* path, MpkIndex* index);
+size_t loadMpkNote(const char* path, const MpkIndex* index, int note, uint8_t* payload);
+int runMpk(int argc, char* argv[]);
+THREAD_FUNC(mpkThread);
+
+// Diff functions
+int runDiff(int argc, char* argv[]);
+size_t diffImages(OutBuf* out, OutputFormat format, const SaveImage* a, const SaveImage* b, size_t* bytes);
+
+// Pack functions
+int runPack(int argc, char* argv[]);
+int runUnpack(int argc, char* argv[]);
+int isPackFile(const char* path);
+int openPack(const char* path, PackFile* pack);
+LoadStatus loadPackMember(const PackFile* pack, size_t index, SaveArena* arena, SaveImage* image);
+void closePack(PackFile* pack);
+
+// Benchmark functions
+int runBench(int argc, char* argv[]);
+int runGen(int argc, char* argv[]);
+size_t buildSyntheticImage(uint8_t* data, Game game, uint64_t seed);
+
+// statistics of the calling thread, NULL when --stats is off
+static THREAD_LOCAL StageStats* currentStats;
+
+#ifndef SAVE64_LIBRARY
+// --stats of the viewer, printed at exit
+static StageStats* viewerStats;
+static double viewerStart;
+
+static void
+printViewerStats(void)
+{
+    printStats(viewerStats, getTimeSeconds() - viewerStart, 1, stderr);
+    free(viewerStats);
+}
+
 int main(int argc, char* argv[])
 {
     const FilePath program_name = argv[0];
     const char* description = "Nintendo 64 Save Viewer/Editor";
     uint8_t slot = 0;
+    uint16_t checksum = 0x0000;              // byteswapped checksum from savedata
+    uint16_t actualChk = 0x0000;             // the calculated checksum for comparison
+
+    // Batch mode: validate every save under a directory (or listed in a file)
+    if (argc >= 2 && strcmp(argv[1], "--scan") == 0) {
+        return runScan(argc, argv);
+    }
+
+    // Statistics of selected fields over every save of a corpus
+    if (argc >= 2 && strcmp(argv[1], "--aggregate") == 0) {
+        return runAggregate(argc, argv);
+    }
+
+    // Stream of the blocks an emulator rewrites, as it writes them
+    if (argc >= 2 && strcmp(argv[1], "--watch") == 0) {
+        return runWatch(argc, argv);
+    }
+
+    // Field level changes between two snapshots of a save
+    if (argc >= 2 && strcmp(argv[1], "--diff") == 0) {
+        return runDiff(argc, argv);
+    }
+
+    // Byte order migration of a whole library
+    if (argc >= 2 && strcmp(argv[1], "--convert") == 0) {
+        return runConvert(argc, argv);
+    }
+
+    // Saves embedded at any offset of a raw dump or disk image
+    if (argc >= 2 && strcmp(argv[1], "--carve") == 0) {
+        return runCarve(argc, argv);
+    }
+
+    // Saves whose checksums hold but whose contents the game can't have written
+    if (argc >= 2 && strcmp(argv[1], "--lint") == 0) {
+        return runLint(argc, argv);
+    }
+
+    // Notes of Controller Pak dumps, and the saves they hold
+    if (argc >= 2 && strcmp(argv[1], "--mpk") == 0) {
+        return runMpk(argc, argv);
+    }
+
+    // Single file archive of a corpus, read in place by the batch modes
+    if (argc >= 2 && strcmp(argv[1], "--pack") == 0) {
+        return runPack(argc, argv);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--unpack") == 0) {
+        return runUnpack(argc, argv);
+    }
+
+    // Saves of a player, looked up in the index written by --scan --names
+    if (argc >= 2 && strcmp(argv[1], "--find-name") == 0) {
+        return runFindName(argc, argv);
+    }
+
+    // Daemon answering decode requests over a local socket
+    if (argc >= 2 && strcmp(argv[1], "--serve") == 0) {
+        return runServe(argc, argv);
+    }
+
+    // Microbenchmarks of the individual processing stages
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        return runBench(argc, argv);
+    }
+
+    // Reproducible synthetic corpus for the benchmarks
+    if (argc >= 2 && strcmp(argv[1], "--gen") == 0) {
+        return runGen(argc, argv);
+    }
 
     // Validate user input
-    if (argc > 2 && argc < 4) {
-        slot = (uint8_t)(atoi(argv[2]) - 1);
-        if (slot > 2) {
-            fprintf(stderr, "Invalid save slot number. It should be between 1 and 3.\n");
+    const char* path = NULL;
+    const char* slotArg = NULL;
+    const char* edits[MAX_EDITS];
+    int editCount = 0;
+    const char* fieldList = NULL;
+    OutputFormat format = OutputHuman;
+    int allSlots = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--fields") == 0 && i + 1 < argc) {
+            fieldList = argv[++i];
+        } else if (strcmp(argv[i], "--all-slots") == 0) {
+            allSlots = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            // reported at exit, whichever way the viewer leaves
+            viewerStats = calloc(1, sizeof(StageStats));
+            if (viewerStats && atexit(printViewerStats) == 0) {
+                currentStats = viewerStats;
+                viewerStart = getTimeSeconds();
+            }
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (parseOutputFormat(argv[++i], &format) != 0) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc) {
+            if (editCount == MAX_EDITS) {
+                fprintf(stderr, "Too many edits provided.\n");
+                return 1;
+            }
+            edits[editCount++] = argv[++i];
+        } else if (!path) {
+            path = argv[i];
+        } else if (!slotArg) {
+            slotArg = argv[i];
+        } else {
+            fprintf(stderr, "Too many arguments provided.\n");
             return 1;
         }
-    } else if (argc >= 4) {
-        fprintf(stderr, "Too many arguments provided.\n");
-        return 1;
-    } else if (argc == 2) {
-        slot = 0;
-    } else {
+    }
+
+    if (slotArg) {
+        slot = (uint8_t)(atoi(slotArg) - 1);
+        if (slot > MARIO_FILES - 1) {
+            fprintf(stderr, "Invalid save slot number. It should be between 1 and 3, or 4 for Super Mario 64.\n");
+            return 1;
+        }
+    } else if (!path) {
         PlaySound(L"(D:/Programs/C/n64/zelda/gui/sound/OOT_Error.wav)", NULL, SND_FILENAME | SND_ASYNC );
         fprintf(stderr, "Usage: %s path/to/save/file -n\n", program_name);
+        fprintf(stderr, "       %s path/to/save/file -n [--fields field,field...] [--format human|json|csv] [--stats]\n", program_name);
+        fprintf(stderr, "       %s path/to/save/file --all-slots [--format human|json|csv] [--stats]\n", program_name);
+        fprintf(stderr, "       %s path/to/save/file -n --set field=value [--set field=value ...]\n", program_name);
+        fprintf(stderr, "       %s --scan <dir|list> [--jobs N] [--fields field,field...] [--format human|json|csv]"
+                        " [--cache file] [--dedup report] [--names index] [--all-slots] [--stats]\n", program_name);
+        fprintf(stderr, "       %s --find-name <index> <name> [--prefix] [--format human|json|csv]\n", program_name);
+        fprintf(stderr, "       %s --aggregate <dir|list> --fields field,field... [--jobs N] [--bins N]"
+                        " [--format human|json|csv]\n", program_name);
+        fprintf(stderr, "       %s --diff <old> <new> [--format human|json|csv]\n", program_name);
+        fprintf(stderr, "       %s --watch <file|dir>... [--fields field,field...]\n", program_name);
+        fprintf(stderr, "       %s --convert <dir|list|pack> <dir> --to big|little [--jobs N]\n", program_name);
+        fprintf(stderr, "       %s --carve <dump> [dir] [--format human|json|csv]\n", program_name);
+        fprintf(stderr, "       %s --lint <dir|list|pack> [--rules rule,rule...] [--jobs N] [--format human|json|csv]\n",
+                program_name);
+        fprintf(stderr, "       %s --mpk <pak|dir|list> [--note N [--extract file]] [--jobs N] [--format human|json|csv]\n",
+                program_name);
+        fprintf(stderr, "       %s --pack <pack> <dir|list>\n", program_name);
+        fprintf(stderr, "       %s --unpack <pack> <dir>\n", program_name);
+        fprintf(stderr, "       %s --serve <socket> [--jobs N]\n", program_name);
+        fprintf(stderr, "       %s --bench swap|checksum|compare|hash|carve|columns|output [--iterations N]\n",
+                program_name);
+        fprintf(stderr, "       %s --bench corpus --corpus <dir|list> [--iterations N]\n", program_name);
+        fprintf(stderr, "       %s --gen <dir> [--count N] [--seed N]\n", program_name);
         Sleep(561);
         return 1;
     }
 
-    // Get basic input file info
-    FileInfo* file = getFileInfo((FilePath)argv[1]);
-    if (!file) {
-       fprintf(stderr, "Error: Couldn't determine the game type.\n");
+    // Load the save file and get basic file info from the image
+    SaveImage image;
+    LoadStatus status = readSaveData((FilePath)path, &image);
+    if (status != LoadOK) {
+       fprintf(stderr, "Error: %s.\n", getLoadError(status));
        return 1;
     }
+    FileInfo* file = &image.info;
+    if (slot > 2 && file->game == Ocarina) {
+        fprintf(stderr, "Invalid save slot number. %s only has slots 1 to 3.\n", file->title);
+        freeSaveData(&image);
+        return 1;
+    }
+    if (slot > 1 && file->game == Majora) {
+        fprintf(stderr, "Invalid save slot number. %s only has slots 1 and 2.\n", file->title);
+        freeSaveData(&image);
+        return 1;
+    }
+
+    ootHeader*  header     = NULL;           // pointer to Ocarina of Time header
+    ootSave*    ootSav     = NULL;           // pointer to Ocarina of Time save data   
+    majSave*    majSav     = NULL;           // pointer to Majora's Mask save data
+    marioSave*  marioSav   = NULL;			 // pointer to Super Mario 64 save data
+    const char* sound   = L"D:/Programs/C/n64/zelda/sound/OOT_Secret.wav";
+
+    // Machine readable record of every block, with the requested (or all) fields
+    if (format != OutputHuman && editCount == 0) {
+        const SaveField* fields[MAX_SELECTED_FIELDS];
+        SlotCheck checks[MAX_SLOT_BLOCKS];
+        OutBuf out = { 0 };
+        size_t tableSize = 0;
+        const SaveField* table = getFieldTable(file->game, &tableSize);
+        int count = 0;
+
+        if (fieldList) {
+            count = selectFields(file->game, fieldList, fields, MAX_SELECTED_FIELDS, 1);
+        } else {
+            for (size_t i = 0; i < tableSize && i < MAX_SELECTED_FIELDS; i++) {
+                fields[count++] = &table[i];
+            }
+        }
+        if (count < 0) {
+            freeSaveData(&image);
+            return 1;
+        }
+        if (format == OutputCsv) {
+            const char* names[MAX_SELECTED_FIELDS];
+            for (int i = 0; i < count; i++) {
+                names[i] = fields[i]->name;
+            }
+            renderCsvHeader(&out, names, count);
+        }
+        SlotPair pairs[MAX_SLOT_BLOCKS];
+        int blocks = verifyImage(image.data, image.size, file->game, checks);
+        int pairCount = allSlots ? pairSlots(image.data, checks, blocks, pairs) : 0;
+
+        renderRecord(&out, format, &image, checks, blocks, fields, count, pairs, pairCount);
+        outFlush(&out, stdout);
+        outFree(&out);
+        freeSaveData(&image);
+        return 0;
+    }
+
+    // Patch the requested fields and write the file back, keeping its checksum valid.
+    // This comes before the field display so that --fields can't swallow an edit.
+    if (editCount > 0) {
+        for (int i = 0; i < editCount; i++) {
+            if (modifyField(&image, slot, edits[i]) != 0) {
+                freeSaveData(&image);
+                return 1;
+            }
+        }
+        int written = writeSaveData(&image);
+        if (written == 0) {
+            actualChk = verifySlot(image.data, file, slot, &checksum);
+            printf("Checksum ( %04x ?= %04x ):      %s\n", checksum, actualChk,
+                   checksum == actualChk ? "OK" : "FAIL");
+        }
+        freeSaveData(&image);
+        return written == 0 ? 0 : 1;
+    }
+
+    // Decode only the requested fields of the slot
+    if (fieldList) {
+        const SaveField* fields[MAX_SELECTED_FIELDS];
+        int count = selectFields(file->game, fieldList, fields, MAX_SELECTED_FIELDS, 1);
+        OutBuf out = { 0 };
+
+        if (count < 0) {
+            freeSaveData(&image);
+            return 1;
+        }
+        for (int i = 0; i < count; i++) {
+            outPrintf(&out, "%-31s ", fields[i]->name);
+            putField(&out, OutputHuman, fields[i], image.data + getSlotOffset(file->game, slot), file->charset);
+            outPutc(&out, '\n');
+        }
+        outFlush(&out, stdout);
+        outFree(&out);
+        freeSaveData(&image);
+        return 0;
+    }
+
+    // Every block of the image from the one read, then which copy of each pair is usable
+    if (allSlots) {
+        SlotCheck checks[MAX_SLOT_BLOCKS];
+        SlotPair pairs[MAX_SLOT_BLOCKS];
+        int count = verifyImage(image.data, image.size, file->game, checks);
+        int pairCount = pairSlots(image.data, checks, count, pairs);
+        int usable = 1;
+
+        setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+        enableAnsiEscapeCodes();
+        printWelcome(description, file->title);
+        if (file->game == Ocarina) {
+            header = (ootHeader*)image.data;
+            printHeader(header);
+        }
+
+        for (int i = 0; i < count; i++) {
+            const SlotCheck* check = &checks[i];
+            uint8_t* block = image.data + check->layout->offset;
+
+            printf("\n" ANSI_BG_CYAN ANSI_COLOR_BLACK "  Block %-6s  " ANSI_COLOR_RESET "\n", check->layout->name);
+            if (!check->present) {
+                printf("Empty\n");
+                continue;
+            }
+            if (check->layout->hasFields && file->game == Ocarina) {
+                printSave_oot((ootSave*)block, file, i % 3);
+            } else if (check->layout->hasFields && file->game == Majora) {
+                printSave_maj((majSave*)block);
+            } else if (check->layout->hasFields && file->game == Mario) {
+                printSave_mario((marioSave*)block);
+            } else if (file->game == Mario) {
+                printMarioMenu(block);
+            }
+            printf("Checksum ( %04x ?= %04x ):      %s\n", check->stored, check->actual,
+                   check->stored == check->actual ? ANSI_BG_GREEN ANSI_COLOR_WHITE " OK \t" ANSI_COLOR_RESET
+                                                  : ANSI_BG_RED ANSI_COLOR_WHITE "FAIL\t" ANSI_COLOR_RESET);
+        }
+
+        printf("\n" ANSI_BG_CYAN ANSI_COLOR_BLACK "   Backups   " ANSI_COLOR_RESET "\n");
+        for (int i = 0; i < pairCount; i++) {
+            const SlotPair* pair = &pairs[i];
+            printf("%-6s / %-7s %-9s", pair->primary->layout->name, pair->backup->layout->name,
+                   getPairStatus(pair->status));
+            if (pair->firstDiff < pair->length) {
+                printf(" first difference at 0x%04x", pair->firstDiff);
+            }
+            putc('\n', stdout);
+            usable &= pair->status != PairCorrupt;
+        }
+
+        STATS_BEGIN(outputStart);
+        fflush(stdout);
+        STATS_END(StageOutput, outputStart);
+        PlaySound(usable ? sound : L"D:/Programs/C/n64/zelda/gui/sound/OOT_Error.wav", NULL, SND_FILENAME | SND_ASYNC );
+        freeSaveData(&image);
+        return usable ? 0 : 1;
+    }
 
    // // if (slot > 2 && file->game == Ocarina) {
    // //     fprintf(stderr, "Error: Ocarina of time does not contain a 4th save slot. Enter 1 or 2.\n");
    // //     return 1;
    // // }
 
-    // Print program title banner
+    // Print program title banner. The whole report goes out in one write when stdout is flushed.
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
     enableAnsiEscapeCodes();
+    STATS_BEGIN(renderStart);
     printWelcome(description, file->title);
 
-    ootHeader*  header     = NULL;           // pointer to Ocarina of Time header
-    ootSave*    ootSav     = NULL;           // pointer to Ocarina of Time save data   
-    majSave*    majSav     = NULL;           // pointer to Majora's Mask save data
-    marioSave*  marioSav   = NULL;			 // pointer to Super Mario 64 save data
-    uint16_t*   chkPtr     = NULL;           // pointer to checksum value in save data
-    uint16_t    checksum   = 0x0000;         // byteswapped checksum from savedata
-    uint16_t    actualChk  = 0x0000;         // the calculated checksum for comparison
-    const char* sound   = L"D:/Programs/C/n64/zelda/sound/OOT_Secret.wav";
-
     switch (file->game) {
 
         case Ocarina: // reads the header first (32 bytes), and then blocks of save data (0x1450 bytes)
-            header = (ootHeader*)readSaveData(file->path, SRA_HEADER_SIZE + (SRA_BLOCK_SIZE * 3), file->endian);
+            header = (ootHeader*)image.data;
             ootSav = (ootSave*)((char*)header + sizeof(ootHeader));
-            if (header->language != 0x0) {
-                file->charset = PAL;
-            }
             // print header and save file data
             printHeader(header);
             printSave_oot((ootSave*)((char*)ootSav + (slot * SRA_BLOCK_SIZE)), file, slot);
 
             // get the checksum from the save data, and then calculate the actual checksum
-            chkPtr = (uint16_t*)((char*)&ootSav->checksum + (slot * SRA_BLOCK_SIZE));
-            actualChk = getChecksum16((char*)ootSav + (slot * SRA_BLOCK_SIZE), file->chkOffset, 16);
+            actualChk = verifySlot((uint8_t*)header, file, slot, &checksum);
             break;
 
         case Majora: // no header, just start reading blocks of save data (0x2000 bytes)
-            majSav = (majSave*)readSaveData(file->path, (FLA_BLOCK_SIZE * 5), file->endian);
+            majSav = (majSave*)image.data;
 
             // print save file data
-            printSave_maj((majSave*)((char*)majSav + (slot * FLA_BLOCK_SIZE)));
+            printSave_maj((majSave*)((char*)majSav + getSlotOffset(Majora, slot)));
 
             // get the checksum from the save data, and then calculate the actual checksum
-            chkPtr = (uint16_t*)((char*)&majSav->checksum + (slot * FLA_BLOCK_SIZE));
-            actualChk = getChecksum16((char*)majSav, file->chkOffset + (slot * FLA_BLOCK_SIZE), 8);
+            actualChk = verifySlot((uint8_t*)majSav, file, slot, &checksum);
             break;
 
-        case Mario: // no header, just start reading blocks of save data (0x2000 bytes)
-			marioSav = (marioSave*)readSaveData(file->path, 0x200, file->endian);
+        case Mario: // no header, 4 save files and the menu data, each followed by its backup (0x200 bytes)
+			marioSav = (marioSave*)image.data;
+
+			// the selected file as the game would load it, then every file and the menu data
+			MarioEeprom eeprom;
+			decodeMarioEeprom(&image, &eeprom);
+			const MarioFile* selected = &eeprom.files[slot];
+			const SlotCheck* shown = selected->fromBackup ? selected->pair->backup : selected->pair->primary;
 
-			// print save file data
-			printSave_mario((marioSave*)((char*)marioSav));
+			printf("\n" ANSI_BG_CYAN ANSI_COLOR_BLACK "    File #%d%s    " ANSI_COLOR_RESET "\n", slot + 1,
+			       selected->fromBackup ? " (backup)" : "");
+			printSave_mario((marioSave*)((char*)marioSav + shown->layout->offset));
+			printMarioEeprom(&eeprom);
 
-			// get the checksum from the save data, and then calculate the actual checksum
-			chkPtr = (uint16_t*)((char*)&marioSav->checksum);
-			actualChk = getChecksum16((char*)marioSav, file->chkOffset, 8);
+			checksum = shown->stored;
+			actualChk = shown->actual;
 
             const char* mariosound = L"D:/Programs/C/n64/zelda/sound/sm64_coin.wav";
             sound = mariosound;
 			break;
     }
-    if (chkPtr != NULL)
-         checksum = _byteswap_ushort(*chkPtr);
 
      // Print the actual checksum
      printf("Checksum ( %04x ?= %04x ):      ", checksum, actualChk);
@@ -125,48 +1157,42 @@ int main(int argc, char* argv[])
         const char* errorsound = L"D:/Programs/C/n64/zelda/gui/sound/OOT_Error.wav";
         sound = errorsound;
     }
+    STATS_END(StageRender, renderStart);
 
+    STATS_BEGIN(outputStart);
+    fflush(stdout);
+    STATS_END(StageOutput, outputStart);
     PlaySound(sound, NULL, SND_FILENAME | SND_ASYNC );
-    free(file);
-    free(header);
+    freeSaveData(&image);
 
     Sleep(1500);
 }
+#endif // SAVE64_LIBRARY
 
-FileInfo* 
-getFileInfo(FilePath savefile)
+static uint32_t
+readLE32(const uint8_t* p)
 {
-	FileInfo* file = malloc(sizeof(FileInfo));
-
-	// Initialize FileInfo path and file extension
-	file->path = savefile;
-	file->extension = strrchr((char*)savefile, '.') ? strrchr((char*)savefile, '.') : NULL;
-
-	// Open the input file
-    FILE* input = fopen(savefile, "rb");
-    if (!input) {
-        perror("Couldn't open the file");
-        return 0;
-    }
-
-    // Container for magic identifying numbers
-	uint32_t magic[3];
-
-	// Read the first uint32_t at offset 0x24
-    fseek(input, MAGIC_OFFSET_MM, SEEK_SET);
-	fread(&magic[1], sizeof(uint32_t), 1, input);
-
-	// Read the second uint32_t at offset 0x3C
-	fseek(input, MAGIC_OFFSET_OOT - MAGIC_OFFSET_MM - sizeof(uint32_t), SEEK_CUR);
-	fread(&magic[0], sizeof(uint32_t), 1, input);
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
 
-	// Read the third uint32_t, 4 bytes before the end of the file
-	fseek(input, -(char)sizeof(uint32_t), SEEK_END);
-	fread(&magic[2], sizeof(uint32_t), 1, input);
+// identifies the game and byte order from the magic numbers of an in-memory image
+int
+getFileInfo(FileInfo* file, const uint8_t* data, size_t size)
+{
+	// Container for magic identifying numbers
+	uint32_t magic[3] = { 0 };
 
-	// Get file size
-	fseek(input, 0, SEEK_END);
-	file->size = ftell(input);
+	// 0x3C and 0x24 hold DLEZ/ZELD, the last uint32_t of the file holds the Mario magic.
+	// The magic numbers are little endian reads of the file, whatever the host byte order.
+	if (size >= MAGIC_OFFSET_OOT + sizeof(uint32_t)) {
+		magic[0] = readLE32(data + MAGIC_OFFSET_OOT);
+	}
+	if (size >= MAGIC_OFFSET_MM + sizeof(uint32_t)) {
+		magic[1] = readLE32(data + MAGIC_OFFSET_MM);
+	}
+	if (size >= sizeof(uint32_t)) {
+		magic[2] = readLE32(data + size - sizeof(uint32_t));
+	}
 
 	int index = 0;		// index of magic number if found
 
@@ -196,7 +1222,7 @@ getFileInfo(FilePath savefile)
 	}	
 
 	else {
-		return NULL;
+		return -1;
 	}
 
 	// ZELD = little endian | DLEZ = big endian | Mario 64 is always Big Endian
@@ -207,398 +1233,8031 @@ getFileInfo(FilePath savefile)
 		file->endian = BigE;
 	}
 
-	fclose(input);
-	return file;
+	// only the European releases set a language in the header, and their names use the PAL table
+	size_t language = offsetof(ootHeader, language) ^ (file->endian == LittleE ? 3 : 0);
+	if (file->game == Ocarina && size > language && data[language] != 0x0) {
+		file->charset = PAL;
+	}
+
+	file->size = (long)size;
+	return 0;
 }
 
-void*
-readSaveData(FilePath file_name, size_t file_size, Endian endian)
+// opens the file once, maps it (or reads it in one call), identifies the game
+// and byteswaps little endian images to big endian in place
+LoadStatus
+readSaveData(FilePath file_name, SaveImage* image)
 {
-    // Open SRA file for reading
-    FILE* input = fopen(file_name, "rb");
-    if (!input) {
-        perror("Couldn't read the file");
-        return NULL;
-    }
+	return loadSaveFile(file_name, NULL, image);
+}
 
-    // Allocate memory for header and saves
-    uint8_t* buffer = malloc(file_size);
-    if (!buffer) {
-        fprintf(stderr, "Memory allocation failed.\n");
-        fclose(input);
-        return NULL;
-    }
+// Loads a save file with a single open. Large files are mapped, the others are read into
+// the arena, or a heap buffer when arena is NULL.
+LoadStatus
+loadSaveFile(const char* file_name, SaveArena* arena, SaveImage* image)
+{
+	memset(image, 0, sizeof(SaveImage));
+	image->info.path = file_name;
+	image->info.extension = strrchr((char*)file_name, '.');
+	STATS_BEGIN(start);
+	STATS_COUNT(CounterFiles, 1);
+	STATS_COUNT(CounterSyscalls, 3);    // open, size query, close
 
-	uint32_t dword;
-	size_t bytesRead = 0;
-	size_t bytesWritten = 0;
-	size_t totalBytesRead = 0;
+#ifdef _WIN32
+	HANDLE input = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+	                           FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (input == INVALID_HANDLE_VALUE) {
+		return LoadOpenFailed;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(input, &fileSize) || fileSize.QuadPart < sizeof(uint32_t)) {
+		CloseHandle(input);
+		return LoadTooShort;
+	}
+	image->size = (size_t)fileSize.QuadPart;
+	FILETIME writeTime;
+	if (GetFileTime(input, NULL, NULL, &writeTime)) {
+		image->mtime = (int64_t)((uint64_t)writeTime.dwHighDateTime << 32 | writeTime.dwLowDateTime);
+	}
 
-	while ((totalBytesRead < file_size) && ((bytesRead = fread(&dword, 1, sizeof(uint32_t), input)) == sizeof(uint32_t))) {
-	    if (endian == LittleE) {
-	        dword = _byteswap_ulong(dword);
-	    }
-		memcpy(buffer + totalBytesRead, &dword, sizeof(uint32_t));
-	    totalBytesRead += sizeof(uint32_t);
+	if (image->size >= SAVE_MAP_THRESHOLD) {
+		// copy-on-write view, so byteswapping never touches the file
+		HANDLE mapping = CreateFileMappingA(input, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		if (mapping) {
+			image->data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(mapping);
+			STATS_COUNT(CounterSyscalls, 3);
+			image->mapped = image->data != NULL;
+		}
+	}
+	if (!image->mapped) {
+		DWORD bytesRead = 0;
+		STATS_COUNT(CounterSyscalls, 1);
+		image->data = arena ? arenaAlloc(arena, image->size) : malloc(image->size);
+		image->borrowed = arena != NULL;
+		if (!image->data) {
+			CloseHandle(input);
+			return LoadNoMemory;
+		}
+		if (!ReadFile(input, image->data, (DWORD)image->size, &bytesRead, NULL)
+		    || bytesRead != image->size) {
+			CloseHandle(input);
+			freeSaveData(image);
+			return LoadOpenFailed;
+		}
 	}
+	CloseHandle(input);
+#else
+	int input = open(file_name, O_RDONLY);
+	if (input < 0) {
+		return LoadOpenFailed;
+	}
+	struct stat st;
+	if (fstat(input, &st) != 0 || st.st_size < (off_t)sizeof(uint32_t)) {
+		close(input);
+		return LoadTooShort;
+	}
+	image->size = (size_t)st.st_size;
+	image->mtime = STAT_MTIME_NS(st);
 
-	if (totalBytesRead != file_size) {
-		fprintf(stderr, "Couldn't read the save data.\n");
-		free(buffer);
-		fclose(input);
-		return NULL;
+	if (image->size >= SAVE_MAP_THRESHOLD) {
+		// private mapping, so byteswapping never touches the file
+		void* view = mmap(NULL, image->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, input, 0);
+		STATS_COUNT(CounterSyscalls, 1);
+		if (view != MAP_FAILED) {
+			image->data = view;
+			image->mapped = 1;
+		}
+	}
+	if (!image->mapped) {
+		STATS_COUNT(CounterSyscalls, 1);
+		image->data = arena ? arenaAlloc(arena, image->size) : malloc(image->size);
+		image->borrowed = arena != NULL;
+		if (!image->data) {
+			close(input);
+			return LoadNoMemory;
+		}
+		if (read(input, image->data, image->size) != (ssize_t)image->size) {
+			close(input);
+			freeSaveData(image);
+			return LoadOpenFailed;
+		}
 	}
+	close(input);
+#endif
+	STATS_COUNT(CounterBytesRead, image->size);
+	STATS_END(StageLoad, start);
 
-    fclose(input);
-    return buffer;
+	LoadStatus status = prepareSaveData(image);
+	if (status != LoadOK) {
+		freeSaveData(image);
+	}
+	return status;
 }
 
-void
-decodePlayerName(char* name, Region charset, FILE* fp)
+// identifies the image in image->data and normalizes it to big endian in place
+LoadStatus
+prepareSaveData(SaveImage* image)
 {
-	unsigned char output;
+	STATS_BEGIN(identifyStart);
+	int known = getFileInfo(&image->info, image->data, image->size) == 0;
+	STATS_END(StageIdentify, identifyStart);
+	if (!known) {
+		return LoadUnknownGame;
+	}
+	if (image->size < getSaveSize(image->info.game)) {
+		return LoadTooShort;
+	}
 
-	for (size_t i = 0; i < 8; ++i)
-	{
-		output = (unsigned char)name[i];
+	if (image->info.endian == LittleE) {
+		STATS_BEGIN(swapStart);
+		swapWords32(image->data, image->size);
+		STATS_COUNT(CounterSwapBytes, image->size);
+		STATS_END(StageSwap, swapStart);
+	}
 
-		switch (charset) {
-			case NTSC:
-				if (output >= 0xab && output <= 0xc4)        // 'A' - 'Z'
-					output -= 0x6a;
-				else if (output >= 0xc5 && output <= 0xde)   // 'a' - 'z'
-					output -= 0x64;
-				else if (output == 0xdf)   // Space ' '
-					output = ' ';
-				break;
+	return LoadOK;
+}
 
-			case PAL:
-				if (output >= 0x0a && output <= 0x23)   	 // 'A' - 'Z'
-					output += 0x37;
-				else if (output >= 0x24 && output <= 0x3d)   // 'a' - 'z'
-					output += 0x3d;
-				else if (output == 0x3e)   // Space ' '
-					output = ' ';
-				break;
-		}
-		putc(output, fp);
+// writes the image back in the file's original byte order
+int
+writeSaveData(SaveImage* image)
+{
+	if (image->info.endian == LittleE) {
+		swapWords32(image->data, image->size);
 	}
-	putc('\n', fp);
+	int result = writeFileAtomic(image->info.path, image->data, image->size);
+	if (image->info.endian == LittleE) {
+		swapWords32(image->data, image->size);
+	}
+	return result;
 }
 
-uint16_t
-getChecksum16(uint8_t* buffer, uint16_t cs_offset, int width)
+// The data goes to a temporary file next to the destination first,
+// which then replaces it in one rename.
+int
+writeFileAtomic(const char* path, const void* data, size_t size)
 {
-	uint16_t end = cs_offset;
-	uint16_t offset = 0x0000;
-	uint16_t current = 0x0000;
-	uint16_t checksum = 0x0000;
+	char temp[4096];
+	int result = 0;
 
-	while (offset < end) {
-		if (width == 16) {
-			current = (uint16_t)(*(buffer + offset) << 8 | *(buffer + offset + 1));
-			offset += sizeof(uint16_t);
+#ifdef _WIN32
+	snprintf(temp, sizeof(temp), "%s.%lu.tmp", path, (unsigned long)GetCurrentProcessId());
+#else
+	snprintf(temp, sizeof(temp), "%s.%ld.tmp", path, (long)getpid());
+#endif
+
+	FILE* output = fopen(temp, "wb");
+	if (!output) {
+		perror("Couldn't create the temporary file");
+		return -1;
+	}
+
+	if (fwrite(data, 1, size, output) != size || fflush(output) != 0) {
+		result = -1;
+	}
+#ifndef _WIN32
+	if (result == 0 && fsync(fileno(output)) != 0) {
+		result = -1;
+	}
+#endif
+	if (fclose(output) != 0) {
+		result = -1;
+	}
+
+	if (result == 0) {
+#ifdef _WIN32
+		if (!MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+			result = -1;
 		}
-		else if (width == 8) {
-			current = (uint8_t)*(buffer + offset);
-			offset += sizeof(uint8_t);
+#else
+		if (rename(temp, path) != 0) {
+			result = -1;
 		}
-		checksum += current;
+#endif
 	}
+	if (result != 0) {
+		fprintf(stderr, "Couldn't write %s.\n", path);
+		remove(temp);
+	}
+	return result;
+}
 
-	return checksum;
+// size and modification time of a file, without opening it
+int
+getFileStamp(const char* path, uint64_t* size, int64_t* mtime)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes)) {
+		return -1;
+	}
+	*size = (uint64_t)attributes.nFileSizeHigh << 32 | attributes.nFileSizeLow;
+	*mtime = (int64_t)((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32
+	                   | attributes.ftLastWriteTime.dwLowDateTime);
+#else
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		return -1;
+	}
+	*size = (uint64_t)st.st_size;
+	*mtime = STAT_MTIME_NS(st);
+#endif
+	return 0;
+}
+
+// maps a whole file read-only
+int
+mapFile(const char* path, MappedFile* file)
+{
+	memset(file, 0, sizeof(MappedFile));
+#ifdef _WIN32
+	HANDLE input = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+	if (input == INVALID_HANDLE_VALUE) {
+		return -1;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(input, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(input);
+		return -1;
+	}
+	HANDLE mapping = CreateFileMappingA(input, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(input);
+	if (!mapping) {
+		return -1;
+	}
+	file->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	file->size = (size_t)fileSize.QuadPart;
+#else
+	int input = open(path, O_RDONLY);
+	if (input < 0) {
+		return -1;
+	}
+	struct stat st;
+	if (fstat(input, &st) != 0 || st.st_size == 0) {
+		close(input);
+		return -1;
+	}
+	void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, input, 0);
+	close(input);
+	file->data = view == MAP_FAILED ? NULL : view;
+	file->size = (size_t)st.st_size;
+#endif
+	return file->data ? 0 : -1;
 }
 
 void
-printHeader(const ootHeader* header)
+unmapFile(MappedFile* file)
 {
-    printf("ID: ");  // Last 5 bytes contain string "ZELDA"
-    for (int i = 0; i < 4; i++) {
-        printf("0x%x ", (unsigned char)header->id[i]);
-    }
-    for (int i = 4; i < sizeof(header->id); i++) {
-        putc(header->id[i], stdout);
-    } putc('\n', stdout);
+	if (file->data) {
+#ifdef _WIN32
+		UnmapViewOfFile((void*)file->data);
+#else
+		munmap((void*)file->data, file->size);
+#endif
+	}
+	file->data = NULL;
+	file->size = 0;
+}
 
-    printf( ANSI_BG_CYAN ANSI_COLOR_BLACK "       Options        " ANSI_COLOR_RESET "\n" );
+void
+freeSaveData(SaveImage* image)
+{
+	if (!image->data) {
+		return;
+	}
+	if (image->mapped) {
+#ifdef _WIN32
+		UnmapViewOfFile(image->data);
+#else
+		munmap(image->data, image->size);
+#endif
+	} else if (!image->borrowed) {
+		free(image->data);
+	}
+	image->data = NULL;
+	image->mapped = 0;
+	image->borrowed = 0;
+}
 
-    char sound[16] = "";
-    switch (header->sound) {
-    case 0x0:
-        strncpy(sound, "Stereo", 8);
-        break;
-    case 0x1:
-        strncpy(sound, "Mono", 8);
-        break;
-    case 0x2:
-        strncpy(sound, "Headset", 8);
-        break;
-    case 0x3:
-        strncpy(sound, "Surround", 16);
-        break;
-    default:
-        strncpy(sound, "Unknown", 8);
-        break;
-    } printf("Sound: %s\n", sound);
-   
-    char ztarget[8] = "";
-    switch (header->ztarget) {
-    case 0x0:
-        strcpy(ztarget, "Switch");
-        break;
-    case 0x1:
-        strcpy(ztarget, "Hold");
-        break;
-    default:
-        strcpy(ztarget, "Unknown");
-        break;
-    } printf("Z Target: %s\n", ztarget);
+void
+arenaInit(SaveArena* arena, void* memory, size_t size)
+{
+	arena->base = memory;
+	arena->size = memory ? size : 0;
+	arena->used = 0;
+}
 
-    char language[8] = "";
-    switch (header->language) {
-        case 0x0:
-            strcpy(language, "English");
-            break;
-        case 0x1:
-            strcpy(language, "German");
-            break;
-        case 0x2:
-            strcpy(language, "French");
-            break;
-        default:
-            strcpy(language, "Unknown");
-            break;
-    } printf("Language: %s\n", language);
+// 16 byte aligned, for the SIMD kernels. NULL when the arena is full.
+void*
+arenaAlloc(SaveArena* arena, size_t size)
+{
+	size_t start = (arena->used + 15) & ~(size_t)15;
+	if (start > arena->size || size > arena->size - start) {
+		return NULL;
+	}
+	arena->used = start + size;
+	return arena->base + start;
 }
 
 void
-printWelcome(const char* title, const char* description)
+arenaReset(SaveArena* arena)
 {
-	printf( ANSI_BG_CYAN ANSI_COLOR_BLACK"****************************************************************"ANSI_COLOR_RESET "\n");
-	printf( ANSI_BG_CYAN ANSI_COLOR_BLACK" %s  |  %-28s" ANSI_COLOR_RESET "\n", title, description);
-	printf( ANSI_BG_CYAN ANSI_COLOR_BLACK"****************************************************************"ANSI_COLOR_RESET "\n");
+	arena->used = 0;
 }
 
-void printHex(const char* label, int value)
+// Identifies and normalizes an image already in memory. The image keeps pointing at data.
+LoadStatus
+parseSaveData(uint8_t* data, size_t size, const char* name, SaveImage* image)
 {
-	printf("%-31s   %02x\n", label, value);
+	memset(image, 0, sizeof(SaveImage));
+	image->info.path = name;
+	image->data = data;
+	image->size = size;
+	image->borrowed = 1;
+	if (size < sizeof(uint32_t)) {
+		return LoadTooShort;
+	}
+	return prepareSaveData(image);
 }
 
-void printBinary(uint16_t value, size_t width)
+// checksums every block, and pairs the backups with their primaries when asked to
+int
+checkSaveData(const SaveImage* image, int withPairs, SaveReport* report)
 {
-    int space = 0;
-    for (int i = width; i > 0; i--, space++) {
-        if (space == 4) {
-            putc(' ', stdout);
-        } space %= 4;
-        putchar((value & (1 << i)) ? '1' : '0');
-    }
-    printf("\n");
+	report->blockCount = verifyImage(image->data, image->size, image->info.game, report->checks);
+	report->pairCount = withPairs ? pairSlots(image->data, report->checks, report->blockCount, report->pairs) : 0;
+	return report->blockCount;
 }
 
-// counts the number of '1' bits in an 8-bit unsigned integer
-int countSetBits(uint8_t b)
+// checkSaveData through a shared dedup table, see verifyImageDedup
+int
+checkSaveDataDedup(const SaveImage* image, int withPairs, DedupTable* table, uint64_t* hashes, int* reused,
+                   SaveReport* report)
 {
-	int count = 0;
+	report->blockCount = verifyImageDedup(image->data, image->size, image->info.game, report->checks, table,
+	                                      hashes, reused);
+	report->pairCount = withPairs ? pairSlots(image->data, report->checks, report->blockCount, report->pairs) : 0;
+	return report->blockCount;
+}
 
-	for(int i = 0; i < 7; i++) // ignore the MSB
-		if(((b >> i) & 1) == 1)
-			count++;
-		
-	return count;
+// Player name characters by region, indexed by the byte stored in the save. Codes without a
+// Latin equivalent (the kana of the Japanese table, the accented letters and symbols of the
+// others) read as '?', which is never written back.
+static const char nameGlyphs[2][257] = {
+	// NTSC: digits and kana, with the Latin letters and space after them
+	"0123456789??????" "????????????????" "????????????????" "????????????????"
+	"????????????????" "????????????????" "????????????????" "????????????????"
+	"????????????????" "????????????????" "???????????ABCDE" "FGHIJKLMNOPQRSTU"
+	"VWXYZabcdefghijk" "lmnopqrstuvwxyz " "????????????????" "????????????????",
+	// PAL: digits, Latin letters and punctuation from the start
+	"0123456789ABCDEF" "GHIJKLMNOPQRSTUV" "WXYZabcdefghijkl" "mnopqrstuvwxyz -"
+	".???????????????" "????????????????" "????????????????" "????????????????"
+	"????????????????" "????????????????" "????????????????" "????????????????"
+	"????????????????" "????????????????" "????????????????" "????????????????",
+};
+
+char
+decodeNameChar(unsigned char c, Region charset)
+{
+	return nameGlyphs[charset == NTSC ? 0 : 1][c];
+}
+
+// Decodes len name bytes into text, which needs room for len + 1 characters. The padding
+// spaces are dropped, and the length of what is left is returned.
+size_t
+decodeName(const uint8_t* raw, size_t len, Region charset, char* text)
+{
+	const char* glyphs = nameGlyphs[charset == NTSC ? 0 : 1];
+	size_t used = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		text[i] = glyphs[raw[i]];
+		if (text[i] != ' ') {
+			used = i + 1;
+		}
+	}
+	text[used] = '\0';
+	return used;
+}
+
+// Encodes text into len name bytes, padded with spaces the way the file select leaves them.
+// Fails when the text is too long or has a character the region's table can't show.
+int
+encodeName(const char* text, Region charset, uint8_t* raw, size_t len)
+{
+	const char* glyphs = nameGlyphs[charset == NTSC ? 0 : 1];
+	const char* space = memchr(glyphs, ' ', 256);
+	size_t i = 0;
+
+	for (; text[i] != '\0'; i++) {
+		const char* glyph = text[i] != '?' ? memchr(glyphs, text[i], 256) : NULL;
+		if (i >= len || !glyph) {
+			return -1;
+		}
+		raw[i] = (uint8_t)(glyph - glyphs);
+	}
+	for (; i < len; i++) {
+		raw[i] = (uint8_t)(space - glyphs);
+	}
+	return 0;
 }
 
 void
-printSave_oot(ootSave* savedata, FileInfo* file, int slot)
+decodePlayerName(char* name, Region charset, FILE* fp)
 {
-    // Byteswap variables
-    uint32_t entranceIndex = _byteswap_ulong(savedata->entranceIndex);
-    uint32_t ageModifier = _byteswap_ulong(savedata->ageModifier);
-    uint16_t cutscene = _byteswap_ushort(savedata->cutscene);
-    uint16_t worldTime = _byteswap_ushort(savedata->worldTime);
-    uint32_t nightFlag = _byteswap_ulong(savedata->nightFlag);
-    uint16_t deathCounter = _byteswap_ushort(savedata->deathCounter);
-    uint16_t diskDriveOnly = _byteswap_ushort(savedata->diskDriveOnly);
-    uint16_t heartContainers = _byteswap_ushort(savedata->heartContainers);
-    uint16_t currentHealth = _byteswap_ushort(savedata->currentHealth);
-    uint16_t rupees = _byteswap_ushort(savedata->rupees);
-    uint16_t naviTimer = _byteswap_ushort(savedata->naviTimer);
-    uint16_t currentlyEquippedEquipment = _byteswap_ushort(savedata->currentlyEquippedEquipment);
-    uint16_t savedSceneIndex = _byteswap_ushort(savedata->savedSceneIndex);
-    uint16_t obtainedEquipment = _byteswap_ushort(savedata->obtainedEquipment);
-    uint32_t obtainedUpgrades = _byteswap_ulong(savedata->obtainedUpgrades);
-    uint32_t questStatusItems = _byteswap_ulong(savedata->questStatusItems);
-    uint16_t doubleDefenseHearts = _byteswap_ushort(savedata->doubleDefenseHearts);
-    uint16_t goldSkulltulaTokens = _byteswap_ushort(savedata->goldSkulltulaTokens);
-    uint32_t bigPoePoints = _byteswap_ulong(savedata->bigPoePoints);
-    uint32_t checksum = _byteswap_ushort(savedata->checksum);
+	char text[9];
 
-    // Print calls
-    printf( "\n" ANSI_BG_CYAN ANSI_COLOR_BLACK "    File #%d    " ANSI_COLOR_RESET "\n", slot + 1);
-    printf("Entrance Index:                 ");
-    printLocationString(entranceIndex);
-    printf("Age Modifier:                   %s\n", ageModifier ? "Child" : "Adult");
-    printf("Cutscene:                       %04x\n", cutscene);
-    printf("World Time:                     %04x\n", worldTime);
-    printf("Night Flag:                     %s\n", nightFlag ? "Night" : "Day");
-    printf("Magic String:                   %s\n", savedata->id);
-    printf("Death Counter:                  %d\n", deathCounter);
-    printf("Player Name:                    ");
-    decodePlayerName(savedata->playerName, NTSC, stdout);
-    printf("Disk Drive Only:                %04x\n", diskDriveOnly);
-    printf("Current Health:                 %d/%d\n", currentHealth / 0x10, heartContainers / 0x10);
-    printf("Magic Meter Size:               %x\n", savedata->magicMeterSize);
-    printf("Current Magic:                  %.2f%%\n", ((double)savedata->currentMagic / (double)0x60) * 100.0);
-    printf("Rupees:                         %03d\n", rupees);
-    printf("Biggoron Sword Flag 1:          %s\n", savedata->biggoronSwordFlag1 ? "True" : "False");
-    printf("Navi Timer:                     %04x\n", naviTimer);
-    printf("Magic Flag 1:                   %s\n", savedata->magicFlag1 ? "True" : "False");
-    printf("Magic Flag 2:                   %s\n", savedata->magicFlag2 ? "True" : "False");
-    printf("Biggoron Sword Flag 2:          %x\n", savedata->biggoronSwordFlag2);
-    printf("Saved Scene Index:              %04x\n", savedSceneIndex);
+	decodeName((const uint8_t*)name, 8, charset, text);
+	fputs(text, fp);
+	putc('\n', fp);
+}
 
-    // Skipping currentButtonEquips[7] (an array)
+static void
+swapWords32_scalar(uint8_t* data, size_t size)
+{
+	uint32_t dword;
 
-    printf("Currently Equipped Equipment:   %04x\n", currentlyEquippedEquipment);
+	for (size_t i = 0; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+		memcpy(&dword, data + i, sizeof(uint32_t));
+		dword = _byteswap_ulong(dword);
+		memcpy(data + i, &dword, sizeof(uint32_t));
+	}
+}
 
-    // Skipping inventory[24] (an array)
+#ifdef SAVE64_SSE2
+static void
+swapWords32_sse2(uint8_t* data, size_t size)
+{
+	size_t i = 0;
 
-    printf("Item Amounts:\n");
+	for (; i + 16 <= size; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+		v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);	// swap the halves of each dword
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));	// swap the bytes of each half
+		_mm_storeu_si128((__m128i*)(data + i), v);
+	}
+	swapWords32_scalar(data + i, size - i);
+}
+#endif
 
-    char* items[] = {
-    "Deku Stick", "Deku Nuts", "Bombs", "Arrows",
-    "?", "?", "Deku Seeds", "?", "Bombchus",
-    "?", "?", "?", "?", "?", "?", "?", "?", "?"
-    };
-    
-    for (int i = 0; i < 0xf; i++) {
-        if (savedata->itemAmounts[i]) {
-            printf(" *\t\t%-12s    %02d %s\n", "", savedata->itemAmounts[i], items[i]);
-        }
-    } putc('\n', stdout);
+#ifdef SAVE64_AVX2
+TARGET_AVX2 static void
+swapWords32_avx2(uint8_t* data, size_t size)
+{
+	const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+	                                      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	size_t i = 0;
 
-    printf("Magic Beans Bought:             %d\n", savedata->magicBeansBought);
-    printf("Obtained Equipment:             ");
-    printBinary(obtainedEquipment, 16);
-    printf("Obtained Upgrades:              ");
-    printBinary(obtainedUpgrades, 32);
-    printf("Quest Status Items:             ");
-    printBinary(questStatusItems, 32);
+	for (; i + 64 <= size; i += 64) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)(data + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(data + i + 32));
+		_mm256_storeu_si256((__m256i*)(data + i), _mm256_shuffle_epi8(a, mask));
+		_mm256_storeu_si256((__m256i*)(data + i + 32), _mm256_shuffle_epi8(b, mask));
+	}
+	swapWords32_scalar(data + i, size - i);
+}
+#endif
 
-    // Skipping dungeonItems[0x14] (an array)
+static int
+cpuHasAvx2(void)
+{
+#if defined(SAVE64_AVX2) && defined(__GNUC__)
+	return __builtin_cpu_supports("avx2");
+#elif defined(SAVE64_AVX2)
+	return 1;
+#else
+	return 0;
+#endif
+}
 
-    // Skipping smallKeyAmounts[0x13] (an array)
+// reverses the bytes of every dword, turning a ZELD (little endian) image into a DLEZ one.
+// This is a property of the file layout, so it runs on any host.
+void
+swapWords32(uint8_t* data, size_t size)
+{
+#ifdef SAVE64_AVX2
+	if (cpuHasAvx2()) {
+		swapWords32_avx2(data, size);
+		return;
+	}
+#endif
+#ifdef SAVE64_SSE2
+	swapWords32_sse2(data, size);
+#else
+	swapWords32_scalar(data, size);
+#endif
+}
 
-    printf("Double Defense Hearts:          %d\n", doubleDefenseHearts / 0x100);
-    printf("Gold Skulltula Tokens:          %d/100\n", goldSkulltulaTokens);
-    printf("Big Poe Points:                 %d/10\n", bigPoePoints/100);
+static uint16_t
+checksumBytes_scalar(const uint8_t* data, size_t len)
+{
+	uint32_t checksum = 0;
 
-    // Skipping eventChkInf[14] (an array)
+	for (size_t i = 0; i < len; i++) {
+		checksum += data[i];
+	}
+	return (uint16_t)checksum;
+}
 
-    // Skipping itemGetInf[4] (an array)
+static uint16_t
+checksumWords16_scalar(const uint8_t* data, size_t len)
+{
+	uint32_t checksum = 0;
 
-    // Skipping infTable[30] (an array)
+	for (size_t i = 0; i + 1 < len; i += 2) {
+		checksum += (uint32_t)(data[i] << 8 | data[i + 1]);
+	}
+	return (uint16_t)checksum;
 }
 
-void
-printSave_maj(majSave* savedata)
+// The sum of big endian halfwords is 0x100 * (sum of even bytes) + (sum of odd bytes)
+// modulo 0x10000, so both checksums reduce to horizontal byte sums (psadbw).
+#ifdef SAVE64_SSE2
+static uint16_t
+checksumBytes_sse2(const uint8_t* data, size_t len)
 {
-	// Byteswap integer variables to little endian
-	uint32_t entranceIndex = _byteswap_ulong(savedata->entranceIndex);
-	uint32_t cutscene = _byteswap_ulong(savedata->cutscene);
-	uint16_t worldTime = _byteswap_ushort(savedata->worldTime);
-	uint16_t owlSaveLocation = _byteswap_ushort(savedata->owlSaveLocation);
-	uint32_t nightFlag = _byteswap_ulong(savedata->nightFlag);
-	uint32_t currentDay = _byteswap_ulong(savedata->currentDay);
-	uint16_t heartContainers = _byteswap_ushort(savedata->heartContainers);
-	uint16_t currentHealth = _byteswap_ushort(savedata->currentHealth);
-	uint16_t rupees = _byteswap_ushort(savedata->rupees);
-	uint16_t swordHealth = _byteswap_ushort(savedata->swordHealth);
-	
-	// Print save file data
-	savedata->entranceIndex = _byteswap_ulong(savedata->entranceIndex);
-	printf("Entrance Index:                 ");
-	printLocationString(savedata->entranceIndex);
-	printf("Equipped Mask:                  %02x\n", savedata->equippedMask);
-	printf("Age Modifier:                   %s\n", savedata->ageModifier ? "Child" : "Adult");
-	printf("Cutscene Number:                %08x\n", cutscene);
-	printf("World Time:                     %04x\n", worldTime);
-	printf("Owl Save Location:              %04x\n", owlSaveLocation);
-	printf("Night Flag:                     %s\n", nightFlag ? "Night" : "Day");
-	printf("Current Day:                    %x\n", currentDay);
-	printf("Player Form:                    %02x\n", savedata->playerForm);
-	printf("Have Tatl:                      %s\n", savedata->haveTatl ? "Yes" : "No");
-	printf("Is Owl Save?:                   %s\n", savedata->isOwlSave ? "Yes" : "No");
-	printf("Magic String:                   %s\n", savedata->id);
-	printf("Player Name:                    ");
-	decodePlayerName(savedata->playerName, PAL, stdout);
-	printf("Current Health:                 %d/%d\n", currentHealth / 0x10, heartContainers / 0x10);
-	printf("Magic Meter Size:               %d\n", savedata->magicMeterSize);
-	printf("Current Magic:                  %.2f%%\n", ((double)savedata->currentMagic / (double)0x60) * 100.0);
-	printf("Rupees:                         %03d\n", rupees);
-	printf("Sword Health:                   %02x\n", swordHealth);
-	printf("Double Defense Hearts:          %02x\n", savedata->doubleDefenseHearts);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = zero;
+	uint64_t lanes[2];
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16) {
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(data + i)), zero));
+	}
+	_mm_storeu_si128((__m128i*)lanes, acc);
+	return (uint16_t)(lanes[0] + lanes[1] + checksumBytes_scalar(data + i, len - i));
 }
 
-// Function to print all values
-void printSave_mario(marioSave* savedata)
+static uint16_t
+checksumWords16_sse2(const uint8_t* data, size_t len)
 {
-	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Cap Position Data " ANSI_COLOR_RESET "\n");
-     //printf("Cap Position Data:\n");
-	printf("capLevel  %26u\n", savedata->capLevel);
-	printf("capArea   %26u\n", savedata->capArea);
-	printf("capPos_x  %26d\n", savedata->capPos_x);
-	printf("capPos_y  %26d\n", savedata->capPos_y);
-	printf("capPos_z  %26d\n", savedata->capPos_z);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i evenMask = _mm_set1_epi16(0x00FF);
+	__m128i high = zero, low = zero;
+	uint64_t h[2], l[2];
+	size_t i = 0;
 
-	 printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Castle Flags " ANSI_COLOR_RESET "\n");
-     //printf("\nCastle Flags:\n");
-    printf("%-27s", "castleStars: ");
-	printBinary(savedata->castleStars, 8);
-	printf("%-27s", "castleFlag: ");
-	printBinary(savedata->castleFlag1, 8);
-	printf("%-27s", "castleFlag2: ");
-	printBinary(savedata->castleFlag2, 8);
-	printf("%-27s", "castleFlag3: ");
-	printBinary(savedata->castleFlag3, 8);
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+		high = _mm_add_epi64(high, _mm_sad_epu8(_mm_and_si128(v, evenMask), zero));
+		low = _mm_add_epi64(low, _mm_sad_epu8(_mm_srli_epi16(v, 8), zero));
+	}
+	_mm_storeu_si128((__m128i*)h, high);
+	_mm_storeu_si128((__m128i*)l, low);
+	return (uint16_t)(((h[0] + h[1]) << 8) + l[0] + l[1] + checksumWords16_scalar(data + i, len - i));
+}
+#endif
 
-	// Levels
-	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Levels                  Coins  Stars " ANSI_COLOR_RESET "\n");
-	printf("Bomb-omb Battlefield       %03d %3d/7\n", savedata->score1, countSetBits(savedata->stage1));
-	printf("Whomp's Fortress           %03d %3d/7\n", savedata->score2, countSetBits(savedata->stage2));
-	printf("Jolly Roger Bay            %03d %3d/7\n", savedata->score3, countSetBits(savedata->stage3));
-	printf("Cool Cool Mountain         %03d %3d/7\n", savedata->score4, countSetBits(savedata->stage4));
-	printf("Big Boo's Haunt            %03d %3d/7\n", savedata->score5, countSetBits(savedata->stage5));
-	printf("Hazy Maze Cave             %03d %3d/7\n", savedata->score6, countSetBits(savedata->stage6));
-	printf("Lethal Lava Land           %03d %3d/7\n", savedata->score7, countSetBits(savedata->stage7));
-	printf("Shifting Sand Land         %03d %3d/7\n", savedata->score8, countSetBits(savedata->stage8));
-	printf("Dire Dire Docks            %03d %3d/7\n", savedata->score9, countSetBits(savedata->stage9));
-	printf("Snowman's Land             %03d %3d/7\n", savedata->score10, countSetBits(savedata->stage10));
-	printf("Wet Dry World              %03d %3d/7\n", savedata->score11, countSetBits(savedata->stage11));
-	printf("Tall Tall Mountain         %03d %3d/7\n", savedata->score12, countSetBits(savedata->stage12));
-	printf("Tiny Huge Island           %03d %3d/7\n", savedata->score13, countSetBits(savedata->stage13));
-	printf("Tick Tock Clock            %03d %3d/7\n", savedata->score14, countSetBits(savedata->stage14));
-	printf("Rainbow Ride               %03d %3d/7\n", savedata->score15, countSetBits(savedata->stage15));
-	
-	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Castle Secret Stars " ANSI_COLOR_RESET "\n");
-	//printf("\nCastle Secret Stars:\n");
-	printHex("bowser1RedCoins", savedata->bowser1RedCoins);
-	printHex("bowser2RedCoins", savedata->bowser2RedCoins);
-	printHex("bowser3RedCoins", savedata->bowser3RedCoins);
-	printHex("princessSecretSlide", savedata->princessSecretSlide);
-	printHex("metalCapRedCoins", savedata->metalCapRedCoins);
-	printHex("wingCapRedCoins", savedata->wingCapRedCoins);
-	printHex("vanishCapRedCoins", savedata->vanishCapRedCoins);
-	printHex("marioWingsRedCoins", savedata->marioWingsRedCoins);
-	printHex("princessSecretAquarium", savedata->princessSecretAquarium);
-	printHex("unusedCakeScreen", savedata->unusedCakeScreen);
+#ifdef SAVE64_AVX2
+TARGET_AVX2 static uint16_t
+checksumBytes_avx2(const uint8_t* data, size_t len)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i acc = zero;
+	uint64_t lanes[4];
+	size_t i = 0;
 
-	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Signature " ANSI_COLOR_RESET "\n");
-    //printf("\nSignature:\n");
-    printf("magicNumber: 0x%04X\n", _byteswap_ushort(savedata->magicNumber));
+	for (; i + 32 <= len; i += 32) {
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(data + i)), zero));
+	}
+	_mm256_storeu_si256((__m256i*)lanes, acc);
+	return (uint16_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3] + checksumBytes_scalar(data + i, len - i));
 }
 
-void modify_int(int arg)
+TARGET_AVX2 static uint16_t
+checksumWords16_avx2(const uint8_t* data, size_t len)
 {
-    
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i evenMask = _mm256_set1_epi16(0x00FF);
+	__m256i high = zero, low = zero;
+	uint64_t h[4], l[4];
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+		high = _mm256_add_epi64(high, _mm256_sad_epu8(_mm256_and_si256(v, evenMask), zero));
+		low = _mm256_add_epi64(low, _mm256_sad_epu8(_mm256_srli_epi16(v, 8), zero));
+	}
+	_mm256_storeu_si256((__m256i*)h, high);
+	_mm256_storeu_si256((__m256i*)l, low);
+	return (uint16_t)(((h[0] + h[1] + h[2] + h[3]) << 8) + l[0] + l[1] + l[2] + l[3]
+	                  + checksumWords16_scalar(data + i, len - i));
+}
+#endif
+
+// 8-bit checksum (Majora's Mask, Super Mario 64): sum of len bytes
+uint16_t
+checksumBytes(const uint8_t* data, size_t len)
+{
+#ifdef SAVE64_AVX2
+	if (cpuHasAvx2()) {
+		return checksumBytes_avx2(data, len);
+	}
+#endif
+#ifdef SAVE64_SSE2
+	return checksumBytes_sse2(data, len);
+#else
+	return checksumBytes_scalar(data, len);
+#endif
+}
+
+// 16-bit checksum (Ocarina of Time): sum of the big endian halfwords in len bytes
+uint16_t
+checksumWords16(const uint8_t* data, size_t len)
+{
+#ifdef SAVE64_AVX2
+	if (cpuHasAvx2()) {
+		return checksumWords16_avx2(data, len);
+	}
+#endif
+#ifdef SAVE64_SSE2
+	return checksumWords16_sse2(data, len);
+#else
+	return checksumWords16_scalar(data, len);
+#endif
+}
+
+static inline unsigned
+lowestSetBit(uint32_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (unsigned)index;
+#else
+	return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+static size_t
+compareBlocks_scalar(const uint8_t* a, const uint8_t* b, size_t len)
+{
+	size_t i = 0;
+	uint64_t x, y;
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		memcpy(&x, a + i, sizeof(uint64_t));
+		memcpy(&y, b + i, sizeof(uint64_t));
+		if (x != y) {
+			break;
+		}
+	}
+	while (i < len && a[i] == b[i]) {
+		i++;
+	}
+	return i;
+}
+
+// 16/32 bytes per step: byte compare, then the movemask of the result points at the first difference
+#ifdef SAVE64_SSE2
+static size_t
+compareBlocks_sse2(const uint8_t* a, const uint8_t* b, size_t len)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16) {
+		__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(eq) ^ 0xFFFFu;
+		if (mask) {
+			return i + lowestSetBit(mask);
+		}
+	}
+	return i + compareBlocks_scalar(a + i, b + i, len - i);
+}
+#endif
+
+#ifdef SAVE64_AVX2
+TARGET_AVX2 static size_t
+compareBlocks_avx2(const uint8_t* a, const uint8_t* b, size_t len)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32) {
+		__m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)),
+		                               _mm256_loadu_si256((const __m256i*)(b + i)));
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(eq);
+		if (mask) {
+			return i + lowestSetBit(mask);
+		}
+	}
+	return i + compareBlocks_scalar(a + i, b + i, len - i);
+}
+#endif
+
+// offset of the first byte where the blocks differ, len when they are identical
+size_t
+compareBlocks(const uint8_t* a, const uint8_t* b, size_t len)
+{
+#ifdef SAVE64_AVX2
+	if (cpuHasAvx2()) {
+		return compareBlocks_avx2(a, b, len);
+	}
+#endif
+#ifdef SAVE64_SSE2
+	return compareBlocks_sse2(a, b, len);
+#else
+	return compareBlocks_scalar(a, b, len);
+#endif
+}
+
+// Offsets in data[0, len) where the 4 byte magic of a game starts: the Zelda magic in either
+// byte order (which in a big endian Ocarina image also matches the header ID "ZELDA") and the
+// trailing magic of a Super Mario 64 EEPROM. Stops when hits is full; *end receives the offset
+// the search got to, so the next call can resume there.
+static size_t
+findMagic_scalar(const uint8_t* data, size_t len, uint32_t* hits, size_t capacity, size_t* end)
+{
+	size_t count = 0;
+	size_t i = 0;
+
+	for (; i + sizeof(uint32_t) <= len; i++) {
+		uint32_t word = readLE32(data + i);
+		if (word == MAGIC_DLEZ || word == MAGIC_ZELD || word == MAGIC_MARIO) {
+			if (count == capacity) {
+				break;
+			}
+			hits[count++] = (uint32_t)i;
+		}
+	}
+	*end = i;
+	return count;
+}
+
+// The vector versions compare the first and the last byte of every pattern at 16/32 offsets at
+// once and confirm the few offsets where both match with a word compare.
+#ifdef SAVE64_SSE2
+static size_t
+findMagic_sse2(const uint8_t* data, size_t len, uint32_t* hits, size_t capacity, size_t* end)
+{
+	const __m128i first0 = _mm_set1_epi8((char)(MAGIC_DLEZ & 0xFF));
+	const __m128i last0 = _mm_set1_epi8((char)(MAGIC_DLEZ >> 24));
+	const __m128i first1 = _mm_set1_epi8((char)(MAGIC_ZELD & 0xFF));
+	const __m128i last1 = _mm_set1_epi8((char)(MAGIC_ZELD >> 24));
+	const __m128i first2 = _mm_set1_epi8((char)(MAGIC_MARIO & 0xFF));
+	const __m128i last2 = _mm_set1_epi8((char)(MAGIC_MARIO >> 24));
+	size_t count = 0;
+	size_t i = 0;
+
+	for (; i + 16 + 3 <= len; i += 16) {
+		__m128i head = _mm_loadu_si128((const __m128i*)(data + i));
+		__m128i tail = _mm_loadu_si128((const __m128i*)(data + i + 3));
+		__m128i match = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(head, first0), _mm_cmpeq_epi8(tail, last0)),
+			             _mm_and_si128(_mm_cmpeq_epi8(head, first1), _mm_cmpeq_epi8(tail, last1))),
+			_mm_and_si128(_mm_cmpeq_epi8(head, first2), _mm_cmpeq_epi8(tail, last2)));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(match);
+		if (mask && capacity - count < 16) {
+			*end = i;
+			return count;
+		}
+		while (mask) {
+			size_t at = i + lowestSetBit(mask);
+			uint32_t word = readLE32(data + at);
+			if (word == MAGIC_DLEZ || word == MAGIC_ZELD || word == MAGIC_MARIO) {
+				hits[count++] = (uint32_t)at;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	size_t tail = 0;
+	size_t found = findMagic_scalar(data + i, len - i, hits + count, capacity - count, &tail);
+	for (size_t k = 0; k < found; k++) {
+		hits[count + k] += (uint32_t)i;
+	}
+	*end = i + tail;
+	return count + found;
+}
+#endif
+
+#ifdef SAVE64_AVX2
+TARGET_AVX2 static size_t
+findMagic_avx2(const uint8_t* data, size_t len, uint32_t* hits, size_t capacity, size_t* end)
+{
+	const __m256i first0 = _mm256_set1_epi8((char)(MAGIC_DLEZ & 0xFF));
+	const __m256i last0 = _mm256_set1_epi8((char)(MAGIC_DLEZ >> 24));
+	const __m256i first1 = _mm256_set1_epi8((char)(MAGIC_ZELD & 0xFF));
+	const __m256i last1 = _mm256_set1_epi8((char)(MAGIC_ZELD >> 24));
+	const __m256i first2 = _mm256_set1_epi8((char)(MAGIC_MARIO & 0xFF));
+	const __m256i last2 = _mm256_set1_epi8((char)(MAGIC_MARIO >> 24));
+	size_t count = 0;
+	size_t i = 0;
+
+	for (; i + 32 + 3 <= len; i += 32) {
+		__m256i head = _mm256_loadu_si256((const __m256i*)(data + i));
+		__m256i tail = _mm256_loadu_si256((const __m256i*)(data + i + 3));
+		__m256i match = _mm256_or_si256(
+			_mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi8(head, first0), _mm256_cmpeq_epi8(tail, last0)),
+			                _mm256_and_si256(_mm256_cmpeq_epi8(head, first1), _mm256_cmpeq_epi8(tail, last1))),
+			_mm256_and_si256(_mm256_cmpeq_epi8(head, first2), _mm256_cmpeq_epi8(tail, last2)));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(match);
+		if (mask && capacity - count < 32) {
+			*end = i;
+			return count;
+		}
+		while (mask) {
+			size_t at = i + lowestSetBit(mask);
+			uint32_t word = readLE32(data + at);
+			if (word == MAGIC_DLEZ || word == MAGIC_ZELD || word == MAGIC_MARIO) {
+				hits[count++] = (uint32_t)at;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	size_t tail = 0;
+	size_t found = findMagic_scalar(data + i, len - i, hits + count, capacity - count, &tail);
+	for (size_t k = 0; k < found; k++) {
+		hits[count + k] += (uint32_t)i;
+	}
+	*end = i + tail;
+	return count + found;
+}
+#endif
+
+size_t
+findMagic(const uint8_t* data, size_t len, uint32_t* hits, size_t capacity, size_t* end)
+{
+#ifdef SAVE64_AVX2
+	if (cpuHasAvx2()) {
+		return findMagic_avx2(data, len, hits, capacity, end);
+	}
+#endif
+#ifdef SAVE64_SSE2
+	return findMagic_sse2(data, len, hits, capacity, end);
+#else
+	return findMagic_scalar(data, len, hits, capacity, end);
+#endif
+}
+
+// Fast non-cryptographic 64-bit hash (multiply/xorshift over little endian words)
+uint64_t
+hashBytes64(const void* data, size_t len, uint64_t seed)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	const uint64_t golden = 0x9E3779B97F4A7C15ULL;
+	uint64_t hash = seed ^ (len * golden);
+	uint64_t word;
+	size_t i = 0;
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		memcpy(&word, bytes + i, sizeof(uint64_t));
+#ifdef SAVE64_BIG_ENDIAN_HOST
+		word = __builtin_bswap64(word);
+#endif
+		word *= 0xBF58476D1CE4E5B9ULL;
+		word ^= word >> 31;
+		hash = (hash ^ word) * golden;
+	}
+	word = 0;
+	for (size_t shift = 0; i < len; i++, shift += 8) {
+		word |= (uint64_t)bytes[i] << shift;
+	}
+	hash = (hash ^ (word * 0xBF58476D1CE4E5B9ULL)) * golden;
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// hashBlock64 runs eight independent multiply-accumulate lanes over 64 byte stripes, so it isn't
+// bound by the latency of one multiply chain like hashBytes64. Each stripe's keys are offset by
+// its index, which keeps reordered stripes from hashing alike, and the lanes are scrambled
+// every HASH_SCRAMBLE_STRIPES stripes.
+#define HASH_STRIPE 64
+#define HASH_SCRAMBLE_STRIPES 16
+#define HASH_STRIPE_STEP 0x9E3779B97F4A7C15ULL
+#define HASH_SCRAMBLE_PRIME 0x9E3779B1u
+
+static const uint64_t hashLaneKeys[8] = {
+	0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+	0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL,
+};
+
+static void
+hashStripes_scalar(const uint8_t* data, size_t stripes, uint64_t* acc)
+{
+	for (size_t s = 0; s < stripes; s++) {
+		for (int j = 0; j < 8; j++) {
+			uint64_t word;
+			memcpy(&word, data + s * HASH_STRIPE + j * 8, sizeof(uint64_t));
+#ifdef SAVE64_BIG_ENDIAN_HOST
+			word = __builtin_bswap64(word);
+#endif
+			uint64_t keyed = word ^ (hashLaneKeys[j] + s * HASH_STRIPE_STEP);
+			acc[j ^ 1] += word;
+			acc[j] += (keyed & 0xFFFFFFFFu) * (keyed >> 32);
+		}
+		if ((s + 1) % HASH_SCRAMBLE_STRIPES == 0) {
+			for (int j = 0; j < 8; j++) {
+				acc[j] = (acc[j] ^ (acc[j] >> 47) ^ hashLaneKeys[j]) * HASH_SCRAMBLE_PRIME;
+			}
+		}
+	}
+}
+
+// pmuludq gives the 32x32 bit lane products; the 64x32 bit scramble multiply is two of them
+#ifdef SAVE64_SSE2
+static void
+hashStripes_sse2(const uint8_t* data, size_t stripes, uint64_t* acc)
+{
+	const __m128i step = _mm_set1_epi64x((long long)HASH_STRIPE_STEP);
+	const __m128i prime = _mm_set1_epi32((int)HASH_SCRAMBLE_PRIME);
+	__m128i a[4], base[4], key[4];
+
+	for (int v = 0; v < 4; v++) {
+		a[v] = _mm_loadu_si128((const __m128i*)(acc + v * 2));
+		base[v] = key[v] = _mm_loadu_si128((const __m128i*)(hashLaneKeys + v * 2));
+	}
+	for (size_t s = 0; s < stripes; s++) {
+		for (int v = 0; v < 4; v++) {
+			__m128i word = _mm_loadu_si128((const __m128i*)(data + s * HASH_STRIPE + v * 16));
+			__m128i keyed = _mm_xor_si128(word, key[v]);
+			a[v] = _mm_add_epi64(a[v], _mm_shuffle_epi32(word, _MM_SHUFFLE(1, 0, 3, 2)));
+			a[v] = _mm_add_epi64(a[v], _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32)));
+			key[v] = _mm_add_epi64(key[v], step);
+		}
+		if ((s + 1) % HASH_SCRAMBLE_STRIPES == 0) {
+			for (int v = 0; v < 4; v++) {
+				__m128i x = _mm_xor_si128(_mm_xor_si128(a[v], _mm_srli_epi64(a[v], 47)), base[v]);
+				a[v] = _mm_add_epi64(_mm_mul_epu32(x, prime),
+				                     _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), prime), 32));
+			}
+		}
+	}
+	for (int v = 0; v < 4; v++) {
+		_mm_storeu_si128((__m128i*)(acc + v * 2), a[v]);
+	}
+}
+#endif
+
+#ifdef SAVE64_AVX2
+TARGET_AVX2 static void
+hashStripes_avx2(const uint8_t* data, size_t stripes, uint64_t* acc)
+{
+	const __m256i step = _mm256_set1_epi64x((long long)HASH_STRIPE_STEP);
+	const __m256i prime = _mm256_set1_epi32((int)HASH_SCRAMBLE_PRIME);
+	__m256i a[2], base[2], key[2];
+
+	for (int v = 0; v < 2; v++) {
+		a[v] = _mm256_loadu_si256((const __m256i*)(acc + v * 4));
+		base[v] = key[v] = _mm256_loadu_si256((const __m256i*)(hashLaneKeys + v * 4));
+	}
+	for (size_t s = 0; s < stripes; s++) {
+		for (int v = 0; v < 2; v++) {
+			__m256i word = _mm256_loadu_si256((const __m256i*)(data + s * HASH_STRIPE + v * 32));
+			__m256i keyed = _mm256_xor_si256(word, key[v]);
+			a[v] = _mm256_add_epi64(a[v], _mm256_shuffle_epi32(word, _MM_SHUFFLE(1, 0, 3, 2)));
+			a[v] = _mm256_add_epi64(a[v], _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32)));
+			key[v] = _mm256_add_epi64(key[v], step);
+		}
+		if ((s + 1) % HASH_SCRAMBLE_STRIPES == 0) {
+			for (int v = 0; v < 2; v++) {
+				__m256i x = _mm256_xor_si256(_mm256_xor_si256(a[v], _mm256_srli_epi64(a[v], 47)), base[v]);
+				a[v] = _mm256_add_epi64(_mm256_mul_epu32(x, prime),
+				                        _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime), 32));
+			}
+		}
+	}
+	for (int v = 0; v < 2; v++) {
+		_mm256_storeu_si256((__m256i*)(acc + v * 4), a[v]);
+	}
+}
+#endif
+
+static void
+hashStripes(const uint8_t* data, size_t stripes, uint64_t* acc)
+{
+#ifdef SAVE64_AVX2
+	if (cpuHasAvx2()) {
+		hashStripes_avx2(data, stripes, acc);
+		return;
+	}
+#endif
+#ifdef SAVE64_SSE2
+	hashStripes_sse2(data, stripes, acc);
+#else
+	hashStripes_scalar(data, stripes, acc);
+#endif
+}
+
+// Fast non-cryptographic 64-bit hash of a block, for telling identical blocks apart.
+// Same result on every host and with every kernel.
+uint64_t
+hashBlock64(const uint8_t* data, size_t len, uint64_t seed)
+{
+	uint64_t acc[8];
+	size_t stripes = len / HASH_STRIPE;
+	uint64_t hash = seed ^ (len * HASH_STRIPE_STEP);
+
+	memcpy(acc, hashLaneKeys, sizeof(acc));
+	hashStripes(data, stripes, acc);
+	for (int j = 0; j < 8; j++) {
+		uint64_t lane = acc[j] * 0xBF58476D1CE4E5B9ULL;
+		hash = (hash ^ lane ^ (lane >> 31)) * HASH_STRIPE_STEP;
+	}
+	return hashBytes64(data + stripes * HASH_STRIPE, len - stripes * HASH_STRIPE, hash);
+}
+
+uint16_t
+getChecksum16(uint8_t* buffer, uint16_t cs_offset, int width)
+{
+	return width == 16 ? checksumWords16(buffer, cs_offset) : checksumBytes(buffer, cs_offset);
+}
+
+const char*
+getLoadError(LoadStatus status)
+{
+	switch (status) {
+		case LoadOK:          return "No error";
+		case LoadOpenFailed:  return "Couldn't read the file";
+		case LoadUnknownGame: return "Couldn't determine the game type";
+		case LoadTooShort:    return "Couldn't read the save data";
+		case LoadNoMemory:    return "Not enough memory for the save data";
+	}
+	return "Unknown error";
+}
+
+// number of bytes needed from the start of the file for each game
+size_t
+getSaveSize(Game game)
+{
+	switch (game) {
+		case Ocarina: return SRA_HEADER_SIZE + (SRA_BLOCK_SIZE * 3);
+		case Majora:  return FLA_BLOCK_SIZE * 5;
+		case Mario:   return 0x200;
+	}
+	return 0;
+}
+
+// size of the whole save media of each game (SRAM, FlashRAM, 4 kbit EEPROM), as emulators write it
+size_t
+getMediaSize(Game game)
+{
+	switch (game) {
+		case Ocarina: return 0x8000;
+		case Majora:  return 0x20000;
+		case Mario:   return 0x200;
+	}
+	return 0;
+}
+
+const char*
+getGameName(Game game)
+{
+	switch (game) {
+		case Ocarina: return "Ocarina";
+		case Majora:  return "Majora";
+		case Mario:   return "Mario";
+	}
+	return "Unknown";
+}
+
+// offset of the slot the viewer and editor select, from the start of the image
+size_t
+getSlotOffset(Game game, int slot)
+{
+	int count = 0;
+	const SlotLayout* layout = getSlotLayout(game, &count);
+
+	// the slot-th primary save block: MM and SM64 keep each backup right after its file
+	for (int i = 0; i < count; i++) {
+		if (!layout[i].backup && layout[i].hasFields && slot-- == 0) {
+			return layout[i].offset;
+		}
+	}
+	return 0;
+}
+
+// reads the stored checksum of a slot into *stored and returns the calculated one
+uint16_t
+verifySlot(uint8_t* buffer, const FileInfo* file, int slot, uint16_t* stored)
+{
+	uint8_t* block = buffer + getSlotOffset(file->game, slot);
+	int width = file->game == Ocarina ? 16 : 8;
+
+	*stored = (uint16_t)(block[file->chkOffset] << 8 | block[file->chkOffset + 1]);
+	STATS_BEGIN(start);
+	uint16_t actual = getChecksum16(block, file->chkOffset, width);
+	STATS_COUNT(CounterChecksumBytes, file->chkOffset);
+	STATS_END(StageChecksum, start);
+	return actual;
+}
+
+// Every checksummed block of each game, in image order
+static const SlotLayout oot_layout[] = {
+	{ "1",     SRA_HEADER_SIZE + SRA_BLOCK_SIZE * 0, CHK_OFFSET_OOT, 16, 0, 0x1C, "ZELDA", 1 },
+	{ "2",     SRA_HEADER_SIZE + SRA_BLOCK_SIZE * 1, CHK_OFFSET_OOT, 16, 0, 0x1C, "ZELDA", 1 },
+	{ "3",     SRA_HEADER_SIZE + SRA_BLOCK_SIZE * 2, CHK_OFFSET_OOT, 16, 0, 0x1C, "ZELDA", 1 },
+	{ "1b",    SRA_HEADER_SIZE + SRA_BLOCK_SIZE * 3, CHK_OFFSET_OOT, 16, 1, 0x1C, "ZELDA", 1 },
+	{ "2b",    SRA_HEADER_SIZE + SRA_BLOCK_SIZE * 4, CHK_OFFSET_OOT, 16, 1, 0x1C, "ZELDA", 1 },
+	{ "3b",    SRA_HEADER_SIZE + SRA_BLOCK_SIZE * 5, CHK_OFFSET_OOT, 16, 1, 0x1C, "ZELDA", 1 },
+};
+
+static const SlotLayout maj_layout[] = {
+	{ "1",     FLA_BLOCK_SIZE * 0,  CHK_OFFSET_MM, 8, 0, MAGIC_OFFSET_MM, "ZELDA", 1 },
+	{ "1b",    FLA_BLOCK_SIZE * 1,  CHK_OFFSET_MM, 8, 1, MAGIC_OFFSET_MM, "ZELDA", 1 },
+	{ "2",     FLA_BLOCK_SIZE * 2,  CHK_OFFSET_MM, 8, 0, MAGIC_OFFSET_MM, "ZELDA", 1 },
+	{ "2b",    FLA_BLOCK_SIZE * 3,  CHK_OFFSET_MM, 8, 1, MAGIC_OFFSET_MM, "ZELDA", 1 },
+	{ "owl1",  FLA_BLOCK_SIZE * 4,  CHK_OFFSET_MM, 8, 0, MAGIC_OFFSET_MM, "ZELDA", 1 },
+	{ "owl1b", FLA_BLOCK_SIZE * 6,  CHK_OFFSET_MM, 8, 1, MAGIC_OFFSET_MM, "ZELDA", 1 },
+	{ "owl2",  FLA_BLOCK_SIZE * 8,  CHK_OFFSET_MM, 8, 0, MAGIC_OFFSET_MM, "ZELDA", 1 },
+	{ "owl2b", FLA_BLOCK_SIZE * 10, CHK_OFFSET_MM, 8, 1, MAGIC_OFFSET_MM, "ZELDA", 1 },
+};
+
+// 4 save files and the menu data, each followed by its backup. Save files end in
+// the signature "DA" and a checksum of the bytes before it, the menu data in "HI".
+static const SlotLayout mario_layout[] = {
+	{ "1",     0x38 * 0, CHK_OFFSET_MARIO, 8, 0, 0x34, "DA", 1 },
+	{ "1b",    0x38 * 1, CHK_OFFSET_MARIO, 8, 1, 0x34, "DA", 1 },
+	{ "2",     0x38 * 2, CHK_OFFSET_MARIO, 8, 0, 0x34, "DA", 1 },
+	{ "2b",    0x38 * 3, CHK_OFFSET_MARIO, 8, 1, 0x34, "DA", 1 },
+	{ "3",     0x38 * 4, CHK_OFFSET_MARIO, 8, 0, 0x34, "DA", 1 },
+	{ "3b",    0x38 * 5, CHK_OFFSET_MARIO, 8, 1, 0x34, "DA", 1 },
+	{ "4",     0x38 * 6, CHK_OFFSET_MARIO, 8, 0, 0x34, "DA", 1 },
+	{ "4b",    0x38 * 7, CHK_OFFSET_MARIO, 8, 1, 0x34, "DA", 1 },
+	{ "menu",  0x1C0,    0x1E,             8, 0, 0x1C, "HI", 0 },
+	{ "menub", 0x1E0,    0x1E,             8, 1, 0x1C, "HI", 0 },
+};
+
+const SlotLayout*
+getSlotLayout(Game game, int* count)
+{
+	switch (game) {
+		case Ocarina:
+			*count = sizeof(oot_layout) / sizeof(oot_layout[0]);
+			return oot_layout;
+		case Majora:
+			*count = sizeof(maj_layout) / sizeof(maj_layout[0]);
+			return maj_layout;
+		case Mario:
+			*count = sizeof(mario_layout) / sizeof(mario_layout[0]);
+			return mario_layout;
+	}
+	*count = 0;
+	return NULL;
+}
+
+// checks one block, which has to lie inside the image
+void
+checkBlock(const uint8_t* block, const SlotLayout* slot, SlotCheck* result)
+{
+	result->layout = slot;
+	result->present = memcmp(block + slot->magicOffset, slot->magic, strlen(slot->magic)) == 0;
+	result->stored = (uint16_t)(block[slot->chkOffset] << 8 | block[slot->chkOffset + 1]);
+	result->actual = slot->width == 16 ? checksumWords16(block, slot->chkOffset)
+	                                   : checksumBytes(block, slot->chkOffset);
+	STATS_COUNT(CounterChecksumBytes, slot->chkOffset);
+}
+
+// checks every slot and backup of an image in one pass, returns the number of blocks checked
+int
+verifyImage(const uint8_t* data, size_t size, Game game, SlotCheck* results)
+{
+	return verifyImageDedup(data, size, game, results, NULL, NULL, NULL);
+}
+
+// claims the slot of a block hash, or finds the one another thread claimed. NULL when the
+// probe limit is hit, and the block is then summed without the table.
+static DedupSlot*
+findDedupSlot(DedupTable* table, uint64_t key, int* owner)
+{
+	size_t index = (size_t)key & table->mask;
+
+	for (int probe = 0; probe < DEDUP_MAX_PROBES; probe++, index = (index + 1) & table->mask) {
+		DedupSlot* slot = &table->slots[index];
+		uint64_t current = slot->key;
+		if (current == 0) {
+			current = atomicCompareSwap64(&slot->key, 0, key);
+			if (current == 0) {
+				*owner = 1;
+				return slot;
+			}
+		}
+		if (current == key) {
+			*owner = 0;
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+// Like verifyImage, but with a table the checksum of a block is looked up by the block's hash
+// first, and only summed the first time the scan sees those bytes. hashes receives the hash of
+// each block checked, and reused the number of checksums taken from the table.
+int
+verifyImageDedup(const uint8_t* data, size_t size, Game game, SlotCheck* results, DedupTable* table,
+                 uint64_t* hashes, int* reused)
+{
+	int count = 0;
+	int checked = 0;
+	const SlotLayout* layout = getSlotLayout(game, &count);
+	STATS_BEGIN(start);
+
+	if (reused) {
+		*reused = 0;
+	}
+	for (int i = 0; i < count && i < MAX_SLOT_BLOCKS; i++) {
+		const SlotLayout* slot = &layout[i];
+		if (slot->offset + slot->chkOffset + sizeof(uint16_t) > size) {
+			break;
+		}
+		const uint8_t* block = data + slot->offset;
+		SlotCheck* result = &results[checked];
+
+		if (!table) {
+			checkBlock(block, slot, result);
+			checked++;
+			continue;
+		}
+
+		// the sum width is part of the key: the same bytes give different 8 and 16 bit sums
+		uint64_t hash = hashBlock64(block, slot->chkOffset, slot->width);
+		hash |= hash == 0;
+		hashes[checked] = hash;
+		int owner = 0;
+		DedupSlot* shared = findDedupSlot(table, hash, &owner);
+		uint32_t known = shared && !owner ? atomicLoad32(&shared->result) : 0;
+		if (known & DEDUP_READY) {
+			result->layout = slot;
+			result->present = memcmp(block + slot->magicOffset, slot->magic, strlen(slot->magic)) == 0;
+			result->stored = (uint16_t)(block[slot->chkOffset] << 8 | block[slot->chkOffset + 1]);
+			result->actual = (uint16_t)known;
+			(*reused)++;
+		} else {
+			checkBlock(block, slot, result);
+			if (owner) {
+				atomicStore32(&shared->result, DEDUP_READY | result->actual);
+			}
+		}
+		checked++;
+	}
+	STATS_END(StageChecksum, start);
+	return checked;
+}
+
+// matches every checked block with its backup (named like it, plus "b") and compares the two
+int
+pairSlots(const uint8_t* data, const SlotCheck* checks, int count, SlotPair* pairs)
+{
+	int paired = 0;
+
+	for (int i = 0; i < count; i++) {
+		const SlotLayout* primary = checks[i].layout;
+		size_t nameLen = strlen(primary->name);
+		if (primary->backup) {
+			continue;
+		}
+
+		for (int j = i + 1; j < count; j++) {
+			const SlotLayout* backup = checks[j].layout;
+			if (!backup->backup || strncmp(backup->name, primary->name, nameLen) != 0
+			    || strcmp(backup->name + nameLen, "b") != 0) {
+				continue;
+			}
+
+			SlotPair* pair = &pairs[paired++];
+			int primaryOK = checks[i].present && checks[i].stored == checks[i].actual;
+			int backupOK = checks[j].present && checks[j].stored == checks[j].actual;
+
+			pair->primary = &checks[i];
+			pair->backup = &checks[j];
+			pair->length = primary->chkOffset + sizeof(uint16_t);
+			pair->firstDiff = (uint32_t)compareBlocks(data + primary->offset, data + backup->offset, pair->length);
+			if (!checks[i].present && !checks[j].present) {
+				pair->status = PairEmpty;
+			} else if (primaryOK && backupOK) {
+				pair->status = pair->firstDiff == pair->length ? PairSynced : PairDiverged;
+			} else if (primaryOK) {
+				pair->status = PairPrimary;
+			} else if (backupOK) {
+				pair->status = PairBackup;
+			} else {
+				pair->status = PairCorrupt;
+			}
+			break;
+		}
+	}
+	return paired;
+}
+
+const char*
+getPairStatus(PairStatus status)
+{
+	switch (status) {
+		case PairSynced:   return "SYNCED";
+		case PairDiverged: return "DIVERGED";
+		case PairPrimary:  return "PRIMARY";
+		case PairBackup:   return "BACKUP";
+		case PairCorrupt:  return "CORRUPT";
+		case PairEmpty:    return "EMPTY";
+	}
+	return "UNKNOWN";
+}
+
+void
+printHeader(const ootHeader* header)
+{
+    printf("ID: ");  // Last 5 bytes contain string "ZELDA"
+    for (int i = 0; i < 4; i++) {
+        printf("0x%x ", (unsigned char)header->id[i]);
+    }
+    for (int i = 4; i < sizeof(header->id); i++) {
+        putc(header->id[i], stdout);
+    } putc('\n', stdout);
+
+    printf( ANSI_BG_CYAN ANSI_COLOR_BLACK "       Options        " ANSI_COLOR_RESET "\n" );
+
+    char sound[16] = "";
+    switch (header->sound) {
+    case 0x0:
+        strncpy(sound, "Stereo", 8);
+        break;
+    case 0x1:
+        strncpy(sound, "Mono", 8);
+        break;
+    case 0x2:
+        strncpy(sound, "Headset", 8);
+        break;
+    case 0x3:
+        strncpy(sound, "Surround", 16);
+        break;
+    default:
+        strncpy(sound, "Unknown", 8);
+        break;
+    } printf("Sound: %s\n", sound);
+   
+    char ztarget[8] = "";
+    switch (header->ztarget) {
+    case 0x0:
+        strcpy(ztarget, "Switch");
+        break;
+    case 0x1:
+        strcpy(ztarget, "Hold");
+        break;
+    default:
+        strcpy(ztarget, "Unknown");
+        break;
+    } printf("Z Target: %s\n", ztarget);
+
+    char language[8] = "";
+    switch (header->language) {
+        case 0x0:
+            strcpy(language, "English");
+            break;
+        case 0x1:
+            strcpy(language, "German");
+            break;
+        case 0x2:
+            strcpy(language, "French");
+            break;
+        default:
+            strcpy(language, "Unknown");
+            break;
+    } printf("Language: %s\n", language);
+}
+
+void
+printWelcome(const char* title, const char* description)
+{
+	printf( ANSI_BG_CYAN ANSI_COLOR_BLACK"****************************************************************"ANSI_COLOR_RESET "\n");
+	printf( ANSI_BG_CYAN ANSI_COLOR_BLACK" %s  |  %-28s" ANSI_COLOR_RESET "\n", title, description);
+	printf( ANSI_BG_CYAN ANSI_COLOR_BLACK"****************************************************************"ANSI_COLOR_RESET "\n");
+}
+
+void printHex(const char* label, int value)
+{
+	printf("%-31s   %02x\n", label, value);
+}
+
+void printBinary(uint16_t value, size_t width)
+{
+    int space = 0;
+    for (int i = width; i > 0; i--, space++) {
+        if (space == 4) {
+            putc(' ', stdout);
+        } space %= 4;
+        putchar((value & (1 << i)) ? '1' : '0');
+    }
+    printf("\n");
+}
+
+// counts the number of '1' bits in an 8-bit unsigned integer
+int countSetBits(uint8_t b)
+{
+	b &= 0x7F;  // ignore the MSB
+#ifdef _MSC_VER
+	return (int)__popcnt(b);
+#else
+	return __builtin_popcount(b);
+#endif
+}
+
+void
+printSave_oot(ootSave* savedata, FileInfo* file, int slot)
+{
+    // Byteswap variables
+    uint32_t entranceIndex = be32(savedata->entranceIndex);
+    uint32_t ageModifier = be32(savedata->ageModifier);
+    uint16_t cutscene = be16(savedata->cutscene);
+    uint16_t worldTime = be16(savedata->worldTime);
+    uint32_t nightFlag = be32(savedata->nightFlag);
+    uint16_t deathCounter = be16(savedata->deathCounter);
+    uint16_t diskDriveOnly = be16(savedata->diskDriveOnly);
+    uint16_t heartContainers = be16(savedata->heartContainers);
+    uint16_t currentHealth = be16(savedata->currentHealth);
+    uint16_t rupees = be16(savedata->rupees);
+    uint16_t naviTimer = be16(savedata->naviTimer);
+    uint16_t currentlyEquippedEquipment = be16(savedata->currentlyEquippedEquipment);
+    uint16_t savedSceneIndex = be16(savedata->savedSceneIndex);
+    uint16_t obtainedEquipment = be16(savedata->obtainedEquipment);
+    uint32_t obtainedUpgrades = be32(savedata->obtainedUpgrades);
+    uint32_t questStatusItems = be32(savedata->questStatusItems);
+    uint16_t doubleDefenseHearts = be16(savedata->doubleDefenseHearts);
+    uint16_t goldSkulltulaTokens = be16(savedata->goldSkulltulaTokens);
+    uint32_t bigPoePoints = be32(savedata->bigPoePoints);
+    uint32_t checksum = be16(savedata->checksum);
+
+    // Print calls
+    printf( "\n" ANSI_BG_CYAN ANSI_COLOR_BLACK "    File #%d    " ANSI_COLOR_RESET "\n", slot + 1);
+    printf("Entrance Index:                 ");
+    printLocationString(entranceIndex);
+    printf("Age Modifier:                   %s\n", ageModifier ? "Child" : "Adult");
+    printf("Cutscene:                       %04x\n", cutscene);
+    printf("World Time:                     %04x\n", worldTime);
+    printf("Night Flag:                     %s\n", nightFlag ? "Night" : "Day");
+    printf("Magic String:                   %s\n", savedata->id);
+    printf("Death Counter:                  %d\n", deathCounter);
+    printf("Player Name:                    ");
+    decodePlayerName(savedata->playerName, file->charset, stdout);
+    printf("Disk Drive Only:                %04x\n", diskDriveOnly);
+    printf("Current Health:                 %d/%d\n", currentHealth / 0x10, heartContainers / 0x10);
+    printf("Magic Meter Size:               %x\n", savedata->magicMeterSize);
+    printf("Current Magic:                  %.2f%%\n", ((double)savedata->currentMagic / (double)0x60) * 100.0);
+    printf("Rupees:                         %03d\n", rupees);
+    printf("Biggoron Sword Flag 1:          %s\n", savedata->biggoronSwordFlag1 ? "True" : "False");
+    printf("Navi Timer:                     %04x\n", naviTimer);
+    printf("Magic Flag 1:                   %s\n", savedata->magicFlag1 ? "True" : "False");
+    printf("Magic Flag 2:                   %s\n", savedata->magicFlag2 ? "True" : "False");
+    printf("Biggoron Sword Flag 2:          %x\n", savedata->biggoronSwordFlag2);
+    printf("Saved Scene Index:              %04x\n", savedSceneIndex);
+
+    // currentButtonEquips is listed by --fields currentButtonEquips
+
+    printf("Currently Equipped Equipment:   %04x\n", currentlyEquippedEquipment);
+
+    // inventory is listed by --fields inventory
+
+    printf("Item Amounts:\n");
+
+    char* items[] = {
+    "Deku Stick", "Deku Nuts", "Bombs", "Arrows",
+    "?", "?", "Deku Seeds", "?", "Bombchus",
+    "?", "?", "?", "?", "?", "?", "?", "?", "?"
+    };
+    
+    for (int i = 0; i < 0xf; i++) {
+        if (savedata->itemAmounts[i]) {
+            printf(" *\t\t%-12s    %02d %s\n", "", savedata->itemAmounts[i], items[i]);
+        }
+    } putc('\n', stdout);
+
+    printf("Magic Beans Bought:             %d\n", savedata->magicBeansBought);
+    printf("Obtained Equipment:             ");
+    printBinary(obtainedEquipment, 16);
+    printf("Obtained Upgrades:              ");
+    printBinary(obtainedUpgrades, 32);
+    printf("Quest Status Items:             ");
+    printBinary(questStatusItems, 32);
+
+    // dungeonItems is listed by --fields dungeonItems
+
+    // smallKeyAmounts is listed by --fields smallKeyAmounts
+
+    printf("Double Defense Hearts:          %d\n", doubleDefenseHearts / 0x100);
+    printf("Gold Skulltula Tokens:          %d/100\n", goldSkulltulaTokens);
+    printf("Big Poe Points:                 %d/10\n", bigPoePoints/100);
+
+    // eventChkInf is listed by --fields eventChkInf
+
+    // itemGetInf is listed by --fields itemGetInf
+
+    // infTable is listed by --fields infTable
+}
+
+void
+printSave_maj(majSave* savedata)
+{
+	// Byteswap integer variables to host byte order
+	uint32_t entranceIndex = be32(savedata->entranceIndex);
+	uint32_t cutscene = be32(savedata->cutscene);
+	uint16_t worldTime = be16(savedata->worldTime);
+	uint16_t owlSaveLocation = be16(savedata->owlSaveLocation);
+	uint32_t nightFlag = be32(savedata->nightFlag);
+	uint32_t currentDay = be32(savedata->currentDay);
+	uint16_t heartContainers = be16(savedata->heartContainers);
+	uint16_t currentHealth = be16(savedata->currentHealth);
+	uint16_t rupees = be16(savedata->rupees);
+	uint16_t swordHealth = be16(savedata->swordHealth);
+	
+	// Print save file data
+	printf("Entrance Index:                 ");
+	printLocationString(entranceIndex);
+	printf("Equipped Mask:                  %02x\n", savedata->equippedMask);
+	printf("Age Modifier:                   %s\n", savedata->ageModifier ? "Child" : "Adult");
+	printf("Cutscene Number:                %08x\n", cutscene);
+	printf("World Time:                     %04x\n", worldTime);
+	printf("Owl Save Location:              %04x\n", owlSaveLocation);
+	printf("Night Flag:                     %s\n", nightFlag ? "Night" : "Day");
+	printf("Current Day:                    %x\n", currentDay);
+	printf("Player Form:                    %02x\n", savedata->playerForm);
+	printf("Have Tatl:                      %s\n", savedata->haveTatl ? "Yes" : "No");
+	printf("Is Owl Save?:                   %s\n", savedata->isOwlSave ? "Yes" : "No");
+	printf("Magic String:                   %s\n", savedata->id);
+	printf("Player Name:                    ");
+	decodePlayerName(savedata->playerName, PAL, stdout);
+	printf("Current Health:                 %d/%d\n", currentHealth / 0x10, heartContainers / 0x10);
+	printf("Magic Meter Size:               %d\n", savedata->magicMeterSize);
+	printf("Current Magic:                  %.2f%%\n", ((double)savedata->currentMagic / (double)0x60) * 100.0);
+	printf("Rupees:                         %03d\n", rupees);
+	printf("Sword Health:                   %02x\n", swordHealth);
+	printf("Double Defense Hearts:          %02x\n", savedata->doubleDefenseHearts);
+}
+
+// Star flags of each course in a Mario save file. Bit 7 of a course byte is its cannon, so
+// only the low 7 bits are stars. The castle's own stars (Toad and MIPS) sit in the first flags byte.
+typedef struct {
+	const char*   name;
+	uint8_t       starOffset;
+	uint8_t       scoreOffset;      // coin score, 0 for the courses without one
+	uint8_t       maxStars;
+} MarioCourse;
+
+#define MARIO_STAGE(label, stars, score) { label, offsetof(marioSave, stars), offsetof(marioSave, score), 7 }
+#define MARIO_SECRET(label, stars, max)   { label, offsetof(marioSave, stars), 0, max }
+
+static const MarioCourse mario_courses[] = {
+	MARIO_STAGE("Bomb-omb Battlefield",         stage1,  score1),
+	MARIO_STAGE("Whomp's Fortress",             stage2,  score2),
+	MARIO_STAGE("Jolly Roger Bay",              stage3,  score3),
+	MARIO_STAGE("Cool Cool Mountain",           stage4,  score4),
+	MARIO_STAGE("Big Boo's Haunt",              stage5,  score5),
+	MARIO_STAGE("Hazy Maze Cave",               stage6,  score6),
+	MARIO_STAGE("Lethal Lava Land",             stage7,  score7),
+	MARIO_STAGE("Shifting Sand Land",           stage8,  score8),
+	MARIO_STAGE("Dire Dire Docks",              stage9,  score9),
+	MARIO_STAGE("Snowman's Land",               stage10, score10),
+	MARIO_STAGE("Wet Dry World",                stage11, score11),
+	MARIO_STAGE("Tall Tall Mountain",           stage12, score12),
+	MARIO_STAGE("Tiny Huge Island",             stage13, score13),
+	MARIO_STAGE("Tick Tock Clock",              stage14, score14),
+	MARIO_STAGE("Rainbow Ride",                 stage15, score15),
+	MARIO_SECRET("Bowser in the Dark World",    bowser1RedCoins,        1),
+	MARIO_SECRET("Bowser in the Fire Sea",      bowser2RedCoins,        1),
+	MARIO_SECRET("Bowser in the Sky",           bowser3RedCoins,        1),
+	MARIO_SECRET("Princess's Secret Slide",     princessSecretSlide,    2),
+	MARIO_SECRET("Cavern of the Metal Cap",     metalCapRedCoins,       1),
+	MARIO_SECRET("Tower of the Wing Cap",       wingCapRedCoins,        1),
+	MARIO_SECRET("Vanish Cap under the Moat",   vanishCapRedCoins,      1),
+	MARIO_SECRET("Wing Mario over the Rainbow", marioWingsRedCoins,     1),
+	MARIO_SECRET("Secret Aquarium",             princessSecretAquarium, 1),
+	MARIO_SECRET("Castle (Toad and MIPS)",      castleStars,            5),
+};
+
+#define MARIO_STAGES 15                // the courses with coin scores come first
+#define MARIO_COURSE_COUNT (sizeof(mario_courses) / sizeof(mario_courses[0]))
+
+// Menu data block: the age of each file's coin scores, then the sound mode
+#define MARIO_MENU_COIN_AGES 0x00
+#define MARIO_MENU_SOUND     0x10
+
+int
+countMarioStars(const uint8_t* block)
+{
+	int stars = 0;
+	for (size_t i = 0; i < MARIO_COURSE_COUNT; i++) {
+		stars += countSetBits(block[mario_courses[i].starOffset]);
+	}
+	return stars;
+}
+
+int
+sumMarioCoins(const uint8_t* block)
+{
+	int coins = 0;
+	for (size_t i = 0; i < MARIO_STAGES; i++) {
+		coins += block[mario_courses[i].scoreOffset];
+	}
+	return coins;
+}
+
+// Checks all 10 blocks of the EEPROM and picks the copy of each file and of the menu data the
+// game would load. Returns the number of files holding a valid save.
+int
+decodeMarioEeprom(const SaveImage* image, MarioEeprom* eeprom)
+{
+	int layoutCount = 0;
+	const SlotLayout* layout = getSlotLayout(Mario, &layoutCount);
+	int used = 0;
+
+	memset(eeprom, 0, sizeof(MarioEeprom));
+	checkSaveData(image, 1, &eeprom->report);
+
+	for (int i = 0; i < eeprom->report.pairCount; i++) {
+		const SlotPair* pair = &eeprom->report.pairs[i];
+		int fromBackup = pair->status == PairBackup;
+		const uint8_t* data = NULL;
+
+		if (pair->status != PairEmpty && pair->status != PairCorrupt) {
+			data = image->data + (fromBackup ? pair->backup : pair->primary)->layout->offset;
+		}
+		if (!pair->primary->layout->hasFields) {
+			eeprom->menuPair = pair;
+			eeprom->menu = data;
+			eeprom->menuFromBackup = fromBackup;
+			continue;
+		}
+
+		// the layout lists each file and then its backup
+		MarioFile* file = &eeprom->files[(pair->primary->layout - layout) / 2];
+		file->pair = pair;
+		file->data = data;
+		file->fromBackup = fromBackup;
+		if (data) {
+			file->stars = countMarioStars(data);
+			file->coins = sumMarioCoins(data);
+			used++;
+		}
+	}
+	return used;
+}
+
+// Function to print all values
+void printSave_mario(marioSave* savedata)
+{
+	const uint8_t* block = (const uint8_t*)savedata;
+
+	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Cap Position Data " ANSI_COLOR_RESET "\n");
+	printf("capLevel  %26u\n", savedata->capLevel);
+	printf("capArea   %26u\n", savedata->capArea);
+	printf("capPos_x  %26d\n", (int16_t)be16(savedata->capPos_x));
+	printf("capPos_y  %26d\n", (int16_t)be16(savedata->capPos_y));
+	printf("capPos_z  %26d\n", (int16_t)be16(savedata->capPos_z));
+
+	 printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Castle Flags " ANSI_COLOR_RESET "\n");
+    printf("%-27s", "castleStars: ");
+	printBinary(savedata->castleStars, 8);
+	printf("%-27s", "castleFlag: ");
+	printBinary(savedata->castleFlag1, 8);
+	printf("%-27s", "castleFlag2: ");
+	printBinary(savedata->castleFlag2, 8);
+	printf("%-27s", "castleFlag3: ");
+	printBinary(savedata->castleFlag3, 8);
+
+	// Levels
+	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Levels                  Coins  Stars " ANSI_COLOR_RESET "\n");
+	for (size_t i = 0; i < MARIO_STAGES; i++) {
+		const MarioCourse* course = &mario_courses[i];
+		printf("%-26s %03d %3d/%d\n", course->name, block[course->scoreOffset],
+		       countSetBits(block[course->starOffset]), course->maxStars);
+	}
+
+	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Castle Secret Stars " ANSI_COLOR_RESET "\n");
+	for (size_t i = MARIO_STAGES; i < MARIO_COURSE_COUNT; i++) {
+		const MarioCourse* course = &mario_courses[i];
+		printf("%-30s %3d/%d\n", course->name, countSetBits(block[course->starOffset]), course->maxStars);
+	}
+	printf("%-30s %3d/120\n", "Total Stars", countMarioStars(block));
+
+	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Signature " ANSI_COLOR_RESET "\n");
+    printf("magicNumber: 0x%04X\n", be16(savedata->magicNumber));
+}
+
+void
+printMarioMenu(const uint8_t* block)
+{
+	static const char* soundModes[] = { "Stereo", "Mono", "Headset" };
+	uint16_t sound = (uint16_t)(block[MARIO_MENU_SOUND] << 8 | block[MARIO_MENU_SOUND + 1]);
+
+	printf("Sound Mode:                     %s\n", sound < 3 ? soundModes[sound] : "Unknown");
+	for (int i = 0; i < MARIO_FILES; i++) {
+		printf("File %d Coin Score Age:          %u\n", i + 1,
+		       readField(block + MARIO_MENU_COIN_AGES + i * 4, 4, BigE));
+	}
+}
+
+// one line per save file, then the menu data
+void
+printMarioEeprom(const MarioEeprom* eeprom)
+{
+	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Save Files   Stars  Coins  Copies    " ANSI_COLOR_RESET "\n");
+	for (int i = 0; i < MARIO_FILES; i++) {
+		const MarioFile* file = &eeprom->files[i];
+		const char* status = file->pair ? getPairStatus(file->pair->status) : "MISSING";
+
+		if (file->data) {
+			printf("File %d       %3d/120  %5d  %s\n", i + 1, file->stars, file->coins, status);
+		} else {
+			printf("File %d       %7s  %5s  %s\n", i + 1, "-", "-", status);
+		}
+	}
+
+	printf( "\n" ANSI_COLOR_BLACK ANSI_BG_CYAN " Menu Data " ANSI_COLOR_RESET "\n");
+	if (eeprom->menu) {
+		printMarioMenu(eeprom->menu);
+	}
+	printf("Copies:                         %s\n",
+	       eeprom->menuPair ? getPairStatus(eeprom->menuPair->status) : "MISSING");
+}
+
+// Field schema of each save structure, in slot order
+static const SaveField oot_fields[] = {
+	SAVE_FIELD(ootSave, entranceIndex,              FormatHex),
+	SAVE_FIELD(ootSave, ageModifier,                FormatDec),
+	SAVE_FIELD(ootSave, cutscene,                   FormatHex),
+	SAVE_FIELD(ootSave, worldTime,                  FormatHex),
+	SAVE_FIELD(ootSave, nightFlag,                  FormatBool),
+	SAVE_ARRAY(ootSave, id,                         FormatText),
+	SAVE_FIELD(ootSave, deathCounter,               FormatDec),
+	SAVE_ARRAY(ootSave, playerName,                 FormatName),
+	SAVE_FIELD(ootSave, diskDriveOnly,              FormatHex),
+	SAVE_FIELD(ootSave, heartContainers,            FormatDec),
+	SAVE_FIELD(ootSave, currentHealth,              FormatDec),
+	SAVE_FIELD(ootSave, magicMeterSize,             FormatDec),
+	SAVE_FIELD(ootSave, currentMagic,               FormatDec),
+	SAVE_FIELD(ootSave, rupees,                     FormatDec),
+	SAVE_FIELD(ootSave, biggoronSwordFlag1,         FormatBool),
+	SAVE_FIELD(ootSave, naviTimer,                  FormatHex),
+	SAVE_FIELD(ootSave, magicFlag1,                 FormatBool),
+	SAVE_FIELD(ootSave, magicFlag2,                 FormatBool),
+	SAVE_FIELD(ootSave, biggoronSwordFlag2,         FormatHex),
+	SAVE_FIELD(ootSave, savedSceneIndex,            FormatHex),
+	SAVE_ARRAY(ootSave, currentButtonEquips,        FormatHex),
+	SAVE_FIELD(ootSave, currentlyEquippedEquipment, FormatHex),
+	SAVE_ARRAY(ootSave, inventory,                  FormatHex),
+	SAVE_ARRAY(ootSave, itemAmounts,                FormatDec),
+	SAVE_FIELD(ootSave, magicBeansBought,           FormatDec),
+	SAVE_FIELD(ootSave, obtainedEquipment,          FormatBinary),
+	SAVE_FIELD(ootSave, obtainedUpgrades,           FormatBinary),
+	SAVE_FIELD(ootSave, questStatusItems,           FormatBinary),
+	SAVE_ARRAY(ootSave, dungeonItems,               FormatHex),
+	SAVE_ARRAY(ootSave, smallKeyAmounts,            FormatDec),
+	SAVE_FIELD(ootSave, doubleDefenseHearts,        FormatDec),
+	SAVE_FIELD(ootSave, goldSkulltulaTokens,        FormatDec),
+	SAVE_FIELD(ootSave, bigPoePoints,               FormatDec),
+	SAVE_ARRAY(ootSave, eventChkInf,                FormatHex),
+	SAVE_ARRAY(ootSave, itemGetInf,                 FormatHex),
+	SAVE_ARRAY(ootSave, infTable,                   FormatHex),
+	SAVE_FIELD(ootSave, checksum,                   FormatHex),
+};
+
+static const SaveField maj_fields[] = {
+	SAVE_FIELD(majSave, entranceIndex,              FormatHex),
+	SAVE_FIELD(majSave, equippedMask,               FormatHex),
+	SAVE_FIELD(majSave, ageModifier,                FormatDec),
+	SAVE_FIELD(majSave, cutscene,                   FormatHex),
+	SAVE_FIELD(majSave, worldTime,                  FormatHex),
+	SAVE_FIELD(majSave, owlSaveLocation,            FormatHex),
+	SAVE_FIELD(majSave, nightFlag,                  FormatBool),
+	SAVE_FIELD(majSave, currentDay,                 FormatDec),
+	SAVE_FIELD(majSave, playerForm,                 FormatHex),
+	SAVE_FIELD(majSave, haveTatl,                   FormatBool),
+	SAVE_FIELD(majSave, isOwlSave,                  FormatBool),
+	SAVE_ARRAY(majSave, id,                         FormatText),
+	SAVE_ARRAY(majSave, playerName,                 FormatName),
+	SAVE_FIELD(majSave, heartContainers,            FormatDec),
+	SAVE_FIELD(majSave, currentHealth,              FormatDec),
+	SAVE_FIELD(majSave, magicMeterSize,             FormatDec),
+	SAVE_FIELD(majSave, currentMagic,               FormatDec),
+	SAVE_FIELD(majSave, rupees,                     FormatDec),
+	SAVE_FIELD(majSave, swordHealth,                FormatDec),
+	SAVE_FIELD(majSave, doubleDefenseHearts,        FormatDec),
+	SAVE_FIELD(majSave, checksum,                   FormatHex),
+};
+
+static const SaveField mario_fields[] = {
+	SAVE_FIELD(marioSave, capLevel,                 FormatDec),
+	SAVE_FIELD(marioSave, capArea,                  FormatDec),
+	SAVE_FIELD(marioSave, capPos_x,                 FormatSigned),
+	SAVE_FIELD(marioSave, capPos_y,                 FormatSigned),
+	SAVE_FIELD(marioSave, capPos_z,                 FormatSigned),
+	SAVE_FIELD(marioSave, castleStars,              FormatBinary),
+	SAVE_FIELD(marioSave, castleFlag1,              FormatBinary),
+	SAVE_FIELD(marioSave, castleFlag2,              FormatBinary),
+	SAVE_FIELD(marioSave, castleFlag3,              FormatBinary),
+	SAVE_FIELD(marioSave, stage1,  FormatBinary), SAVE_FIELD(marioSave, stage2,  FormatBinary),
+	SAVE_FIELD(marioSave, stage3,  FormatBinary), SAVE_FIELD(marioSave, stage4,  FormatBinary),
+	SAVE_FIELD(marioSave, stage5,  FormatBinary), SAVE_FIELD(marioSave, stage6,  FormatBinary),
+	SAVE_FIELD(marioSave, stage7,  FormatBinary), SAVE_FIELD(marioSave, stage8,  FormatBinary),
+	SAVE_FIELD(marioSave, stage9,  FormatBinary), SAVE_FIELD(marioSave, stage10, FormatBinary),
+	SAVE_FIELD(marioSave, stage11, FormatBinary), SAVE_FIELD(marioSave, stage12, FormatBinary),
+	SAVE_FIELD(marioSave, stage13, FormatBinary), SAVE_FIELD(marioSave, stage14, FormatBinary),
+	SAVE_FIELD(marioSave, stage15, FormatBinary),
+	SAVE_FIELD(marioSave, bowser1RedCoins,          FormatHex),
+	SAVE_FIELD(marioSave, bowser2RedCoins,          FormatHex),
+	SAVE_FIELD(marioSave, bowser3RedCoins,          FormatHex),
+	SAVE_FIELD(marioSave, princessSecretSlide,      FormatHex),
+	SAVE_FIELD(marioSave, metalCapRedCoins,         FormatHex),
+	SAVE_FIELD(marioSave, wingCapRedCoins,          FormatHex),
+	SAVE_FIELD(marioSave, vanishCapRedCoins,        FormatHex),
+	SAVE_FIELD(marioSave, marioWingsRedCoins,       FormatHex),
+	SAVE_FIELD(marioSave, princessSecretAquarium,   FormatHex),
+	SAVE_FIELD(marioSave, unusedCakeScreen,         FormatHex),
+	SAVE_FIELD(marioSave, score1,  FormatDec), SAVE_FIELD(marioSave, score2,  FormatDec),
+	SAVE_FIELD(marioSave, score3,  FormatDec), SAVE_FIELD(marioSave, score4,  FormatDec),
+	SAVE_FIELD(marioSave, score5,  FormatDec), SAVE_FIELD(marioSave, score6,  FormatDec),
+	SAVE_FIELD(marioSave, score7,  FormatDec), SAVE_FIELD(marioSave, score8,  FormatDec),
+	SAVE_FIELD(marioSave, score9,  FormatDec), SAVE_FIELD(marioSave, score10, FormatDec),
+	SAVE_FIELD(marioSave, score11, FormatDec), SAVE_FIELD(marioSave, score12, FormatDec),
+	SAVE_FIELD(marioSave, score13, FormatDec), SAVE_FIELD(marioSave, score14, FormatDec),
+	SAVE_FIELD(marioSave, score15, FormatDec),
+	SAVE_FIELD(marioSave, magicNumber,              FormatHex),
+	SAVE_FIELD(marioSave, checksum,                 FormatHex),
+};
+
+const SaveField*
+getFieldTable(Game game, size_t* count)
+{
+	switch (game) {
+		case Ocarina:
+			*count = sizeof(oot_fields) / sizeof(oot_fields[0]);
+			return oot_fields;
+		case Majora:
+			*count = sizeof(maj_fields) / sizeof(maj_fields[0]);
+			return maj_fields;
+		case Mario:
+			*count = sizeof(mario_fields) / sizeof(mario_fields[0]);
+			return mario_fields;
+	}
+	*count = 0;
+	return NULL;
+}
+
+const SaveField*
+findField(Game game, const char* name)
+{
+	size_t count = 0;
+	const SaveField* fields = getFieldTable(game, &count);
+
+	for (size_t i = 0; i < count; i++) {
+		if (strcmp(fields[i].name, name) == 0) {
+			return &fields[i];
+		}
+	}
+	return NULL;
+}
+
+// resolves a comma separated list of field names, returns how many were selected or -1.
+// Unless strict, names the game doesn't have are kept as NULL entries.
+int
+selectFields(Game game, const char* list, const SaveField** selected, int max, int strict)
+{
+	int count = 0;
+	const char* name = list;
+
+	while (*name) {
+		size_t len = strcspn(name, ",");
+		char buffer[64];
+
+		if (len > 0) {
+			if (len >= sizeof(buffer) || count == max) {
+				fprintf(stderr, "Too many fields selected.\n");
+				return -1;
+			}
+			memcpy(buffer, name, len);
+			buffer[len] = '\0';
+			selected[count] = findField(game, buffer);
+			if (!selected[count] && strict) {
+				fprintf(stderr, "Unknown field for %s: %s\n", getGameName(game), buffer);
+				return -1;
+			}
+			count++;
+		}
+		name += len;
+		if (*name == ',') {
+			name++;
+		}
+	}
+	return count;
+}
+
+// finds the index-th non-empty name of a field list, counted the way selectFields counts them
+const char*
+getListedField(const char* list, int index, int* len)
+{
+	const char* name = list;
+
+	for (int n = -1; ; name += strcspn(name, ",") + 1) {
+		n += name[0] != ',' && name[0] != '\0';
+		if (n == index) {
+			break;
+		}
+	}
+	*len = (int)strcspn(name, ",");
+	return name;
+}
+
+uint32_t
+readField(const uint8_t* data, int width, Endian endian)
+{
+	uint32_t value = 0;
+
+	for (int i = 0; i < width; i++) {
+		int index = endian == BigE ? i : width - 1 - i;
+		value = value << 8 | data[index];
+	}
+	return value;
+}
+
+#define RULE_MAX(name, field, limit)                { name, field, RuleAtMost, NULL, 0, limit, 0 }
+#define RULE_MIN(name, field, limit)                { name, field, RuleAtLeast, NULL, 0, limit, 0 }
+#define RULE_MAX_OF(name, field, scale, other, add) { name, field, RuleAtMost, other, scale, add, 0 }
+#define RULE_MASKED_MAX(name, field, mask, limit)   { name, field, RuleAtMost, NULL, 0, limit, mask }
+#define RULE_BITS(name, field, allowed)             { name, field, RuleBits, NULL, 0, 0, allowed }
+
+// Consistency rules of each save structure. Health and heart containers count 0x10 per heart,
+// and each level of the magic meter holds 0x30.
+static const SaveRule oot_rules[] = {
+	RULE_MIN   ("heartContainerRange",    "heartContainers",     3 * 0x10),
+	RULE_MAX   ("heartContainerRange",    "heartContainers",     20 * 0x10),
+	RULE_MAX_OF("healthOverCapacity",     "currentHealth",       1, "heartContainers", 0),
+	RULE_MAX   ("magicLevelRange",        "magicMeterSize",      2),
+	RULE_MAX_OF("magicOverMeter",         "currentMagic",        0x30, "magicMeterSize", 0),
+	RULE_MAX_OF("magicWithoutFlag",       "magicMeterSize",      2, "magicFlag1", 0),
+	RULE_MAX_OF("doubleMagicWithoutFlag", "magicMeterSize",      1, "magicFlag2", 1),
+	RULE_MAX   ("rupeesOverWallet",       "rupees",              500),
+	RULE_MAX   ("ageRange",               "ageModifier",         1),
+	RULE_MAX   ("nightFlagRange",         "nightFlag",           1),
+	// medallions, songs, stones and tokens take bits 0-23, the heart pieces (0-3) bits 28-31
+	RULE_BITS  ("questStatusUnusedBits",  "questStatusItems",    0xF0FFFFFF),
+	RULE_MASKED_MAX("heartPiecesOverflow", "questStatusItems",   0xF0000000, 0x30000000),
+	RULE_MAX   ("tokensOverMax",          "goldSkulltulaTokens", 100),
+	RULE_BITS  ("bigPoePointsOverflow",   "bigPoePoints",        0x7FFFFFFF),
+};
+
+static const SaveRule maj_rules[] = {
+	RULE_MIN   ("heartContainerRange",    "heartContainers",     3 * 0x10),
+	RULE_MAX   ("heartContainerRange",    "heartContainers",     20 * 0x10),
+	RULE_MAX_OF("healthOverCapacity",     "currentHealth",       1, "heartContainers", 0),
+	RULE_MAX   ("magicLevelRange",        "magicMeterSize",      2),
+	RULE_MAX_OF("magicOverMeter",         "currentMagic",        0x30, "magicMeterSize", 0),
+	RULE_MAX   ("rupeesOverWallet",       "rupees",              500),
+	RULE_MAX   ("dayRange",               "currentDay",          4),
+	RULE_MAX   ("formRange",              "playerForm",          4),
+	RULE_MAX   ("swordHealthRange",       "swordHealth",         100),
+	RULE_MAX   ("defenseHeartsRange",     "doubleDefenseHearts", 20),
+	RULE_MAX   ("tatlFlagRange",          "haveTatl",            1),
+	RULE_MAX   ("owlSaveFlagRange",       "isOwlSave",           1),
+};
+
+// Secret courses keep their stars in the low bits and the cannon in bit 7 like the stages
+static const SaveRule mario_rules[] = {
+	RULE_MIN   ("capPositionRange",       "capPos_x",            -0x2000),
+	RULE_MAX   ("capPositionRange",       "capPos_x",            0x2000),
+	RULE_MIN   ("capPositionRange",       "capPos_y",            -0x2000),
+	RULE_MAX   ("capPositionRange",       "capPos_y",            0x2000),
+	RULE_MIN   ("capPositionRange",       "capPos_z",            -0x2000),
+	RULE_MAX   ("capPositionRange",       "capPos_z",            0x2000),
+	RULE_BITS  ("castleStarBits",         "castleStars",         0x1F),
+	RULE_BITS  ("secretStarBits",         "bowser1RedCoins",     0x81),
+	RULE_BITS  ("secretStarBits",         "bowser2RedCoins",     0x81),
+	RULE_BITS  ("secretStarBits",         "bowser3RedCoins",     0x81),
+	RULE_BITS  ("secretStarBits",         "princessSecretSlide", 0x83),
+	RULE_BITS  ("secretStarBits",         "metalCapRedCoins",    0x81),
+	RULE_BITS  ("secretStarBits",         "wingCapRedCoins",     0x81),
+	RULE_BITS  ("secretStarBits",         "vanishCapRedCoins",   0x81),
+	RULE_BITS  ("secretStarBits",         "marioWingsRedCoins",  0x81),
+	RULE_BITS  ("secretStarBits",         "princessSecretAquarium", 0x81),
+};
+
+const SaveRule*
+getRuleTable(Game game, size_t* count)
+{
+	switch (game) {
+		case Ocarina:
+			*count = sizeof(oot_rules) / sizeof(oot_rules[0]);
+			return oot_rules;
+		case Majora:
+			*count = sizeof(maj_rules) / sizeof(maj_rules[0]);
+			return maj_rules;
+		case Mario:
+			*count = sizeof(mario_rules) / sizeof(mario_rules[0]);
+			return mario_rules;
+	}
+	*count = 0;
+	return NULL;
+}
+
+// whether name is one of a comma separated list
+static int
+listContains(const char* list, const char* name)
+{
+	size_t len = strlen(name);
+
+	while (*list) {
+		size_t item = strcspn(list, ",");
+		if (item == len && strncmp(list, name, len) == 0) {
+			return 1;
+		}
+		list += item;
+		if (*list == ',') {
+			list++;
+		}
+	}
+	return 0;
+}
+
+// Places the 4 byte read of a field so that it stays inside the slot: from the field's start
+// where it fits, otherwise ending with the field
+static int
+compileOperand(const SaveField* field, uint32_t mask, uint32_t blockSize, RuleOperand* operand)
+{
+	if (field->count != 1 || field->width > 4 || field->endian != BigE || field->format == FormatText
+	    || field->format == FormatName) {
+		return -1;
+	}
+	uint32_t bits = field->width * 8;
+	uint32_t widthMask = bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1;
+
+	if (field->offset + 4u <= blockSize) {
+		operand->offset = field->offset;
+		operand->shift = (uint8_t)(32 - bits);
+	} else if (field->offset + field->width >= 4u && field->offset + field->width <= blockSize) {
+		operand->offset = (uint16_t)(field->offset + field->width - 4);
+		operand->shift = 0;
+	} else {
+		return -1;
+	}
+	operand->reserved = 0;
+	if (field->format == FormatSigned) {
+		operand->mask = widthMask;
+		operand->sign = 1u << (bits - 1);
+	} else {
+		operand->mask = widthMask & (mask ? mask : widthMask);
+		operand->sign = 0;
+	}
+	return 0;
+}
+
+// Compiles the rules of a game named in selection (every rule when it is NULL) into a flat
+// program. Returns the number of steps, or -1 when a rule doesn't fit the field table.
+int
+compileRules(Game game, const char* selection, RuleProgram* program)
+{
+	size_t count = 0;
+	const SaveRule* rules = getRuleTable(game, &count);
+	int layoutCount = 0;
+	const SlotLayout* layout = getSlotLayout(game, &layoutCount);
+
+	memset(program, 0, sizeof(*program));
+	while (layoutCount > 0 && !layout->hasFields) {
+		layout++;
+		layoutCount--;
+	}
+	if (layoutCount == 0) {
+		return -1;
+	}
+	program->blockSize = layout->chkOffset + 2u;
+
+	for (size_t r = 0; r < count; r++) {
+		const SaveRule* rule = &rules[r];
+		if (selection && !listContains(selection, rule->name)) {
+			continue;
+		}
+		const SaveField* field = findField(game, rule->field);
+		const SaveField* other = rule->other ? findField(game, rule->other) : NULL;
+		if (!field || (rule->other && !other) || program->stepCount == RULE_MAX_STEPS) {
+			fprintf(stderr, "Rule %s of %s can't be compiled.\n", rule->name, getGameName(game));
+			return -1;
+		}
+
+		int bit = 0;
+		while (bit < program->ruleCount && strcmp(program->names[bit], rule->name) != 0) {
+			bit++;
+		}
+		if (bit == program->ruleCount) {
+			if (bit == RULE_MAX_RULES) {
+				fprintf(stderr, "Too many rules for %s.\n", getGameName(game));
+				return -1;
+			}
+			program->names[program->ruleCount++] = rule->name;
+		}
+
+		RuleStep* step = &program->steps[program->stepCount];
+		uint32_t mask = rule->kind == RuleBits ? ~rule->mask : rule->mask;
+		if (compileOperand(field, mask, program->blockSize, &step->a) != 0
+		    || (other && compileOperand(other, 0, program->blockSize, &step->b) != 0)) {
+			fprintf(stderr, "Rule %s of %s can't be compiled.\n", rule->name, getGameName(game));
+			return -1;
+		}
+		if (!other) {
+			step->b = step->a;
+		}
+		switch (rule->kind) {
+			case RuleAtMost:
+				step->factor = 1;
+				step->otherFactor = other ? -rule->scale : 0;
+				step->bias = -rule->limit;
+				break;
+			case RuleAtLeast:
+				step->factor = -1;
+				step->otherFactor = other ? rule->scale : 0;
+				step->bias = rule->limit;
+				break;
+			case RuleBits:
+				// any bit left after masking off the allowed ones breaks it
+				step->factor = 1;
+				step->otherFactor = 0;
+				step->bias = 0;
+				break;
+		}
+		step->rule = (uint32_t)bit;
+		program->sources[program->stepCount] = rule;
+		program->fields[program->stepCount][0] = field;
+		program->fields[program->stepCount][1] = other;
+		program->stepCount++;
+	}
+	return program->stepCount;
+}
+
+static inline int64_t
+loadOperand(const RuleOperand* operand, const uint8_t* block)
+{
+	const uint8_t* p = block + operand->offset;
+	uint32_t word = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+	uint32_t value = (word >> operand->shift) & operand->mask;
+
+	return (int64_t)(value ^ operand->sign) - (int64_t)operand->sign;
+}
+
+// Runs a compiled program over one save slot. Every step is the same loads, multiplies and
+// compare, so the loop has no branch on the data. Returns a bit per broken rule.
+uint64_t
+evaluateRules(const RuleProgram* program, const uint8_t* block)
+{
+	uint64_t broken = 0;
+
+	for (int i = 0; i < program->stepCount; i++) {
+		const RuleStep* step = &program->steps[i];
+		int64_t excess = step->factor * loadOperand(&step->a, block)
+		               + step->otherFactor * loadOperand(&step->b, block) + step->bias;
+		broken |= (uint64_t)(excess > 0) << step->rule;
+	}
+	return broken;
+}
+
+// Patches one "field=value" assignment into a slot of the (big endian) image.
+// The checksums are plain sums, so the stored one is adjusted by the difference
+// of the changed bytes instead of summing the whole slot again.
+int
+modifyField(SaveImage* image, int slot, const char* assignment)
+{
+	const char* equals = strchr(assignment, '=');
+	char name[64];
+
+	if (!equals || equals == assignment || (size_t)(equals - assignment) >= sizeof(name)) {
+		fprintf(stderr, "Invalid edit %s. It should look like field=value.\n", assignment);
+		return -1;
+	}
+	memcpy(name, assignment, equals - assignment);
+	name[equals - assignment] = '\0';
+
+	// array elements are written as name[index]
+	long index = 0;
+	char* bracket = strchr(name, '[');
+	if (bracket) {
+		char* close = NULL;
+		index = strtol(bracket + 1, &close, 0);
+		if (close == bracket + 1 || *close != ']' || close[1] != '\0') {
+			fprintf(stderr, "Invalid edit %s. It should look like field[index]=value.\n", assignment);
+			return -1;
+		}
+		*bracket = '\0';
+	}
+
+	const SaveField* field = findField(image->info.game, name);
+	if (!field) {
+		fprintf(stderr, "%s has no editable field named %s.\n", image->info.title, name);
+		return -1;
+	}
+	if (field->format == FormatName && bracket) {
+		fprintf(stderr, "%s is written whole, as %s=text.\n", name, name);
+		return -1;
+	}
+	if (index < 0 || index >= field->count || (field->count > 1 && !bracket && field->format != FormatName)) {
+		fprintf(stderr, "%s has %d elements, pick one with %s[index].\n", name, field->count, name);
+		return -1;
+	}
+
+	// edits go to a save file's primary block, never to a backup or the menu data
+	int layoutCount = 0;
+	const SlotLayout* layout = getSlotLayout(image->info.game, &layoutCount);
+	const SlotLayout* target = NULL;
+	size_t blockOffset = getSlotOffset(image->info.game, slot);
+	for (int i = 0; i < layoutCount && slot >= 0; i++) {
+		if (layout[i].offset == blockOffset) {
+			target = &layout[i];
+			break;
+		}
+	}
+	if (!target || target->backup || !target->hasFields || blockOffset + target->chkOffset + 2 > image->size) {
+		fprintf(stderr, "Slot %d of %s isn't a save file that can be edited.\n", slot + 1, image->info.title);
+		return -1;
+	}
+
+	uint8_t* block = image->data + blockOffset;
+	uint8_t bytes[64];
+	size_t start = field->offset + index * field->width;
+	int length = field->width;
+	long long value = 0;
+
+	// names are written whole, in the region's character table
+	if (field->format == FormatName) {
+		length = field->count < (int)sizeof(bytes) ? field->count : (int)sizeof(bytes);
+		if (encodeName(equals + 1, image->info.charset, bytes, length) != 0) {
+			fprintf(stderr, "Invalid value for %s: %s needs %d characters at most, from A-Z, a-z, 0-9 and space.\n",
+			        name, equals + 1, length);
+			return -1;
+		}
+	} else {
+		char* end = NULL;
+		// signed fields take -2^(n-1)..2^(n-1)-1, every other one 0..2^n-1
+		long long limit = 1LL << (field->width * 8);
+		long long low = field->format == FormatSigned ? -(limit / 2) : 0;
+		long long high = field->format == FormatSigned ? limit / 2 - 1 : limit - 1;
+		value = strtoll(equals + 1, &end, 0);
+		if (end == equals + 1 || *end != '\0' || value < low || value > high) {
+			fprintf(stderr, "Invalid value for %s: %s\n", name, equals + 1);
+			return -1;
+		}
+		for (int i = 0; i < length; i++) {
+			bytes[i] = (uint8_t)((unsigned long long)value >> (8 * (length - 1 - i)));
+		}
+	}
+
+	uint16_t chkOffset = image->info.chkOffset;
+	int width = image->info.game == Ocarina ? 16 : 8;
+	char before[sizeof(bytes) + 1];
+	uint32_t previous = 0;
+	int32_t delta = 0;
+
+	if (field->format == FormatName) {
+		decodeName(block + start, length, image->info.charset, before);
+	}
+	for (int i = 0; i < length; i++) {
+		size_t offset = start + i;
+
+		previous = previous << 8 | block[offset];
+		if (offset < chkOffset) {
+			// high bytes of the big endian halfwords count 0x100 times in the 16-bit sum
+			int diff = bytes[i] - block[offset];
+			delta += (width == 16 && offset % 2 == 0) ? diff * 0x100 : diff;
+		}
+		block[offset] = bytes[i];
+	}
+
+	uint16_t checksum = (uint16_t)((block[chkOffset] << 8 | block[chkOffset + 1]) + delta);
+	block[chkOffset] = (uint8_t)(checksum >> 8);
+	block[chkOffset + 1] = (uint8_t)checksum;
+
+	if (bracket) {
+		snprintf(name + strlen(name), sizeof(name) - strlen(name), "[%ld]", index);
+	}
+	if (field->format == FormatName) {
+		printf("%-31s %s -> %s\n", name, before, equals + 1);
+	} else if (field->format == FormatSigned) {
+		// sign extend the old value from the field's width
+		long long sign = 1LL << (length * 8 - 1);
+		printf("%-31s %lld -> %lld\n", name, (long long)(((previous & (2 * sign - 1)) ^ sign) - sign), value);
+	} else {
+		printf("%-31s %u -> %lld\n", name, previous, value);
+	}
+	return 0;
+}
+
+int
+runScan(int argc, char* argv[])
+{
+    const char* root = NULL;
+    const char* fieldList = NULL;
+    const char* cachePath = NULL;
+    const char* dedupPath = NULL;
+    const char* namesPath = NULL;
+    OutputFormat format = OutputHuman;
+    ScanQueue queue = { 0 };
+    DedupTable dedup = { 0 };
+    int stats = 0;
+    int jobs = getCpuCount();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scan") == 0 && i + 1 < argc) {
+            root = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cachePath = argv[++i];
+        } else if (strcmp(argv[i], "--dedup") == 0 && i + 1 < argc) {
+            dedupPath = argv[++i];
+        } else if (strcmp(argv[i], "--names") == 0 && i + 1 < argc) {
+            namesPath = argv[++i];
+            queue.names = 1;
+        } else if (strcmp(argv[i], "--all-slots") == 0) {
+            queue.allSlots = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = 1;
+        } else if (strcmp(argv[i], "--fields") == 0 && i + 1 < argc) {
+            fieldList = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (parseOutputFormat(argv[++i], &format) != 0) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Unknown scan option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!root) {
+        fprintf(stderr, "Usage: %s --scan <dir|list> [--jobs N] [--fields field,field...] [--format human|json|csv]"
+                        " [--cache file] [--dedup report] [--names index] [--all-slots] [--stats]\n", argv[0]);
+        return 1;
+    }
+    if (jobs < 1) jobs = 1;
+    if (jobs > SCAN_MAX_THREADS) jobs = SCAN_MAX_THREADS;
+
+    queue.format = format;
+    if (fieldList) {
+        int selected = 0;
+        for (Game game = Ocarina; game <= Mario; game++) {
+            queue.fieldCount[game] = selectFields(game, fieldList, queue.fields[game], MAX_SELECTED_FIELDS, 0);
+            for (int f = 0; f < queue.fieldCount[game]; f++) {
+                selected += queue.fields[game][f] != NULL;
+            }
+        }
+        if (queue.fieldCount[Ocarina] < 0 || selected == 0) {
+            fprintf(stderr, "None of the fields %s exist in any game.\n", fieldList);
+            return 1;
+        }
+        // a column no game has would stay empty, and it has no name for the CSV header
+        int kept = 0;
+        for (int f = 0; f < queue.fieldCount[Ocarina]; f++) {
+            int known = 0;
+            for (Game game = Ocarina; game <= Mario; game++) {
+                known |= queue.fields[game][f] != NULL;
+            }
+            if (!known) {
+                int len = 0;
+                const char* name = getListedField(fieldList, f, &len);
+                fprintf(stderr, "Skipping the field %.*s, no game has it.\n", len, name);
+                continue;
+            }
+            for (Game game = Ocarina; game <= Mario; game++) {
+                queue.fields[game][kept] = queue.fields[game][f];
+            }
+            kept++;
+        }
+        for (Game game = Ocarina; game <= Mario; game++) {
+            queue.fieldCount[game] = kept;
+        }
+    }
+    if (collectSaveFiles(root, &queue) != 0) {
+        return 1;
+    }
+    // a pack already carries the checksum status of its members, and they have no file stamps
+    if (queue.pack.file.data) {
+        cachePath = NULL;
+    }
+    if (dedupPath) {
+        if (initDedupTable(&dedup, queue.count * MAX_SLOT_BLOCKS) != 0) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            releaseQueue(&queue);
+            return 1;
+        }
+        queue.dedup = &dedup;
+    }
+
+    // The cache only holds checksum results, so field output and pair compares always read the files
+    ScanCache cache = { 0 };
+    if (cachePath) {
+        openScanCache(cachePath, &cache);
+        queue.cache = &cache;
+        queue.useCache = fieldList == NULL && !queue.allSlots && !dedupPath;
+    }
+    if ((size_t)jobs > queue.count) {
+        jobs = queue.count ? (int)queue.count : 1;
+    }
+
+    if (format == OutputCsv) {
+        OutBuf header = { 0 };
+        const char* names[MAX_SELECTED_FIELDS];
+        for (int f = 0; f < queue.fieldCount[Ocarina]; f++) {
+            Game game = Ocarina;
+            while (!queue.fields[game][f]) {
+                game++;
+            }
+            names[f] = queue.fields[game][f]->name;
+        }
+        renderCsvHeader(&header, names, queue.fieldCount[Ocarina]);
+        outFlush(&header, stdout);
+        outFree(&header);
+    }
+
+    ScanWorker workers[SCAN_MAX_THREADS] = { 0 };
+    double start = getTimeSeconds();
+
+    for (int i = 0; i < jobs; i++) {
+        workers[i].queue = &queue;
+        workers[i].stats = stats ? calloc(1, sizeof(StageStats)) : NULL;
+        // anything at least SAVE_MAP_THRESHOLD bytes is mapped, so this holds any image read
+        arenaInit(&workers[i].arena, malloc(SAVE_MAP_THRESHOLD), SAVE_MAP_THRESHOLD);
+#ifdef _WIN32
+        workers[i].thread = CreateThread(NULL, 0, scanThread, &workers[i], 0, NULL);
+#else
+        pthread_create(&workers[i].thread, NULL, scanThread, &workers[i]);
+#endif
+    }
+
+    ScanWorker total = { 0 };
+    StageStats* merged = stats ? calloc(1, sizeof(StageStats)) : NULL;
+    for (int i = 0; i < jobs; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(workers[i].thread, INFINITE);
+        CloseHandle(workers[i].thread);
+#else
+        pthread_join(workers[i].thread, NULL);
+#endif
+        total.files  += workers[i].files;
+        total.errors += workers[i].errors;
+        total.slots  += workers[i].slots;
+        total.failed += workers[i].failed;
+        total.cached += workers[i].cached;
+        total.reused += workers[i].reused;
+        total.refCount += workers[i].refCount;
+        outFree(&workers[i].out);
+        free(workers[i].arena.base);
+        if (merged && workers[i].stats) {
+            statsMerge(merged, workers[i].stats);
+        }
+        free(workers[i].stats);
+    }
+
+    double elapsed = getTimeSeconds() - start;
+    fflush(stdout);
+    if (cachePath) {
+        saveScanCache(&cache, workers, jobs);
+        closeScanCache(&cache);
+    }
+    for (int i = 0; i < jobs; i++) {
+        free(workers[i].added);
+    }
+    if (dedupPath) {
+        size_t unique = 0, groups = 0;
+        if (writeDedupReport(dedupPath, format, &queue, workers, jobs, &unique, &groups) == 0) {
+            fprintf(stderr, "%zu blocks, %zu distinct, %zu checksums reused: %zu duplicate groups in %s\n",
+                    total.refCount, unique, total.reused, groups, dedupPath);
+        }
+        for (int i = 0; i < jobs; i++) {
+            free(workers[i].refs);
+        }
+        freeDedupTable(&dedup);
+    }
+    if (namesPath) {
+        size_t names = 0;
+        if (writeNameIndex(namesPath, &queue, workers, jobs, &names) == 0) {
+            fprintf(stderr, "%zu player names indexed in %s\n", names, namesPath);
+        }
+        for (int i = 0; i < jobs; i++) {
+            free(workers[i].names);
+        }
+    }
+    fprintf(stderr, "Scanned %zu files (%zu unreadable, %zu from cache), %zu slots, %zu checksum failures\n",
+            total.files + total.errors, total.errors, total.cached, total.slots, total.failed);
+    fprintf(stderr, "%.3f s with %d threads: %.1f files/sec\n", elapsed, jobs,
+            elapsed > 0.0 ? (double)(total.files + total.errors) / elapsed : 0.0);
+    if (merged) {
+        printStats(merged, elapsed, jobs, stderr);
+        free(merged);
+    }
+
+    releaseQueue(&queue);
+
+    return total.errors || total.failed ? 2 : 0;
+}
+
+THREAD_FUNC(scanThread)
+{
+    ScanWorker* worker = (ScanWorker*)arg;
+    ScanQueue* queue = worker->queue;
+
+    // each thread counts into its own block, so the hot path never shares a cache line
+    currentStats = worker->stats;
+    for (;;) {
+        long index = atomicFetchAdd(&queue->next, 1);
+        if (index < 0 || (size_t)index >= queue->count) {
+            break;
+        }
+        scanFile((size_t)index, worker);
+        // one write per file keeps the records of different threads apart
+        outFlush(&worker->out, stdout);
+    }
+    THREAD_RETURN;
+}
+
+// keeps the hash of every block of a file for the duplicate group report
+static void
+recordBlocks(ScanWorker* worker, size_t index, const SaveImage* image, const SaveReport* report,
+             const uint64_t* hashes)
+{
+    int layoutCount = 0;
+    const SlotLayout* layout = getSlotLayout(image->info.game, &layoutCount);
+
+    if (worker->refCount + report->blockCount > worker->refCapacity) {
+        size_t capacity = worker->refCapacity ? worker->refCapacity * 2 : 1024;
+        DedupRef* refs = realloc(worker->refs, capacity * sizeof(DedupRef));
+        if (!refs) {
+            return;
+        }
+        worker->refs = refs;
+        worker->refCapacity = capacity;
+    }
+    for (int i = 0; i < report->blockCount; i++) {
+        DedupRef* ref = &worker->refs[worker->refCount++];
+        ref->hash = hashes[i];
+        ref->file = (uint32_t)index;
+        ref->length = report->checks[i].layout->chkOffset;
+        ref->layout = (uint8_t)(report->checks[i].layout - layout);
+        ref->game = (uint8_t)image->info.game;
+    }
+}
+
+// keeps a decoded player name for the name index. Blank names aren't worth a lookup.
+static void
+recordName(ScanWorker* worker, size_t index, Game game, int layout, const char* name, int valid)
+{
+	size_t len = 0;
+	for (size_t i = 0; i < sizeof(((NameRef*)0)->name) && name[i] != '\0'; i++) {
+		if (name[i] != ' ') {
+			len = i + 1;
+		}
+	}
+	if (len == 0) {
+		return;
+	}
+
+	if (worker->nameCount == worker->nameCapacity) {
+		size_t capacity = worker->nameCapacity ? worker->nameCapacity * 2 : 1024;
+		NameRef* names = realloc(worker->names, capacity * sizeof(NameRef));
+		if (!names) {
+			return;
+		}
+		worker->names = names;
+		worker->nameCapacity = capacity;
+	}
+	NameRef* ref = &worker->names[worker->nameCount++];
+	memset(ref, 0, sizeof(NameRef));
+	memcpy(ref->name, name, len);
+	for (size_t i = 0; i < len; i++) {
+		ref->key[i] = name[i] >= 'a' && name[i] <= 'z' ? (char)(name[i] - 'a' + 'A') : name[i];
+	}
+	ref->file = (uint32_t)index;
+	ref->layout = (uint8_t)layout;
+	ref->game = (uint8_t)game;
+	ref->valid = (uint8_t)valid;
+}
+
+// checks every slot of one file and renders its record into the worker's buffer
+void
+scanFile(size_t index, ScanWorker* worker)
+{
+    const ScanQueue* queue = worker->queue;
+    const char* path = queue->paths[index];
+    SlotCheck checks[MAX_SLOT_BLOCKS];
+    SaveImage image;
+
+    // unchanged files are answered from the cache without opening them
+    if (queue->useCache) {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        const CacheEntry* entry = findCacheEntry(queue->cache, path, hashBytes64(path, strlen(path), 0));
+
+        if (entry && getFileStamp(path, &size, &mtime) == 0 && entry->size == size && entry->mtime == mtime) {
+            worker->cached++;
+            if (entry->status != LoadOK) {
+                worker->errors++;
+                renderError(&worker->out, queue->format, path,
+                            entry->status == LoadUnknownGame ? "UNKNOWN" : "UNREADABLE", queue->fieldCount[Ocarina]);
+                return;
+            }
+
+            int layoutCount = 0;
+            const SlotLayout* layout = getSlotLayout((Game)entry->game, &layoutCount);
+            memset(&image, 0, sizeof(image));
+            image.info.path = path;
+            image.info.game = (Game)entry->game;
+            image.info.endian = (Endian)entry->endian;
+            image.size = (size_t)entry->size;
+
+            worker->files++;
+            int filled = 0;
+            for (int i = 0; i < entry->blockCount && entry->blocks[i].layout < layoutCount; i++, filled++) {
+                checks[i].layout = &layout[entry->blocks[i].layout];
+                checks[i].stored = entry->blocks[i].stored;
+                checks[i].actual = entry->blocks[i].actual;
+                checks[i].present = entry->blocks[i].present;
+                if (checks[i].present) {
+                    worker->slots++;
+                    worker->failed += checks[i].stored != checks[i].actual;
+                    if (queue->names) {
+                        recordName(worker, index, image.info.game, entry->blocks[i].layout, entry->blocks[i].name,
+                                   checks[i].stored == checks[i].actual);
+                    }
+                }
+            }
+            renderRecord(&worker->out, queue->format, &image, checks, filled, NULL, 0, NULL, 0);
+            return;
+        }
+    }
+
+    SaveReport report;
+    arenaReset(&worker->arena);
+    LoadStatus status = loadQueuedSave(queue, index, &worker->arena, &image);
+    int count = 0;
+    if (status == LoadOK && queue->dedup) {
+        uint64_t hashes[MAX_SLOT_BLOCKS];
+        int reused = 0;
+        count = checkSaveDataDedup(&image, queue->allSlots, queue->dedup, hashes, &reused, &report);
+        worker->reused += (size_t)reused;
+        recordBlocks(worker, index, &image, &report, hashes);
+    } else if (status == LoadOK) {
+        count = checkSaveData(&image, queue->allSlots, &report);
+    }
+
+    if (queue->cache && status != LoadOpenFailed && image.mtime != 0) {
+        if (worker->addedCount == worker->addedCapacity) {
+            size_t capacity = worker->addedCapacity ? worker->addedCapacity * 2 : 64;
+            CacheRecord* added = realloc(worker->added, capacity * sizeof(CacheRecord));
+            if (added) {
+                worker->added = added;
+                worker->addedCapacity = capacity;
+            }
+        }
+        if (worker->addedCount < worker->addedCapacity) {
+            CacheRecord* record = &worker->added[worker->addedCount++];
+            record->path = path;
+            fillCacheEntry(&record->entry, &image, status, report.checks, count);
+            record->entry.pathHash = hashBytes64(path, strlen(path), 0);
+        }
+    }
+
+    if (status != LoadOK) {
+        worker->errors++;
+        renderError(&worker->out, queue->format, path, status == LoadUnknownGame ? "UNKNOWN" : "UNREADABLE",
+                    queue->fieldCount[Ocarina]);
+        return;
+    }
+
+    worker->files++;
+    const SaveField* name = queue->names ? findField(image.info.game, "playerName") : NULL;
+    for (int i = 0; i < count; i++) {
+        const SlotCheck* check = &report.checks[i];
+        if (check->present) {
+            worker->slots++;
+            worker->failed += check->stored != check->actual;
+        }
+        if (name && check->present && check->layout->hasFields) {
+            int layoutCount = 0;
+            const SlotLayout* layout = getSlotLayout(image.info.game, &layoutCount);
+            char text[sizeof(((NameRef*)0)->name) + 1];
+            decodeName(image.data + check->layout->offset + name->offset, sizeof(text) - 1, image.info.charset, text);
+            recordName(worker, index, image.info.game, (int)(check->layout - layout), text,
+                       check->stored == check->actual);
+        }
+    }
+
+    renderRecord(&worker->out, queue->format, &image, report.checks, count,
+                 queue->fields[image.info.game], queue->fieldCount[image.info.game], report.pairs, report.pairCount);
+    freeSaveData(&image);
+}
+
+static int
+hasExtension(const char* name, const char* const* extensions, size_t count)
+{
+    const char* ext = strrchr(name, '.');
+
+    if (!ext || strlen(ext) != 4) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        int match = 1;
+        for (int c = 0; c < 4; c++) {
+            char lower = (ext[c] >= 'A' && ext[c] <= 'Z') ? (char)(ext[c] + 0x20) : ext[c];
+            if (lower != extensions[i][c]) {
+                match = 0;
+                break;
+            }
+        }
+        if (match) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+hasSaveExtension(const char* name)
+{
+    static const char* const extensions[] = { ".sra", ".fla", ".eep" };
+    return hasExtension(name, extensions, sizeof(extensions) / sizeof(extensions[0]));
+}
+
+static int
+hasPakExtension(const char* name)
+{
+    static const char* const extensions[] = { ".mpk" };
+    return hasExtension(name, extensions, 1);
+}
+
+static int
+queuePath(ScanQueue* queue, const char* path)
+{
+    if (queue->count == queue->capacity) {
+        size_t capacity = queue->capacity ? queue->capacity * 2 : 256;
+        char** paths = realloc(queue->paths, capacity * sizeof(char*));
+        if (!paths) {
+            fprintf(stderr, "Memory allocation failed.\n");
+            return -1;
+        }
+        queue->paths = paths;
+        queue->capacity = capacity;
+    }
+    size_t len = strlen(path);
+    char* copy = malloc(len + 1);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed.\n");
+        return -1;
+    }
+    memcpy(copy, path, len + 1);
+    queue->paths[queue->count++] = copy;
+    return 0;
+}
+
+static int
+walkDirectory(const char* dir, ScanQueue* queue)
+{
+    char path[4096];
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    snprintf(path, sizeof(path), "%s\\*", dir);
+    HANDLE find = FindFirstFileA(path, &entry);
+    if (find == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Couldn't open directory %s\n", dir);
+        return 0;
+    }
+    do {
+        if (strcmp(entry.cFileName, ".") == 0 || strcmp(entry.cFileName, "..") == 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s\\%s", dir, entry.cFileName);
+        if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (walkDirectory(path, queue) != 0) {
+                FindClose(find);
+                return -1;
+            }
+        } else if ((queue->paks ? hasPakExtension(entry.cFileName) : hasSaveExtension(entry.cFileName))
+                   && queuePath(queue, path) != 0) {
+            FindClose(find);
+            return -1;
+        }
+    } while (FindNextFileA(find, &entry));
+    FindClose(find);
+#else
+    DIR* handle = opendir(dir);
+    if (!handle) {
+        perror(dir);
+        return 0;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+
+        int isDir = entry->d_type == DT_DIR;
+        int isFile = entry->d_type == DT_REG;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+            struct stat st;
+            if (stat(path, &st) != 0) {
+                continue;
+            }
+            isDir = S_ISDIR(st.st_mode);
+            isFile = S_ISREG(st.st_mode);
+        }
+        if (isDir) {
+            if (walkDirectory(path, queue) != 0) {
+                closedir(handle);
+                return -1;
+            }
+        } else if (isFile && (queue->paks ? hasPakExtension(entry->d_name) : hasSaveExtension(entry->d_name))
+                   && queuePath(queue, path) != 0) {
+            closedir(handle);
+            return -1;
+        }
+    }
+    closedir(handle);
+#endif
+    return 0;
+}
+
+// fills the queue from a directory tree, or from a text file with one path per line
+int
+collectSaveFiles(const char* root, ScanQueue* queue)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(root);
+    if (attributes == INVALID_FILE_ATTRIBUTES) {
+        fprintf(stderr, "Couldn't open %s\n", root);
+        return -1;
+    }
+    int isDir = (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    struct stat st;
+    if (stat(root, &st) != 0) {
+        perror(root);
+        return -1;
+    }
+    int isDir = S_ISDIR(st.st_mode);
+#endif
+    if (isDir) {
+        return walkDirectory(root, queue);
+    }
+
+    // packs only hold cartridge saves, and a single pak is listed on its own
+    if (queue->paks && hasPakExtension(root)) {
+        return queuePath(queue, root);
+    }
+    if (!queue->paks && isPackFile(root)) {
+        if (openPack(root, &queue->pack) != 0) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < queue->pack.count; i++) {
+            if (queuePath(queue, queue->pack.names + queue->pack.entries[i].nameOffset) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    FILE* list = fopen(root, "r");
+    if (!list) {
+        perror("Couldn't open the file list");
+        return -1;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), list)) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len > 0 && queuePath(queue, line) != 0) {
+            fclose(list);
+            return -1;
+        }
+    }
+    fclose(list);
+    return 0;
+}
+
+// loads the queue's index-th save, from its file or from the pack the queue was filled from
+LoadStatus
+loadQueuedSave(const ScanQueue* queue, size_t index, SaveArena* arena, SaveImage* image)
+{
+    if (queue->pack.file.data) {
+        return loadPackMember(&queue->pack, index, arena, image);
+    }
+    return loadSaveFile(queue->paths[index], arena, image);
+}
+
+void
+releaseQueue(ScanQueue* queue)
+{
+    for (size_t i = 0; i < queue->count; i++) {
+        free(queue->paths[i]);
+    }
+    free(queue->paths);
+    queue->paths = NULL;
+    queue->count = queue->capacity = 0;
+    closePack(&queue->pack);
+}
+
+int
+getCpuCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// monotonic wall clock in seconds
+double
+getTimeSeconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+// monotonic clock in nanoseconds, for the stage timers
+uint64_t
+getTimeNs(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static unsigned
+statsBucket(uint64_t ns)
+{
+    if (ns < 8) {
+        return (unsigned)ns;
+    }
+    unsigned msb = 63;
+    while (!(ns >> msb)) {
+        msb--;
+    }
+    return (msb - 2) * 8 + (unsigned)((ns >> (msb - 3)) & 7);
+}
+
+// lower bound of the latencies in a bucket
+static uint64_t
+statsBucketValue(unsigned bucket)
+{
+    if (bucket < 8) {
+        return bucket;
+    }
+    return (uint64_t)(8 + bucket % 8) << (bucket / 8 - 1);
+}
+
+// adds the time since start to a stage of the calling thread
+void
+statsRecord(Stage stage, uint64_t start)
+{
+    uint64_t elapsed = getTimeNs() - start;
+    StageTimer* timer = &currentStats->stages[stage];
+
+    timer->calls++;
+    timer->totalNs += elapsed;
+    timer->buckets[statsBucket(elapsed)]++;
+}
+
+void
+statsMerge(StageStats* into, const StageStats* from)
+{
+    for (int s = 0; s < StageCount; s++) {
+        into->stages[s].calls += from->stages[s].calls;
+        into->stages[s].totalNs += from->stages[s].totalNs;
+        for (int b = 0; b < STATS_BUCKETS; b++) {
+            into->stages[s].buckets[b] += from->stages[s].buckets[b];
+        }
+    }
+    for (int c = 0; c < CounterCount; c++) {
+        into->counters[c] += from->counters[c];
+    }
+}
+
+static uint64_t
+statsPercentile(const StageTimer* timer, double fraction)
+{
+    uint64_t rank = (uint64_t)((double)timer->calls * fraction + 0.5);
+    uint64_t seen = 0;
+
+    if (rank < 1) {
+        rank = 1;
+    }
+    for (unsigned b = 0; b < STATS_BUCKETS; b++) {
+        seen += timer->buckets[b];
+        if (seen >= rank) {
+            return statsBucketValue(b);
+        }
+    }
+    return 0;
+}
+
+void
+printStats(const StageStats* stats, double elapsed, int threads, FILE* fp)
+{
+    static const char* stageNames[StageCount] = { "load", "identify", "swap", "checksum", "render", "output" };
+    // the counter each stage's throughput is measured in, -1 for none
+    static const int stageBytes[StageCount] = {
+        CounterBytesRead, -1, CounterSwapBytes, CounterChecksumBytes, -1, CounterOutputBytes
+    };
+
+#if !SAVE64_STATS
+    fprintf(fp, "Statistics were compiled out (SAVE64_STATS=0).\n");
+    return;
+#endif
+    if (!stats) {
+        return;
+    }
+    fprintf(fp, "%-10s %10s %12s %10s %10s %12s\n", "stage", "calls", "total ms", "p50 us", "p99 us", "MB/s");
+    for (int s = 0; s < StageCount; s++) {
+        const StageTimer* timer = &stats->stages[s];
+        if (!timer->calls) {
+            continue;
+        }
+        double seconds = (double)timer->totalNs / 1e9;
+        fprintf(fp, "%-10s %10llu %12.3f %10.2f %10.2f", stageNames[s], (unsigned long long)timer->calls,
+                seconds * 1e3, (double)statsPercentile(timer, 0.50) / 1e3, (double)statsPercentile(timer, 0.99) / 1e3);
+        if (stageBytes[s] >= 0 && stats->counters[stageBytes[s]] && seconds > 0.0) {
+            fprintf(fp, " %12.1f", (double)stats->counters[stageBytes[s]] / seconds / 1e6);
+        }
+        fputc('\n', fp);
+    }
+    fprintf(fp, "files %llu, read %llu bytes in %llu syscalls, swapped %llu, checksummed %llu, output %llu bytes\n",
+            (unsigned long long)stats->counters[CounterFiles], (unsigned long long)stats->counters[CounterBytesRead],
+            (unsigned long long)stats->counters[CounterSyscalls], (unsigned long long)stats->counters[CounterSwapBytes],
+            (unsigned long long)stats->counters[CounterChecksumBytes],
+            (unsigned long long)stats->counters[CounterOutputBytes]);
+    fprintf(fp, "%.3f s wall clock over %d thread%s\n", elapsed, threads, threads == 1 ? "" : "s");
+}
+
+// the loop readSaveData used before the bulk swap: one fread and one byteswap per dword
+static void
+benchSwapLegacy(FILE* input, uint8_t* buffer, size_t size)
+{
+	uint32_t dword;
+	size_t totalBytesRead = 0;
+
+	rewind(input);
+	while (totalBytesRead < size && fread(&dword, 1, sizeof(uint32_t), input) == sizeof(uint32_t)) {
+		dword = _byteswap_ulong(dword);
+		memcpy(buffer + totalBytesRead, &dword, sizeof(uint32_t));
+		totalBytesRead += sizeof(uint32_t);
+	}
+}
+
+static void
+benchReport(const char* name, size_t size, long iterations, double elapsed)
+{
+	double bytes = (double)size * (double)iterations;
+	printf("%-16s %6zuK %12.1f MB/s %10.0f ns/image\n", name, size / 1024,
+	       elapsed > 0.0 ? bytes / elapsed / 1e6 : 0.0, elapsed * 1e9 / (double)iterations);
+}
+
+static void
+benchSwap(long iterations)
+{
+	static const size_t sizes[] = { 0x8000, 0x20000 };
+	struct { const char* name; void (*kernel)(uint8_t*, size_t); } kernels[] = {
+		{ "scalar",  swapWords32_scalar },
+#ifdef SAVE64_SSE2
+		{ "sse2",    swapWords32_sse2 },
+#endif
+#ifdef SAVE64_AVX2
+		{ "avx2",    cpuHasAvx2() ? swapWords32_avx2 : NULL },
+#endif
+		{ "dispatch", swapWords32 },
+	};
+
+	printf("Word swap, %ld iterations per kernel\n", iterations);
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		size_t size = sizes[s];
+		uint8_t* buffer = malloc(size);
+		if (!buffer) {
+			fprintf(stderr, "Memory allocation failed.\n");
+			return;
+		}
+		for (size_t i = 0; i < size; i++) {
+			buffer[i] = (uint8_t)(i * 31 + 7);
+		}
+
+		FILE* input = tmpfile();
+		if (input) {
+			fwrite(buffer, 1, size, input);
+			double start = getTimeSeconds();
+			for (long i = 0; i < iterations; i++) {
+				benchSwapLegacy(input, buffer, size);
+			}
+			benchReport("per-dword fread", size, iterations, getTimeSeconds() - start);
+			fclose(input);
+		}
+
+		// one swap of a copy a word short of the vector width, against the scalar kernel
+		uint8_t* swapped = malloc(size);
+		uint8_t* reference = malloc(size);
+		for (size_t k = 0; swapped && reference && k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+			if (!kernels[k].kernel) {
+				continue;
+			}
+			memcpy(reference, buffer, size);
+			swapWords32_scalar(reference, size - 4);
+			memcpy(swapped, buffer, size);
+			kernels[k].kernel(swapped, size - 4);
+			if (memcmp(swapped, reference, size) != 0) {
+				fprintf(stderr, "%s: result differs from the scalar kernel\n", kernels[k].name);
+			}
+		}
+		free(swapped);
+		free(reference);
+
+		for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+			if (!kernels[k].kernel) {
+				continue;
+			}
+			double start = getTimeSeconds();
+			for (long i = 0; i < iterations; i++) {
+				kernels[k].kernel(buffer, size);
+			}
+			benchReport(kernels[k].name, size, iterations, getTimeSeconds() - start);
+		}
+		free(buffer);
+	}
+}
+
+// the getChecksum16 loop before the specialized kernels: one width branch per value
+static uint16_t
+benchChecksumLegacy(const uint8_t* buffer, uint16_t cs_offset, int width)
+{
+	uint16_t offset = 0x0000;
+	uint16_t current = 0x0000;
+	uint16_t checksum = 0x0000;
+
+	while (offset < cs_offset) {
+		if (width == 16) {
+			current = (uint16_t)(*(buffer + offset) << 8 | *(buffer + offset + 1));
+			offset += sizeof(uint16_t);
+		}
+		else if (width == 8) {
+			current = (uint8_t)*(buffer + offset);
+			offset += sizeof(uint8_t);
+		}
+		checksum += current;
+	}
+	return checksum;
+}
+
+static void
+benchChecksum(long iterations)
+{
+	struct { const char* name; uint16_t (*kernel)(const uint8_t*, size_t); int width; } kernels[] = {
+		{ "scalar16", checksumWords16_scalar, 16 },
+		{ "scalar8",  checksumBytes_scalar,   8 },
+#ifdef SAVE64_SSE2
+		{ "sse2-16",  checksumWords16_sse2,   16 },
+		{ "sse2-8",   checksumBytes_sse2,     8 },
+#endif
+#ifdef SAVE64_AVX2
+		{ "avx2-16",  cpuHasAvx2() ? checksumWords16_avx2 : NULL, 16 },
+		{ "avx2-8",   cpuHasAvx2() ? checksumBytes_avx2 : NULL,   8 },
+#endif
+	};
+	const size_t size = SRA_BLOCK_SIZE;
+	uint8_t* buffer = malloc(size);
+	volatile uint16_t sink = 0;
+
+	if (!buffer) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		return;
+	}
+	for (size_t i = 0; i < size; i++) {
+		buffer[i] = (uint8_t)(i * 31 + 7);
+	}
+
+	printf("Checksum of one 0x%x byte block, %ld iterations per kernel\n", (unsigned)size, iterations);
+	for (int width = 16; width >= 8; width -= 8) {
+		double start = getTimeSeconds();
+		for (long i = 0; i < iterations; i++) {
+			sink += benchChecksumLegacy(buffer, (uint16_t)size, width);
+		}
+		benchReport(width == 16 ? "legacy16" : "legacy8", size, iterations, getTimeSeconds() - start);
+	}
+	for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+		if (!kernels[k].kernel) {
+			continue;
+		}
+		if (kernels[k].kernel(buffer, size) != benchChecksumLegacy(buffer, (uint16_t)size, kernels[k].width)) {
+			fprintf(stderr, "%s: result differs from the reference loop\n", kernels[k].name);
+		}
+		double start = getTimeSeconds();
+		for (long i = 0; i < iterations; i++) {
+			sink += kernels[k].kernel(buffer, size);
+		}
+		benchReport(kernels[k].name, size, iterations, getTimeSeconds() - start);
+	}
+	(void)sink;
+	free(buffer);
+}
+
+static void
+benchCompare(long iterations)
+{
+	struct { const char* name; size_t (*kernel)(const uint8_t*, const uint8_t*, size_t); } kernels[] = {
+		{ "scalar",  compareBlocks_scalar },
+#ifdef SAVE64_SSE2
+		{ "sse2",    compareBlocks_sse2 },
+#endif
+#ifdef SAVE64_AVX2
+		{ "avx2",    cpuHasAvx2() ? compareBlocks_avx2 : NULL },
+#endif
+	};
+	const size_t size = FLA_BLOCK_SIZE;
+	uint8_t* a = malloc(size);
+	uint8_t* b = malloc(size);
+	volatile size_t sink = 0;
+
+	if (!a || !b) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		free(a);
+		free(b);
+		return;
+	}
+	for (size_t i = 0; i < size; i++) {
+		a[i] = b[i] = (uint8_t)(i * 31 + 7);
+	}
+
+	printf("Compare of two identical 0x%x byte blocks, %ld iterations per kernel\n", (unsigned)size, iterations);
+	double start = getTimeSeconds();
+	for (long i = 0; i < iterations; i++) {
+		sink += memcmp(a, b, size) == 0;
+	}
+	benchReport("memcmp", size, iterations, getTimeSeconds() - start);
+	for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+		if (!kernels[k].kernel) {
+			continue;
+		}
+		b[size - 3] ^= 1;
+		if (kernels[k].kernel(a, b, size) != size - 3) {
+			fprintf(stderr, "%s: result differs from the reference loop\n", kernels[k].name);
+		}
+		b[size - 3] ^= 1;
+		start = getTimeSeconds();
+		for (long i = 0; i < iterations; i++) {
+			sink += kernels[k].kernel(a, b, size);
+		}
+		benchReport(kernels[k].name, size, iterations, getTimeSeconds() - start);
+	}
+	(void)sink;
+	free(a);
+	free(b);
+}
+
+// fills a big endian Ocarina of Time image with six valid slots
+static void
+benchBuildImage(uint8_t* data, size_t size)
+{
+	static const uint8_t headerId[] = { 0x98, 0x09, 0x10, 0x21, 'Z', 'E', 'L', 'D', 'A' };
+
+	memset(data, 0, size);
+	memcpy(data + 3, headerId, sizeof(headerId));
+	for (int slot = 0; slot < 6; slot++) {
+		uint8_t* block = data + SRA_HEADER_SIZE + slot * SRA_BLOCK_SIZE;
+		for (size_t i = 0; i < CHK_OFFSET_OOT; i++) {
+			block[i] = (uint8_t)(i * 7 + slot);
+		}
+		memcpy(block + 0x1C, "ZELDAZ", 6);
+		uint16_t checksum = checksumWords16(block, CHK_OFFSET_OOT);
+		block[CHK_OFFSET_OOT] = (uint8_t)(checksum >> 8);
+		block[CHK_OFFSET_OOT + 1] = (uint8_t)checksum;
+	}
+}
+
+static void
+benchOutput(long iterations)
+{
+	static const char* names[] = { "human", "json", "csv" };
+	const SaveField* fields[MAX_SELECTED_FIELDS];
+	SlotCheck checks[MAX_SLOT_BLOCKS];
+	SaveImage image = { 0 };
+	OutBuf out = { 0 };
+	uint8_t* data = malloc(0x8000);
+
+	if (!data) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		return;
+	}
+	benchBuildImage(data, 0x8000);
+	image.data = data;
+	image.size = 0x8000;
+	image.info.path = "bench/sample.sra";
+	getFileInfo(&image.info, data, image.size);
+
+	size_t tableSize = 0;
+	const SaveField* table = getFieldTable(image.info.game, &tableSize);
+	int fieldCount = 0;
+	for (size_t i = 0; i < tableSize && i < MAX_SELECTED_FIELDS; i++) {
+		fields[fieldCount++] = &table[i];
+	}
+	int count = verifyImage(data, image.size, image.info.game, checks);
+
+	printf("Output of one record (%d blocks, %d fields), %ld iterations per backend\n", count, fieldCount, iterations);
+	for (OutputFormat format = OutputHuman; format <= OutputCsv; format++) {
+		size_t bytes = 0;
+		double start = getTimeSeconds();
+		for (long i = 0; i < iterations; i++) {
+			out.len = 0;
+			renderRecord(&out, format, &image, checks, count, fields, fieldCount, NULL, 0);
+			bytes += out.len;
+		}
+		double elapsed = getTimeSeconds() - start;
+		printf("%-16s %12.0f records/s %10.1f MB/s\n", names[format],
+		       elapsed > 0.0 ? (double)iterations / elapsed : 0.0,
+		       elapsed > 0.0 ? (double)bytes / elapsed / 1e6 : 0.0);
+	}
+
+	outFree(&out);
+	free(data);
+}
+
+// splitmix64, so a seed always gives the same corpus
+static uint64_t
+nextRandom(uint64_t* state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Fills data with a big endian image of the game in which every block of the layout holds
+// a save with a valid checksum, and each backup is a copy of its primary. Returns the size.
+size_t
+buildSyntheticImage(uint8_t* data, Game game, uint64_t seed)
+{
+	static const uint8_t headerId[] = { 0x98, 0x09, 0x10, 0x21, 'Z', 'E', 'L', 'D', 'A' };
+	size_t size = getMediaSize(game);
+	int count = 0;
+	const SlotLayout* layout = getSlotLayout(game, &count);
+
+	memset(data, 0, size);
+	if (game == Ocarina) {
+		memcpy(data + 3, headerId, sizeof(headerId));
+	}
+
+	for (int i = 0; i < count; i++) {
+		const SlotLayout* slot = &layout[i];
+		uint8_t* block = data + slot->offset;
+		size_t magicLen = strlen(slot->magic);
+
+		if (slot->backup) {
+			// a primary always precedes its backup in the layouts, so the source is already built
+			size_t nameLen = strlen(slot->name) - 1;
+			for (int j = 0; j < i; j++) {
+				if (strlen(layout[j].name) == nameLen && strncmp(layout[j].name, slot->name, nameLen) == 0) {
+					memcpy(block, data + layout[j].offset, slot->chkOffset + sizeof(uint16_t));
+				}
+			}
+			continue;
+		}
+		for (size_t b = 0; b < slot->chkOffset; b += sizeof(uint64_t)) {
+			uint64_t value = nextRandom(&seed);
+			size_t n = slot->chkOffset - b < sizeof(uint64_t) ? slot->chkOffset - b : sizeof(uint64_t);
+			memcpy(block + b, &value, n);
+		}
+		memcpy(block + slot->magicOffset, slot->magic, magicLen);
+
+		// The Mario menu checksum is part of the magic that identifies the file (0x0709),
+		// so the menu bytes are raised until they sum to it
+		if (game == Mario && !slot->hasFields) {
+			uint32_t sum = 0;
+			for (size_t b = 0; b < slot->magicOffset; b++) {
+				block[b] &= 0x1F;
+				sum += block[b];
+			}
+			uint32_t target = (MAGIC_MARIO >> 16 & 0xFF) << 8 | MAGIC_MARIO >> 24;
+			uint32_t deficit = target - sum - (uint32_t)checksumBytes(block + slot->magicOffset, magicLen);
+			for (size_t b = 0; b < slot->magicOffset && deficit; b++) {
+				uint32_t room = 0xFFu - block[b];
+				uint32_t add = deficit < room ? deficit : room;
+				block[b] = (uint8_t)(block[b] + add);
+				deficit -= add;
+			}
+		}
+
+		uint16_t checksum = slot->width == 16 ? checksumWords16(block, slot->chkOffset)
+		                                      : checksumBytes(block, slot->chkOffset);
+		block[slot->chkOffset] = (uint8_t)(checksum >> 8);
+		block[slot->chkOffset + 1] = (uint8_t)checksum;
+	}
+	return size;
+}
+
+static int
+makeDirectory(const char* path)
+{
+#ifdef _WIN32
+	return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS ? 0 : -1;
+#else
+	return mkdir(path, 0777) == 0 || errno == EEXIST ? 0 : -1;
+#endif
+}
+
+// Writes count images under dir, 1000 per subdirectory, cycling through OoT SRA, MM FLA and
+// SM64 EEP. The Zelda images alternate between the DLEZ and the ZELD byte order.
+int
+runGen(int argc, char* argv[])
+{
+	const char* root = NULL;
+	long count = 1000;
+	uint64_t seed = 64;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--gen") == 0 && i + 1 < argc) {
+			root = argv[++i];
+		} else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+			count = atol(argv[++i]);
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "Unknown gen option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!root || count < 1) {
+		fprintf(stderr, "Usage: %s --gen <dir> [--count N] [--seed N]\n", argv[0]);
+		return 1;
+	}
+
+	static const char* extensions[] = { "sra", "fla", "eep" };
+	uint8_t* data = malloc(0x20000);
+	char path[4096];
+	double start = getTimeSeconds();
+	size_t bytes = 0;
+
+	if (!data || makeDirectory(root) != 0) {
+		fprintf(stderr, "Couldn't create %s\n", root);
+		free(data);
+		return 1;
+	}
+	for (long i = 0; i < count; i++) {
+		Game game = (Game)(i % 3);
+		int little = game != Mario && (i / 3) % 2;
+
+		if (i % 1000 == 0) {
+			snprintf(path, sizeof(path), "%s/%04ld", root, i / 1000);
+			if (makeDirectory(path) != 0) {
+				fprintf(stderr, "Couldn't create %s\n", path);
+				free(data);
+				return 1;
+			}
+		}
+		size_t size = buildSyntheticImage(data, game, seed * 0x100000001B3ULL + (uint64_t)i);
+		if (little) {
+			swapWords32(data, size);
+		}
+
+		snprintf(path, sizeof(path), "%s/%04ld/%07ld_%s.%s", root, i / 1000, i, little ? "zeld" : "dlez",
+		         extensions[game]);
+		FILE* output = fopen(path, "wb");
+		if (!output || fwrite(data, 1, size, output) != size) {
+			fprintf(stderr, "Couldn't write %s\n", path);
+			if (output) {
+				fclose(output);
+			}
+			free(data);
+			return 1;
+		}
+		fclose(output);
+		bytes += size;
+	}
+	free(data);
+
+	fprintf(stderr, "Wrote %ld images (%zu bytes) to %s in %.3f s\n", count, bytes, root, getTimeSeconds() - start);
+	return 0;
+}
+
+// Runs every stage over each file of a corpus on one thread and reports the stage timers
+static int
+benchCorpus(const char* root, long passes)
+{
+	ScanQueue queue = { 0 };
+	StageStats* stats = calloc(1, sizeof(StageStats));
+	SaveArena arena;
+	OutBuf out = { 0 };
+	size_t failed = 0;
+#ifdef _WIN32
+	FILE* sink = fopen("NUL", "wb");
+#else
+	FILE* sink = fopen("/dev/null", "wb");
+#endif
+
+	if (!stats || !sink || collectSaveFiles(root, &queue) != 0) {
+		fprintf(stderr, "Couldn't set up the corpus benchmark.\n");
+		free(stats);
+		if (sink) {
+			fclose(sink);
+		}
+		return 1;
+	}
+
+	arenaInit(&arena, malloc(SAVE_MAP_THRESHOLD), SAVE_MAP_THRESHOLD);
+	currentStats = stats;
+	double start = getTimeSeconds();
+	for (long pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < queue.count; i++) {
+			const SaveField* fields[MAX_SELECTED_FIELDS];
+			SaveReport report;
+			SaveImage image;
+
+			arenaReset(&arena);
+			if (loadQueuedSave(&queue, i, &arena, &image) != LoadOK) {
+				failed++;
+				continue;
+			}
+			// every field of every block, so the decoders are part of the render stage
+			size_t tableSize = 0;
+			const SaveField* table = getFieldTable(image.info.game, &tableSize);
+			int fieldCount = 0;
+			for (size_t f = 0; f < tableSize && f < MAX_SELECTED_FIELDS; f++) {
+				fields[fieldCount++] = &table[f];
+			}
+			checkSaveData(&image, 0, &report);
+			renderRecord(&out, OutputJson, &image, report.checks, report.blockCount, fields, fieldCount, NULL, 0);
+			outFlush(&out, sink);
+			freeSaveData(&image);
+		}
+	}
+	double elapsed = getTimeSeconds() - start;
+	currentStats = NULL;
+
+	printf("Corpus of %zu files, %ld pass%s, %zu unreadable: %.1f files/sec\n", queue.count, passes,
+	       passes == 1 ? "" : "es", failed, elapsed > 0.0 ? (double)queue.count * passes / elapsed : 0.0);
+	printStats(stats, elapsed, 1, stdout);
+
+	releaseQueue(&queue);
+	free(arena.base);
+	outFree(&out);
+	free(stats);
+	fclose(sink);
+	return failed ? 2 : 0;
+}
+
+// The magic search of --carve over a noisy buffer with a magic word every 64K or so
+static void
+benchCarve(long iterations)
+{
+	struct { const char* name; size_t (*kernel)(const uint8_t*, size_t, uint32_t*, size_t, size_t*); } kernels[] = {
+		{ "scalar",  findMagic_scalar },
+#ifdef SAVE64_SSE2
+		{ "sse2",    findMagic_sse2 },
+#endif
+#ifdef SAVE64_AVX2
+		{ "avx2",    cpuHasAvx2() ? findMagic_avx2 : NULL },
+#endif
+	};
+	static const uint32_t magics[] = { MAGIC_DLEZ, MAGIC_ZELD, MAGIC_MARIO };
+	const size_t size = 1 << 22;
+	uint8_t* data = malloc(size);
+	uint32_t* hits = malloc(CARVE_MAX_HITS * sizeof(uint32_t));
+	uint32_t* reference = malloc(CARVE_MAX_HITS * sizeof(uint32_t));
+	volatile size_t sink = 0;
+
+	if (!data || !hits || !reference) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		free(data);
+		free(hits);
+		free(reference);
+		return;
+	}
+	uint64_t state = 64;
+	for (size_t i = 0; i < size; i++) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		data[i] = (uint8_t)(state >> 56);
+	}
+	for (size_t i = 0, m = 0; i + sizeof(uint32_t) <= size; i += 0x10000 + m * 7, m = (m + 1) % 3) {
+		uint32_t magic = magics[m];
+		data[i] = (uint8_t)magic;
+		data[i + 1] = (uint8_t)(magic >> 8);
+		data[i + 2] = (uint8_t)(magic >> 16);
+		data[i + 3] = (uint8_t)(magic >> 24);
+	}
+	size_t end = 0;
+	size_t expected = findMagic_scalar(data, size, reference, CARVE_MAX_HITS, &end);
+
+	printf("Magic search over %zuK, %ld iterations per kernel\n", size / 1024, iterations);
+	for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+		if (!kernels[k].kernel) {
+			continue;
+		}
+		size_t count = kernels[k].kernel(data, size, hits, CARVE_MAX_HITS, &end);
+		if (count != expected || memcmp(hits, reference, count * sizeof(uint32_t)) != 0) {
+			fprintf(stderr, "%s: result differs from the scalar kernel\n", kernels[k].name);
+		}
+		double start = getTimeSeconds();
+		for (long i = 0; i < iterations; i++) {
+			sink += kernels[k].kernel(data, size, hits, CARVE_MAX_HITS, &end);
+		}
+		benchReport(kernels[k].name, size, iterations, getTimeSeconds() - start);
+	}
+	(void)sink;
+	free(data);
+	free(hits);
+	free(reference);
+}
+
+// The block hash against the word-at-a-time hash and the checksum it saves with --dedup
+static void
+benchHash(long iterations)
+{
+	struct { const char* name; void (*kernel)(const uint8_t*, size_t, uint64_t*); } kernels[] = {
+		{ "scalar",  hashStripes_scalar },
+#ifdef SAVE64_SSE2
+		{ "sse2",    hashStripes_sse2 },
+#endif
+#ifdef SAVE64_AVX2
+		{ "avx2",    cpuHasAvx2() ? hashStripes_avx2 : NULL },
+#endif
+	};
+	const size_t size = FLA_BLOCK_SIZE;
+	uint8_t* block = malloc(size);
+	volatile uint64_t sink = 0;
+	uint64_t reference[8];
+
+	if (!block) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		return;
+	}
+	for (size_t i = 0; i < size; i++) {
+		block[i] = (uint8_t)(i * 31 + 7);
+	}
+	memcpy(reference, hashLaneKeys, sizeof(reference));
+	hashStripes_scalar(block, size / HASH_STRIPE, reference);
+
+	printf("Hash of a 0x%x byte block, %ld iterations per kernel\n", (unsigned)size, iterations);
+	double start = getTimeSeconds();
+	for (long i = 0; i < iterations; i++) {
+		sink += checksumWords16(block, size);
+	}
+	benchReport("checksum16", size, iterations, getTimeSeconds() - start);
+	start = getTimeSeconds();
+	for (long i = 0; i < iterations; i++) {
+		sink += hashBytes64(block, size, 0);
+	}
+	benchReport("hashBytes64", size, iterations, getTimeSeconds() - start);
+	for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+		uint64_t acc[8];
+		if (!kernels[k].kernel) {
+			continue;
+		}
+		memcpy(acc, hashLaneKeys, sizeof(acc));
+		kernels[k].kernel(block, size / HASH_STRIPE, acc);
+		if (memcmp(acc, reference, sizeof(acc)) != 0) {
+			fprintf(stderr, "%s: result differs from the scalar kernel\n", kernels[k].name);
+		}
+		start = getTimeSeconds();
+		for (long i = 0; i < iterations; i++) {
+			kernels[k].kernel(block, size / HASH_STRIPE, acc);
+		}
+		sink += acc[0];
+		benchReport(kernels[k].name, size, iterations, getTimeSeconds() - start);
+	}
+	(void)sink;
+	free(block);
+}
+
+int
+runBench(int argc, char* argv[])
+{
+	const char* name = argc > 2 ? argv[2] : "";
+	const char* corpus = NULL;
+	long iterations = 2000;
+
+	for (int i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+			iterations = atol(argv[++i]);
+		} else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+			corpus = argv[++i];
+			iterations = iterations == 2000 ? 1 : iterations;
+		}
+	}
+	if (iterations < 1) {
+		iterations = 1;
+	}
+
+	if (strcmp(name, "corpus") == 0 && corpus) {
+		return benchCorpus(corpus, iterations);
+	}
+
+	if (strcmp(name, "swap") == 0) {
+		benchSwap(iterations);
+	} else if (strcmp(name, "checksum") == 0) {
+		benchChecksum(iterations);
+	} else if (strcmp(name, "output") == 0) {
+		benchOutput(iterations);
+	} else if (strcmp(name, "compare") == 0) {
+		benchCompare(iterations);
+	} else if (strcmp(name, "hash") == 0) {
+		benchHash(iterations);
+	} else if (strcmp(name, "carve") == 0) {
+		benchCarve(iterations);
+	} else if (strcmp(name, "columns") == 0) {
+		benchColumns(iterations);
+	} else {
+		fprintf(stderr, "Usage: %s --bench swap|checksum|compare|hash|carve|columns|output [--iterations N]\n",
+		        argv[0]);
+		fprintf(stderr, "       %s --bench corpus --corpus <dir|list> [--iterations N]\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
+
+int
+parseOutputFormat(const char* name, OutputFormat* format)
+{
+	if (strcmp(name, "human") == 0) {
+		*format = OutputHuman;
+	} else if (strcmp(name, "json") == 0 || strcmp(name, "ndjson") == 0) {
+		*format = OutputJson;
+	} else if (strcmp(name, "csv") == 0) {
+		*format = OutputCsv;
+	} else {
+		fprintf(stderr, "Unknown output format %s. Use human, json or csv.\n", name);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+outReserve(OutBuf* out, size_t extra)
+{
+	if (out->len + extra <= out->cap) {
+		return 0;
+	}
+	if (out->fixed) {
+		out->truncated = 1;
+		return -1;
+	}
+	size_t cap = out->cap ? out->cap : 4096;
+	while (cap < out->len + extra) {
+		cap *= 2;
+	}
+	char* data = realloc(out->data, cap);
+	if (!data) {
+		return -1;
+	}
+	out->data = data;
+	out->cap = cap;
+	return 0;
+}
+
+// renders into caller-owned memory instead of a growing heap buffer
+void
+outInit(OutBuf* out, char* memory, size_t cap)
+{
+	out->data = memory;
+	out->len = 0;
+	out->cap = cap;
+	out->fixed = 1;
+	out->truncated = 0;
+}
+
+void
+outPut(OutBuf* out, const char* data, size_t len)
+{
+	if (outReserve(out, len) == 0) {
+		memcpy(out->data + out->len, data, len);
+		out->len += len;
+	}
+}
+
+void
+outPuts(OutBuf* out, const char* str)
+{
+	outPut(out, str, strlen(str));
+}
+
+void
+outPutc(OutBuf* out, char c)
+{
+	if (outReserve(out, 1) == 0) {
+		out->data[out->len++] = c;
+	}
+}
+
+void
+outPutUint(OutBuf* out, uint32_t value)
+{
+	char digits[10];
+	int n = 0;
+
+	do {
+		digits[n++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	if (outReserve(out, n) == 0) {
+		while (n) {
+			out->data[out->len++] = digits[--n];
+		}
+	}
+}
+
+static void
+outPutInt(OutBuf* out, int32_t value)
+{
+	if (value < 0) {
+		outPutc(out, '-');
+		outPutUint(out, (uint32_t)0 - (uint32_t)value);
+	} else {
+		outPutUint(out, (uint32_t)value);
+	}
+}
+
+void
+outPutHex(OutBuf* out, uint32_t value, int digits)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	if (outReserve(out, digits) == 0) {
+		for (int i = digits - 1; i >= 0; i--) {
+			out->data[out->len++] = hex[(value >> (i * 4)) & 0xf];
+		}
+	}
+}
+
+// printf into the buffer, for the human readable output only
+void
+outPrintf(OutBuf* out, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+
+	if (n > 0 && outReserve(out, (size_t)n + 1) == 0) {
+		va_start(args, format);
+		vsnprintf(out->data + out->len, (size_t)n + 1, format, args);
+		va_end(args);
+		out->len += n;
+	}
+}
+
+void
+outFlush(OutBuf* out, FILE* fp)
+{
+	if (out->len) {
+		STATS_BEGIN(start);
+		fwrite(out->data, 1, out->len, fp);
+		STATS_COUNT(CounterOutputBytes, out->len);
+		STATS_END(StageOutput, start);
+		out->len = 0;
+	}
+}
+
+void
+outFree(OutBuf* out)
+{
+	if (!out->fixed) {
+		free(out->data);
+	}
+	out->data = NULL;
+	out->len = out->cap = 0;
+}
+
+// JSON string contents or a quoted CSV cell
+static void
+outPutEscaped(OutBuf* out, OutputFormat format, const char* str, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = (unsigned char)str[i];
+
+		if (format == OutputCsv) {
+			if (c == '"') {
+				outPutc(out, '"');
+			}
+			outPutc(out, (char)c);
+		} else if (c == '"' || c == '\\') {
+			outPutc(out, '\\');
+			outPutc(out, (char)c);
+		} else if (c < 0x20 || c >= 0x7f) {
+			outPuts(out, "\\u00");
+			outPutHex(out, c, 2);
+		} else {
+			outPutc(out, (char)c);
+		}
+	}
+}
+
+static void
+outPutString(OutBuf* out, OutputFormat format, const char* str, size_t len)
+{
+	if (format == OutputHuman) {
+		outPut(out, str, len);
+		return;
+	}
+	outPutc(out, '"');
+	outPutEscaped(out, format, str, len);
+	outPutc(out, '"');
+}
+
+// renders one field of a slot, reading only the bytes of that field
+void
+putField(OutBuf* out, OutputFormat format, const SaveField* field, const uint8_t* block, Region charset)
+{
+	const uint8_t* data = block + field->offset;
+	int json = format == OutputJson;
+
+	if (field->format == FormatName) {
+		char text[64];
+		size_t len = decodeName(data, field->count < 63 ? field->count : 63, charset, text);
+		outPutString(out, format, text, len);
+		return;
+	}
+	if (field->format == FormatText) {
+		char text[64];
+		size_t len = 0;
+		for (int i = 0; i < field->count && len < sizeof(text); i++) {
+			if (data[i] == '\0') {
+				break;
+			}
+			text[len++] = (char)data[i];
+		}
+		outPutString(out, format, text, len);
+		return;
+	}
+
+	if (json && field->count > 1) {
+		outPutc(out, '[');
+	}
+	for (int i = 0; i < field->count; i++) {
+		uint32_t value = readField(data + i * field->width, field->width, field->endian);
+		int bits = field->width * 8;
+
+		if (i) {
+			outPutc(out, json ? ',' : ' ');
+		}
+		switch (field->format) {
+			case FormatSigned:
+				outPutInt(out, bits == 8 ? (int8_t)value : bits == 16 ? (int16_t)value : (int32_t)value);
+				break;
+			case FormatHex:
+				if (json) outPutc(out, '"');
+				outPutHex(out, value, field->width * 2);
+				if (json) outPutc(out, '"');
+				break;
+			case FormatBool:
+				outPuts(out, value ? "true" : "false");
+				break;
+			case FormatBinary:
+				if (json) outPutc(out, '"');
+				for (int bit = bits - 1; bit >= 0; bit--) {
+					outPutc(out, (value >> bit) & 1 ? '1' : '0');
+				}
+				if (json) outPutc(out, '"');
+				break;
+			default:
+				outPutUint(out, value);
+				break;
+		}
+	}
+	if (json && field->count > 1) {
+		outPutc(out, ']');
+	}
+}
+
+// names are those of the resolved fields, one per column the records write
+void
+renderCsvHeader(OutBuf* out, const char* const* names, int count)
+{
+	outPuts(out, "path,game,slot,status,stored,actual");
+	for (int i = 0; i < count; i++) {
+		outPutc(out, ',');
+		outPuts(out, names[i]);
+	}
+	outPutc(out, '\n');
+}
+
+// fieldCount pads the CSV row to the columns of the header the records were written under
+void
+renderError(OutBuf* out, OutputFormat format, const char* path, const char* error, int fieldCount)
+{
+	switch (format) {
+		case OutputHuman:
+			outPuts(out, path);
+			outPuts(out, "\t-\t-\t-\t-\t" ANSI_BG_RED ANSI_COLOR_WHITE);
+			outPuts(out, error);
+			outPuts(out, ANSI_COLOR_RESET "\n");
+			break;
+		case OutputJson:
+			outPuts(out, "{\"path\":");
+			outPutString(out, format, path, strlen(path));
+			outPuts(out, ",\"error\":\"");
+			outPuts(out, error);
+			outPuts(out, "\"}\n");
+			break;
+		case OutputCsv:
+			outPutString(out, format, path, strlen(path));
+			outPuts(out, ",,,");
+			outPuts(out, error);
+			outPuts(out, ",,");
+			for (int f = 0; f < fieldCount; f++) {
+				outPutc(out, ',');
+			}
+			outPutc(out, '\n');
+			break;
+	}
+}
+
+static const char*
+getCheckStatus(const SlotCheck* check)
+{
+	if (!check->present) {
+		return "EMPTY";
+	}
+	return check->stored == check->actual ? "OK" : "FAIL";
+}
+
+// Renders the record of one file: one line per block (and per primary/backup pair) for human
+// and CSV output, one JSON object per file for NDJSON. Missing fields (NULL) are left out.
+void
+renderRecord(OutBuf* out, OutputFormat format, const SaveImage* image, const SlotCheck* checks, int count,
+             const SaveField* const* fields, int fieldCount, const SlotPair* pairs, int pairCount)
+{
+	const FileInfo* file = &image->info;
+	size_t pathLen = strlen(file->path);
+	STATS_BEGIN(start);
+
+	if (format == OutputJson) {
+		outPuts(out, "{\"path\":");
+		outPutString(out, format, file->path, pathLen);
+		outPuts(out, ",\"game\":\"");
+		outPuts(out, getGameName(file->game));
+		outPuts(out, file->endian == LittleE ? "\",\"endian\":\"little\",\"size\":" : "\",\"endian\":\"big\",\"size\":");
+		outPutUint(out, (uint32_t)image->size);
+		outPuts(out, ",\"slots\":[");
+	}
+
+	for (int i = 0; i < count; i++) {
+		const SlotCheck* check = &checks[i];
+		const char* status = getCheckStatus(check);
+		const uint8_t* block = image->data + check->layout->offset;
+		int withFields = check->present && check->layout->hasFields;
+
+		switch (format) {
+			case OutputHuman:
+				outPut(out, file->path, pathLen);
+				outPutc(out, '\t');
+				outPuts(out, getGameName(file->game));
+				outPutc(out, '\t');
+				outPuts(out, check->layout->name);
+				outPutc(out, '\t');
+				outPutHex(out, check->stored, 4);
+				outPutc(out, '\t');
+				outPutHex(out, check->actual, 4);
+				outPutc(out, '\t');
+				outPuts(out, !check->present ? "" : check->stored == check->actual
+				        ? ANSI_BG_GREEN ANSI_COLOR_WHITE : ANSI_BG_RED ANSI_COLOR_WHITE);
+				outPuts(out, status);
+				outPuts(out, check->present ? ANSI_COLOR_RESET : "");
+				for (int f = 0; withFields && f < fieldCount; f++) {
+					if (fields[f]) {
+						outPutc(out, '\t');
+						outPuts(out, fields[f]->name);
+						outPutc(out, '=');
+						putField(out, format, fields[f], block, file->charset);
+					}
+				}
+				outPutc(out, '\n');
+				break;
+
+			case OutputJson:
+				outPuts(out, i ? ",{\"slot\":\"" : "{\"slot\":\"");
+				outPuts(out, check->layout->name);
+				outPuts(out, check->layout->backup ? "\",\"backup\":true,\"status\":\"" : "\",\"backup\":false,\"status\":\"");
+				outPuts(out, status);
+				outPuts(out, "\",\"stored\":\"");
+				outPutHex(out, check->stored, 4);
+				outPuts(out, "\",\"actual\":\"");
+				outPutHex(out, check->actual, 4);
+				outPutc(out, '"');
+				if (withFields && fieldCount > 0) {
+					int first = 1;
+					outPuts(out, ",\"fields\":{");
+					for (int f = 0; f < fieldCount; f++) {
+						if (fields[f]) {
+							outPuts(out, first ? "\"" : ",\"");
+							outPuts(out, fields[f]->name);
+							outPuts(out, "\":");
+							putField(out, format, fields[f], block, file->charset);
+							first = 0;
+						}
+					}
+					outPutc(out, '}');
+				}
+				outPutc(out, '}');
+				break;
+
+			case OutputCsv:
+				outPutString(out, format, file->path, pathLen);
+				outPutc(out, ',');
+				outPuts(out, getGameName(file->game));
+				outPutc(out, ',');
+				outPuts(out, check->layout->name);
+				outPutc(out, ',');
+				outPuts(out, status);
+				outPutc(out, ',');
+				outPutHex(out, check->stored, 4);
+				outPutc(out, ',');
+				outPutHex(out, check->actual, 4);
+				for (int f = 0; f < fieldCount; f++) {
+					outPutc(out, ',');
+					if (withFields && fields[f]) {
+						putField(out, format, fields[f], block, file->charset);
+					}
+				}
+				outPutc(out, '\n');
+				break;
+		}
+	}
+
+	if (format == OutputJson) {
+		outPutc(out, ']');
+	}
+
+	for (int i = 0; i < pairCount; i++) {
+		const SlotPair* pair = &pairs[i];
+		int identical = pair->firstDiff == pair->length;
+
+		switch (format) {
+			case OutputHuman:
+				outPut(out, file->path, pathLen);
+				outPutc(out, '\t');
+				outPuts(out, getGameName(file->game));
+				outPutc(out, '\t');
+				outPuts(out, pair->primary->layout->name);
+				outPutc(out, '/');
+				outPuts(out, pair->backup->layout->name);
+				outPuts(out, "\t-\t-\t");
+				outPuts(out, getPairStatus(pair->status));
+				if (!identical) {
+					outPuts(out, "\t0x");
+					outPutHex(out, pair->firstDiff, 4);
+				}
+				outPutc(out, '\n');
+				break;
+
+			case OutputJson:
+				outPuts(out, i ? ",{\"primary\":\"" : ",\"pairs\":[{\"primary\":\"");
+				outPuts(out, pair->primary->layout->name);
+				outPuts(out, "\",\"backup\":\"");
+				outPuts(out, pair->backup->layout->name);
+				outPuts(out, "\",\"status\":\"");
+				outPuts(out, getPairStatus(pair->status));
+				outPuts(out, identical ? "\",\"identical\":true}" : "\",\"identical\":false,\"firstDiff\":");
+				if (!identical) {
+					outPutUint(out, pair->firstDiff);
+					outPutc(out, '}');
+				}
+				if (i == pairCount - 1) {
+					outPutc(out, ']');
+				}
+				break;
+
+			case OutputCsv:
+				outPutString(out, format, file->path, pathLen);
+				outPutc(out, ',');
+				outPuts(out, getGameName(file->game));
+				outPutc(out, ',');
+				outPuts(out, pair->primary->layout->name);
+				outPutc(out, '/');
+				outPuts(out, pair->backup->layout->name);
+				outPutc(out, ',');
+				outPuts(out, getPairStatus(pair->status));
+				outPuts(out, ",,");
+				for (int f = 0; f < fieldCount; f++) {
+					outPutc(out, ',');
+				}
+				outPutc(out, '\n');
+				break;
+		}
+	}
+
+	if (format == OutputJson) {
+		outPuts(out, "}\n");
+	}
+	STATS_END(StageRender, start);
+}
+
+// maps the cache from the previous run. A missing or unusable cache just starts empty.
+int
+openScanCache(const char* path, ScanCache* cache)
+{
+	memset(cache, 0, sizeof(ScanCache));
+	cache->path = path;
+
+	if (mapFile(path, &cache->file) != 0) {
+		return 0;
+	}
+
+	const CacheHeader* header = (const CacheHeader*)cache->file.data;
+	if (cache->file.size < sizeof(CacheHeader) || memcmp(header->magic, CACHE_MAGIC, 8) != 0
+	    || header->version != CACHE_VERSION
+	    || sizeof(CacheHeader) + (uint64_t)header->count * sizeof(CacheEntry) > header->stringsOffset
+	    || header->stringsOffset + header->stringsSize > cache->file.size) {
+		fprintf(stderr, "Ignoring the unusable scan cache %s.\n", path);
+		unmapFile(&cache->file);
+		return -1;
+	}
+
+	cache->entries = (const CacheEntry*)(cache->file.data + sizeof(CacheHeader));
+	cache->count = header->count;
+	cache->strings = (const char*)cache->file.data + header->stringsOffset;
+	cache->stringsSize = header->stringsSize;
+	return 0;
+}
+
+static int
+cacheEntryMatches(const ScanCache* cache, const CacheEntry* entry, const char* path, size_t len)
+{
+	return entry->pathLen == len && entry->pathOffset + (uint64_t)len <= cache->stringsSize
+	       && memcmp(cache->strings + entry->pathOffset, path, len) == 0;
+}
+
+// entries from a stale or damaged cache are treated as misses, so their files are read again
+static int
+cacheEntryUsable(const ScanCache* cache, const CacheEntry* entry)
+{
+	if (entry->pathOffset + (uint64_t)entry->pathLen > cache->stringsSize) {
+		return 0;
+	}
+	if (entry->status != LoadOK) {
+		return entry->status <= LoadNoMemory;
+	}
+	if (entry->game > Mario || entry->blockCount > MAX_SLOT_BLOCKS) {
+		return 0;
+	}
+
+	int layoutCount = 0;
+	getSlotLayout((Game)entry->game, &layoutCount);
+	for (int i = 0; i < entry->blockCount; i++) {
+		if (entry->blocks[i].layout >= layoutCount) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// binary search over the entries, which are sorted by path hash
+const CacheEntry*
+findCacheEntry(const ScanCache* cache, const char* path, uint64_t pathHash)
+{
+	size_t len = strlen(path);
+	size_t low = 0;
+	size_t high = cache->count;
+
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (cache->entries[mid].pathHash < pathHash) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	for (; low < cache->count && cache->entries[low].pathHash == pathHash; low++) {
+		if (cacheEntryMatches(cache, &cache->entries[low], path, len)) {
+			return cacheEntryUsable(cache, &cache->entries[low]) ? &cache->entries[low] : NULL;
+		}
+	}
+	return NULL;
+}
+
+// records the stamp, checksum results and player names of a freshly read image
+void
+fillCacheEntry(CacheEntry* entry, const SaveImage* image, LoadStatus status, const SlotCheck* checks, int count)
+{
+	memset(entry, 0, sizeof(CacheEntry));
+	entry->size = image->size;
+	entry->mtime = image->mtime;
+	entry->status = (uint8_t)status;
+	if (status != LoadOK) {
+		return;
+	}
+
+	int layoutCount = 0;
+	const SlotLayout* layout = getSlotLayout(image->info.game, &layoutCount);
+	const SaveField* name = findField(image->info.game, "playerName");
+
+	entry->contentHash = hashBytes64(image->data, image->size, 0);
+	entry->game = (uint8_t)image->info.game;
+	entry->endian = (uint8_t)image->info.endian;
+	entry->blockCount = (uint8_t)count;
+	for (int i = 0; i < count; i++) {
+		CacheBlock* block = &entry->blocks[i];
+		block->stored = checks[i].stored;
+		block->actual = checks[i].actual;
+		block->present = checks[i].present;
+		block->layout = (uint8_t)(checks[i].layout - layout);
+		if (name && checks[i].present && checks[i].layout->hasFields) {
+			const uint8_t* raw = image->data + checks[i].layout->offset + name->offset;
+			char text[sizeof(block->name) + 1];
+			memcpy(block->name, text, decodeName(raw, sizeof(block->name), image->info.charset, text));
+		}
+	}
+}
+
+static int
+compareCacheRecords(const void* a, const void* b)
+{
+	uint64_t x = (*(const CacheRecord* const*)a)->entry.pathHash;
+	uint64_t y = (*(const CacheRecord* const*)b)->entry.pathHash;
+	return x < y ? -1 : x > y;
+}
+
+static int
+comparePathHashes(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*)a;
+	uint64_t y = *(const uint64_t*)b;
+	return x < y ? -1 : x > y;
+}
+
+// merges the old entries with the files read during this run and replaces the cache file.
+// Entries of files that are no longer in the scanned tree are dropped.
+int
+saveScanCache(ScanCache* cache, ScanWorker* workers, int jobs)
+{
+	size_t addedCount = 0;
+	for (int i = 0; i < jobs; i++) {
+		addedCount += workers[i].addedCount;
+	}
+
+	CacheRecord** added = malloc((addedCount ? addedCount : 1) * sizeof(CacheRecord*));
+	if (!added) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		return -1;
+	}
+	addedCount = 0;
+	for (int i = 0; i < jobs; i++) {
+		for (size_t r = 0; r < workers[i].addedCount; r++) {
+			added[addedCount++] = &workers[i].added[r];
+		}
+	}
+	qsort(added, addedCount, sizeof(CacheRecord*), compareCacheRecords);
+
+	// hashes of every path this run was given, read or answered from the cache
+	const ScanQueue* queue = workers[0].queue;
+	uint64_t* seen = malloc((queue->count ? queue->count : 1) * sizeof(uint64_t));
+	if (!seen) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		free(added);
+		return -1;
+	}
+	for (size_t i = 0; i < queue->count; i++) {
+		seen[i] = hashBytes64(queue->paths[i], strlen(queue->paths[i]), 0);
+	}
+	qsort(seen, queue->count, sizeof(uint64_t), comparePathHashes);
+
+	// old entries survive if their file is still in the tree and this run didn't read it again.
+	// The entries and both lists are sorted by path hash, so one pass over each does it.
+	uint8_t* keep = calloc(cache->count ? cache->count : 1, 1);
+	size_t count = addedCount;
+	size_t stringsSize = 0;
+	size_t first = 0;               // first added record whose hash isn't below the entry's
+	size_t listed = 0;
+	for (size_t i = 0; keep && i < cache->count; i++) {
+		const CacheEntry* entry = &cache->entries[i];
+		while (listed < queue->count && seen[listed] < entry->pathHash) {
+			listed++;
+		}
+		while (first < addedCount && added[first]->entry.pathHash < entry->pathHash) {
+			first++;
+		}
+		keep[i] = listed < queue->count && seen[listed] == entry->pathHash && cacheEntryUsable(cache, entry);
+		for (size_t a = first; keep[i] && a < addedCount && added[a]->entry.pathHash == entry->pathHash; a++) {
+			if (cacheEntryMatches(cache, entry, added[a]->path, strlen(added[a]->path))) {
+				keep[i] = 0;
+			}
+		}
+		if (keep[i]) {
+			count++;
+			stringsSize += entry->pathLen;
+		}
+	}
+	free(seen);
+	for (size_t a = 0; a < addedCount; a++) {
+		stringsSize += strlen(added[a]->path);
+	}
+
+	size_t stringsOffset = sizeof(CacheHeader) + count * sizeof(CacheEntry);
+	size_t total = stringsOffset + stringsSize;
+	uint8_t* buffer = keep ? calloc(total, 1) : NULL;
+	if (!buffer) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		free(keep);
+		free(added);
+		return -1;
+	}
+
+	CacheHeader* header = (CacheHeader*)buffer;
+	CacheEntry* entries = (CacheEntry*)(buffer + sizeof(CacheHeader));
+	char* strings = (char*)buffer + stringsOffset;
+	size_t stringsUsed = 0;
+	size_t written = 0;
+	size_t a = 0;
+
+	memcpy(header->magic, CACHE_MAGIC, 8);
+	header->version = CACHE_VERSION;
+	header->count = (uint32_t)count;
+	header->stringsOffset = stringsOffset;
+	header->stringsSize = stringsSize;
+
+	// both lists are sorted by path hash, so a merge keeps the result sorted
+	for (size_t i = 0; i <= cache->count; i++) {
+		uint64_t limit = i < cache->count ? cache->entries[i].pathHash : UINT64_MAX;
+		for (; a < addedCount && (added[a]->entry.pathHash < limit || i == cache->count); a++) {
+			size_t len = strlen(added[a]->path);
+			entries[written] = added[a]->entry;
+			entries[written].pathOffset = (uint32_t)stringsUsed;
+			entries[written].pathLen = (uint16_t)len;
+			memcpy(strings + stringsUsed, added[a]->path, len);
+			stringsUsed += len;
+			written++;
+		}
+		if (i < cache->count && keep[i]) {
+			const CacheEntry* entry = &cache->entries[i];
+			entries[written] = *entry;
+			entries[written].pathOffset = (uint32_t)stringsUsed;
+			memcpy(strings + stringsUsed, cache->strings + entry->pathOffset, entry->pathLen);
+			stringsUsed += entry->pathLen;
+			written++;
+		}
+	}
+
+	// the old mapping has to go before the file can be replaced on Windows
+	unmapFile(&cache->file);
+	cache->entries = NULL;
+	cache->count = 0;
+
+	int result = writeFileAtomic(cache->path, buffer, total);
+	free(buffer);
+	free(keep);
+	free(added);
+	return result;
+}
+
+void
+closeScanCache(ScanCache* cache)
+{
+	unmapFile(&cache->file);
+	cache->entries = NULL;
+	cache->count = 0;
+}
+
+// sized for about half the slots to be in use once every block is distinct
+int
+initDedupTable(DedupTable* table, size_t blocks)
+{
+	size_t count = 1024;
+	while (count < blocks * 2 && count < ((size_t)1 << 24)) {
+		count *= 2;
+	}
+	table->slots = calloc(count, sizeof(DedupSlot));
+	table->mask = count - 1;
+	return table->slots ? 0 : -1;
+}
+
+void
+freeDedupTable(DedupTable* table)
+{
+	free(table->slots);
+	table->slots = NULL;
+	table->mask = 0;
+}
+
+static int
+compareDedupRefs(const void* a, const void* b)
+{
+	const DedupRef* x = (const DedupRef*)a;
+	const DedupRef* y = (const DedupRef*)b;
+
+	if (x->hash != y->hash) {
+		return x->hash < y->hash ? -1 : 1;
+	}
+	if (x->file != y->file) {
+		return x->file < y->file ? -1 : 1;
+	}
+	return (int)x->layout - (int)y->layout;
+}
+
+// run of equal hashes in the sorted references
+typedef struct {
+	size_t        start;
+	size_t        count;
+} DedupGroup;
+
+static int
+compareDedupGroups(const void* a, const void* b)
+{
+	const DedupGroup* x = (const DedupGroup*)a;
+	const DedupGroup* y = (const DedupGroup*)b;
+
+	if (x->count != y->count) {
+		return x->count > y->count ? -1 : 1;
+	}
+	return x->start < y->start ? -1 : 1;
+}
+
+// Writes every set of identical blocks seen by the scan, largest first, with the file and
+// slot of each copy. unique receives the number of distinct blocks, groups the number of sets.
+int
+writeDedupReport(const char* path, OutputFormat format, const ScanQueue* queue, ScanWorker* workers, int jobs,
+                 size_t* unique, size_t* groups)
+{
+	size_t total = 0;
+	for (int i = 0; i < jobs; i++) {
+		total += workers[i].refCount;
+	}
+	DedupRef* refs = malloc((total + 1) * sizeof(DedupRef));
+	DedupGroup* runs = malloc((total / 2 + 1) * sizeof(DedupGroup));
+	FILE* output = fopen(path, "wb");
+	if (!refs || !runs || !output) {
+		fprintf(stderr, "Couldn't write the dedup report %s.\n", path);
+		free(refs);
+		free(runs);
+		if (output) {
+			fclose(output);
+		}
+		return -1;
+	}
+
+	size_t count = 0;
+	for (int i = 0; i < jobs; i++) {
+		memcpy(refs + count, workers[i].refs, workers[i].refCount * sizeof(DedupRef));
+		count += workers[i].refCount;
+	}
+	qsort(refs, count, sizeof(DedupRef), compareDedupRefs);
+
+	*unique = 0;
+	*groups = 0;
+	for (size_t i = 0; i < count; ) {
+		size_t end = i + 1;
+		while (end < count && refs[end].hash == refs[i].hash) {
+			end++;
+		}
+		if (end - i > 1) {
+			runs[*groups].start = i;
+			runs[*groups].count = end - i;
+			(*groups)++;
+		}
+		(*unique)++;
+		i = end;
+	}
+	qsort(runs, *groups, sizeof(DedupGroup), compareDedupGroups);
+
+	OutBuf out = { 0 };
+	if (format == OutputCsv) {
+		outPuts(&out, "hash,length,copies,path,slot\n");
+	}
+	for (size_t g = 0; g < *groups; g++) {
+		const DedupRef* first = &refs[runs[g].start];
+		char hash[17];
+		snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)first->hash);
+
+		if (format == OutputHuman) {
+			outPrintf(&out, "%zu copies of a 0x%x byte block, hash %s\n", runs[g].count, first->length, hash);
+		} else if (format == OutputJson) {
+			outPrintf(&out, "{\"hash\":\"%s\",\"length\":%u,\"copies\":%zu,\"blocks\":[", hash, first->length,
+			          runs[g].count);
+		}
+		for (size_t r = 0; r < runs[g].count; r++) {
+			const DedupRef* ref = &first[r];
+			const char* file = queue->paths[ref->file];
+			int layoutCount = 0;
+			const char* slot = getSlotLayout((Game)ref->game, &layoutCount)[ref->layout].name;
+
+			switch (format) {
+				case OutputHuman:
+					outPrintf(&out, "\t%s\t%s\n", file, slot);
+					break;
+				case OutputJson:
+					outPuts(&out, r ? ",{\"path\":" : "{\"path\":");
+					outPutString(&out, format, file, strlen(file));
+					outPrintf(&out, ",\"slot\":\"%s\"}", slot);
+					break;
+				case OutputCsv:
+					outPrintf(&out, "%s,%u,%zu,", hash, first->length, runs[g].count);
+					outPutString(&out, format, file, strlen(file));
+					outPrintf(&out, ",%s\n", slot);
+					break;
+			}
+		}
+		if (format == OutputJson) {
+			outPuts(&out, "]}\n");
+		}
+		if (out.len >= 0x10000) {
+			outFlush(&out, output);
+		}
+	}
+	outFlush(&out, output);
+	outFree(&out);
+	free(refs);
+	free(runs);
+	if (fclose(output) != 0) {
+		fprintf(stderr, "Couldn't write the dedup report %s.\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+compareNameRefs(const void* a, const void* b)
+{
+	const NameRef* x = (const NameRef*)a;
+	const NameRef* y = (const NameRef*)b;
+	int order = memcmp(x->key, y->key, sizeof(x->key));
+
+	if (order != 0) {
+		return order;
+	}
+	if (x->file != y->file) {
+		return x->file < y->file ? -1 : 1;
+	}
+	return (int)x->layout - (int)y->layout;
+}
+
+// Writes the player names seen by the scan, sorted case-insensitively, with the file and
+// slot of each. count receives the number of names indexed.
+int
+writeNameIndex(const char* path, const ScanQueue* queue, ScanWorker* workers, int jobs, size_t* count)
+{
+	size_t total = 0;
+	for (int i = 0; i < jobs; i++) {
+		total += workers[i].nameCount;
+	}
+	NameRef* refs = malloc((total + 1) * sizeof(NameRef));
+	uint32_t* pathOffsets = malloc((queue->count + 1) * sizeof(uint32_t));
+	if (!refs || !pathOffsets) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		free(refs);
+		free(pathOffsets);
+		return -1;
+	}
+
+	*count = 0;
+	for (int i = 0; i < jobs; i++) {
+		memcpy(refs + *count, workers[i].names, workers[i].nameCount * sizeof(NameRef));
+		*count += workers[i].nameCount;
+	}
+	qsort(refs, *count, sizeof(NameRef), compareNameRefs);
+
+	// each file's path is stored once, however many of its slots are named
+	size_t stringsSize = 0;
+	for (size_t i = 0; i < queue->count; i++) {
+		pathOffsets[i] = UINT32_MAX;
+	}
+	for (size_t i = 0; i < *count; i++) {
+		if (pathOffsets[refs[i].file] == UINT32_MAX) {
+			pathOffsets[refs[i].file] = (uint32_t)stringsSize;
+			stringsSize += strlen(queue->paths[refs[i].file]);
+		}
+	}
+
+	size_t stringsOffset = sizeof(NameHeader) + *count * sizeof(NameEntry);
+	size_t size = stringsOffset + stringsSize;
+	uint8_t* buffer = calloc(size, 1);
+	if (!buffer) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		free(refs);
+		free(pathOffsets);
+		return -1;
+	}
+
+	NameHeader* header = (NameHeader*)buffer;
+	NameEntry* entries = (NameEntry*)(buffer + sizeof(NameHeader));
+	char* strings = (char*)buffer + stringsOffset;
+
+	memcpy(header->magic, NAMES_MAGIC, 8);
+	header->version = NAMES_VERSION;
+	header->count = (uint32_t)*count;
+	header->stringsOffset = stringsOffset;
+	header->stringsSize = stringsSize;
+
+	for (size_t i = 0; i < *count; i++) {
+		const char* file = queue->paths[refs[i].file];
+		NameEntry* entry = &entries[i];
+
+		memcpy(entry->key, refs[i].key, sizeof(entry->key));
+		memcpy(entry->name, refs[i].name, sizeof(entry->name));
+		entry->pathOffset = pathOffsets[refs[i].file];
+		entry->pathLen = (uint16_t)strlen(file);
+		entry->game = refs[i].game;
+		entry->layout = refs[i].layout;
+		entry->valid = refs[i].valid;
+		memcpy(strings + entry->pathOffset, file, entry->pathLen);
+	}
+
+	int result = writeFileAtomic(path, buffer, size);
+	if (result != 0) {
+		fprintf(stderr, "Couldn't write the name index %s.\n", path);
+	}
+	free(buffer);
+	free(refs);
+	free(pathOffsets);
+	return result;
+}
+
+// Lists the saves holding a player name, from an index written by --scan --names. Names match
+// without regard to case, and with --prefix every name starting with the given one matches.
+int
+runFindName(int argc, char* argv[])
+{
+	const char* indexPath = NULL;
+	const char* query = NULL;
+	OutputFormat format = OutputHuman;
+	int prefix = 0;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--prefix") == 0) {
+			prefix = 1;
+		} else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			if (parseOutputFormat(argv[++i], &format) != 0) {
+				return 2;
+			}
+		} else if (!indexPath) {
+			indexPath = argv[i];
+		} else if (!query) {
+			query = argv[i];
+		} else {
+			fprintf(stderr, "Unknown find option: %s\n", argv[i]);
+			return 2;
+		}
+	}
+	if (!indexPath || !query) {
+		fprintf(stderr, "Usage: %s --find-name <index> <name> [--prefix] [--format human|json|csv]\n", argv[0]);
+		return 2;
+	}
+
+	char key[sizeof(((NameEntry*)0)->key)] = { 0 };
+	size_t keyLen = strlen(query);
+	if (keyLen > sizeof(key)) {
+		fprintf(stderr, "Player names have %zu characters at most.\n", sizeof(key));
+		return 2;
+	}
+	for (size_t i = 0; i < keyLen; i++) {
+		key[i] = query[i] >= 'a' && query[i] <= 'z' ? (char)(query[i] - 'a' + 'A') : query[i];
+	}
+
+	MappedFile file;
+	if (mapFile(indexPath, &file) != 0) {
+		fprintf(stderr, "Couldn't open the name index %s.\n", indexPath);
+		return 2;
+	}
+	const NameHeader* header = (const NameHeader*)file.data;
+	if (file.size < sizeof(NameHeader) || memcmp(header->magic, NAMES_MAGIC, 8) != 0
+	    || header->version != NAMES_VERSION
+	    || sizeof(NameHeader) + (uint64_t)header->count * sizeof(NameEntry) > header->stringsOffset
+	    || header->stringsOffset + header->stringsSize > file.size) {
+		fprintf(stderr, "%s is not a usable name index.\n", indexPath);
+		unmapFile(&file);
+		return 2;
+	}
+	const NameEntry* entries = (const NameEntry*)(file.data + sizeof(NameHeader));
+	const char* strings = (const char*)file.data + header->stringsOffset;
+
+	// first entry whose key doesn't sort before the query; the matches follow it
+	size_t low = 0;
+	size_t high = header->count;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (memcmp(entries[mid].key, key, keyLen) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	OutBuf out = { 0 };
+	size_t matches = 0;
+	if (format == OutputCsv) {
+		outPuts(&out, "name,path,game,slot,status\n");
+	}
+	for (size_t i = low; i < header->count && memcmp(entries[i].key, key, keyLen) == 0; i++) {
+		const NameEntry* entry = &entries[i];
+		int layoutCount = 0;
+		const SlotLayout* layout = getSlotLayout((Game)entry->game, &layoutCount);
+
+		if ((!prefix && keyLen < sizeof(key) && entry->key[keyLen] != '\0') || entry->layout >= layoutCount
+		    || (uint64_t)entry->pathOffset + entry->pathLen > header->stringsSize) {
+			continue;
+		}
+		const char* path = strings + entry->pathOffset;
+		size_t nameLen = strnlen(entry->name, sizeof(entry->name));
+		const char* slot = layout[entry->layout].name;
+		const char* status = entry->valid ? "OK" : "FAIL";
+
+		switch (format) {
+			case OutputHuman:
+				outPrintf(&out, "%-8.*s %-8s %-4s %-4s %.*s\n", (int)nameLen, entry->name,
+				          getGameName((Game)entry->game), slot, status, (int)entry->pathLen, path);
+				break;
+			case OutputJson:
+				outPuts(&out, "{\"name\":");
+				outPutString(&out, format, entry->name, nameLen);
+				outPuts(&out, ",\"path\":");
+				outPutString(&out, format, path, entry->pathLen);
+				outPrintf(&out, ",\"game\":\"%s\",\"slot\":\"%s\",\"status\":\"%s\"}\n",
+				          getGameName((Game)entry->game), slot, status);
+				break;
+			case OutputCsv:
+				outPutString(&out, format, entry->name, nameLen);
+				outPutc(&out, ',');
+				outPutString(&out, format, path, entry->pathLen);
+				outPrintf(&out, ",%s,%s,%s\n", getGameName((Game)entry->game), slot, status);
+				break;
+		}
+		matches++;
+		if (out.len >= 0x10000) {
+			outFlush(&out, stdout);
+		}
+	}
+	outFlush(&out, stdout);
+	outFree(&out);
+	unmapFile(&file);
+	return matches ? 0 : 1;
+}
+
+int
+runServe(int argc, char* argv[])
+{
+	const char* socketPath = NULL;
+	int jobs = getCpuCount();
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+			socketPath = argv[++i];
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			jobs = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "Unknown serve option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!socketPath) {
+		fprintf(stderr, "Usage: %s --serve <socket> [--jobs N]\n", argv[0]);
+		return 1;
+	}
+	if (jobs < 1) jobs = 1;
+	if (jobs > SCAN_MAX_THREADS) jobs = SCAN_MAX_THREADS;
+
+	struct sockaddr_un address = { 0 };
+	if (strlen(socketPath) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", socketPath);
+		return 1;
+	}
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+		fprintf(stderr, "Couldn't initialize Winsock.\n");
+		return 1;
+	}
+	DeleteFileA(socketPath);
+#else
+	// a client hanging up must not kill the daemon
+	signal(SIGPIPE, SIG_IGN);
+	unlink(socketPath);
+#endif
+
+	SocketHandle listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == INVALID_SOCKET || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0
+	    || listen(listener, 64) != 0) {
+		fprintf(stderr, "Couldn't listen on %s.\n", socketPath);
+		if (listener != INVALID_SOCKET) {
+			closesocket(listener);
+		}
+		return 1;
+	}
+
+	// every worker blocks in accept() on the shared socket and owns the connections it gets
+	ServeWorker workers[SCAN_MAX_THREADS];
+	memset(workers, 0, sizeof(workers));
+	for (int i = 0; i < jobs; i++) {
+		workers[i].listener = listener;
+		arenaInit(&workers[i].arena, malloc(SAVE_MAP_THRESHOLD), SAVE_MAP_THRESHOLD);
+#ifdef _WIN32
+		workers[i].thread = CreateThread(NULL, 0, serveThread, &workers[i], 0, NULL);
+#else
+		pthread_create(&workers[i].thread, NULL, serveThread, &workers[i]);
+#endif
+	}
+	fprintf(stderr, "Serving on %s with %d threads\n", socketPath, jobs);
+
+	for (int i = 0; i < jobs; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(workers[i].thread, INFINITE);
+		CloseHandle(workers[i].thread);
+#else
+		pthread_join(workers[i].thread, NULL);
+#endif
+	}
+	closesocket(listener);
+	return 0;
+}
+
+static int
+receiveAll(SocketHandle connection, void* buffer, size_t len)
+{
+	uint8_t* bytes = buffer;
+	while (len > 0) {
+		int received = recv(connection, (char*)bytes, len > 0x40000000 ? 0x40000000 : (int)len, 0);
+		if (received <= 0) {
+			return -1;
+		}
+		bytes += received;
+		len -= (size_t)received;
+	}
+	return 0;
+}
+
+static int
+sendAll(SocketHandle connection, const void* buffer, size_t len)
+{
+	const uint8_t* bytes = buffer;
+	while (len > 0) {
+		int sent = send(connection, (const char*)bytes, len > 0x40000000 ? 0x40000000 : (int)len, 0);
+		if (sent <= 0) {
+			return -1;
+		}
+		bytes += sent;
+		len -= (size_t)sent;
+	}
+	return 0;
+}
+
+THREAD_FUNC(serveThread)
+{
+	ServeWorker* worker = (ServeWorker*)arg;
+	int lastError = 0;
+
+	for (;;) {
+		SocketHandle connection = accept(worker->listener, NULL, NULL);
+		if (connection == INVALID_SOCKET) {
+#ifdef _WIN32
+			int error = WSAGetLastError();
+			if (error == WSAEINTR) {
+				continue;
+			}
+			if (error == WSAENOTSOCK || error == WSAEINVAL) {
+				break;      // the listener is gone
+			}
+#else
+			int error = errno;
+			if (error == EINTR) {
+				continue;
+			}
+			if (error == EBADF || error == EINVAL) {
+				break;      // the listener is gone
+			}
+#endif
+			// out of descriptors or memory: wait for connections to close instead of spinning
+			if (error != lastError) {
+				fprintf(stderr, "Couldn't accept a connection (error %d), retrying.\n", error);
+				lastError = error;
+			}
+#ifdef _WIN32
+			Sleep(100);
+#else
+			struct timespec delay = { 0, 100000000 };
+			nanosleep(&delay, NULL);
+#endif
+			continue;
+		}
+		lastError = 0;
+
+		// requests on one connection are answered in order until the client closes it
+		uint8_t prefix[4];
+		while (receiveAll(connection, prefix, sizeof(prefix)) == 0) {
+			size_t len = readLE32(prefix);
+			if (len > SERVE_MAX_REQUEST) {
+				break;
+			}
+			if (len + 1 > worker->requestCap) {
+				uint8_t* request = realloc(worker->request, len + 1);
+				if (!request) {
+					break;
+				}
+				worker->request = request;
+				worker->requestCap = len + 1;
+			}
+			if (receiveAll(connection, worker->request, len) != 0) {
+				break;
+			}
+			worker->request[len] = '\0';
+
+			serveRequest(worker, worker->request, len);
+			if (worker->out.len < 5 || sendAll(connection, worker->out.data, worker->out.len) != 0) {
+				break;
+			}
+		}
+		closesocket(connection);
+	}
+	THREAD_RETURN;
+}
+
+static void
+finishResponse(OutBuf* out, ResponseStatus status)
+{
+	if (out->len < 5) {
+		return;             // the response buffer couldn't be allocated
+	}
+	uint32_t len = (uint32_t)out->len - 4;
+	out->data[0] = (char)len;
+	out->data[1] = (char)(len >> 8);
+	out->data[2] = (char)(len >> 16);
+	out->data[3] = (char)(len >> 24);
+	out->data[4] = (char)status;
+}
+
+// decodes one request frame (NUL terminated past its end) into worker->out
+void
+serveRequest(ServeWorker* worker, uint8_t* request, size_t len)
+{
+	OutBuf* out = &worker->out;
+	char fieldList[1024];
+	SaveImage image;
+
+	out->len = 0;
+	outPut(out, "\0\0\0\0\0", 5);
+
+	if (len < REQUEST_HEADER_SIZE) {
+		outPuts(out, "Malformed request");
+		finishResponse(out, ResponseBadRequest);
+		return;
+	}
+	uint32_t fieldsLen = readLE32(request + 4);
+	OutputFormat format = (OutputFormat)request[1];
+	if (fieldsLen >= sizeof(fieldList) || fieldsLen > len - REQUEST_HEADER_SIZE
+	    || format > OutputCsv || (request[0] != RequestPath && request[0] != RequestImage)) {
+		outPuts(out, "Malformed request");
+		finishResponse(out, ResponseBadRequest);
+		return;
+	}
+	memcpy(fieldList, request + REQUEST_HEADER_SIZE, fieldsLen);
+	fieldList[fieldsLen] = '\0';
+
+	uint8_t* payload = request + REQUEST_HEADER_SIZE + fieldsLen;
+	size_t payloadLen = len - REQUEST_HEADER_SIZE - fieldsLen;
+	LoadStatus status;
+
+	if (request[0] == RequestPath) {
+		arenaReset(&worker->arena);
+		status = loadSaveFile((const char*)payload, &worker->arena, &image);
+	} else {
+		status = parseSaveData(payload, payloadLen, "-", &image);
+	}
+	if (status != LoadOK) {
+		renderError(out, format, request[0] == RequestPath ? (const char*)payload : "-",
+		            status == LoadUnknownGame ? "UNKNOWN" : "UNREADABLE", 0);
+		finishResponse(out, ResponseLoadError);
+		return;
+	}
+
+	const SaveField* fields[MAX_SELECTED_FIELDS];
+	SaveReport report;
+	int fieldCount = fieldsLen ? selectFields(image.info.game, fieldList, fields, MAX_SELECTED_FIELDS, 0) : 0;
+	if (fieldCount < 0) {
+		outPuts(out, "Too many fields selected");
+		finishResponse(out, ResponseBadRequest);
+		freeSaveData(&image);
+		return;
+	}
+	// a client has to be able to tell a field the game lacks from one the save leaves empty
+	for (int f = 0; f < fieldCount; f++) {
+		if (!fields[f]) {
+			int nameLen = 0;
+			const char* name = getListedField(fieldList, f, &nameLen);
+			outPrintf(out, "Unknown field for %s: %.*s", getGameName(image.info.game), nameLen, name);
+			finishResponse(out, ResponseBadRequest);
+			freeSaveData(&image);
+			return;
+		}
+	}
+	checkSaveData(&image, request[2] & REQUEST_ALL_SLOTS, &report);
+
+	renderRecord(out, format, &image, report.checks, report.blockCount, fields, fieldCount,
+	             report.pairs, report.pairCount);
+	finishResponse(out, ResponseOK);
+	freeSaveData(&image);
+}
+
+// Column kernels: min, max and sum in one pass. SSE2 has no unsigned 32-bit compare, so the
+// values are flipped into signed order first; AVX2 has min/max_epu32.
+static void
+columnMinMaxSum_scalar(const uint32_t* values, size_t count, uint32_t* min, uint32_t* max, uint64_t* sum)
+{
+	for (size_t i = 0; i < count; i++) {
+		uint32_t v = values[i];
+		*min = v < *min ? v : *min;
+		*max = v > *max ? v : *max;
+		*sum += v;
+	}
+}
+
+#ifdef SAVE64_SSE2
+static void
+columnMinMaxSum_sse2(const uint32_t* values, size_t count, uint32_t* min, uint32_t* max, uint64_t* sum)
+{
+	const __m128i flip = _mm_set1_epi32((int)0x80000000u);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i low = _mm_xor_si128(_mm_set1_epi32((int)*min), flip);
+	__m128i high = _mm_xor_si128(_mm_set1_epi32((int)*max), flip);
+	__m128i total = zero;
+	uint32_t lanes[4];
+	uint64_t sums[2];
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+		__m128i s = _mm_xor_si128(v, flip);
+		__m128i less = _mm_cmplt_epi32(s, low);
+		__m128i greater = _mm_cmpgt_epi32(s, high);
+		low = _mm_or_si128(_mm_and_si128(less, s), _mm_andnot_si128(less, low));
+		high = _mm_or_si128(_mm_and_si128(greater, s), _mm_andnot_si128(greater, high));
+		total = _mm_add_epi64(total, _mm_add_epi64(_mm_unpacklo_epi32(v, zero), _mm_unpackhi_epi32(v, zero)));
+	}
+
+	_mm_storeu_si128((__m128i*)lanes, _mm_xor_si128(low, flip));
+	for (int l = 0; l < 4; l++) {
+		*min = lanes[l] < *min ? lanes[l] : *min;
+	}
+	_mm_storeu_si128((__m128i*)lanes, _mm_xor_si128(high, flip));
+	for (int l = 0; l < 4; l++) {
+		*max = lanes[l] > *max ? lanes[l] : *max;
+	}
+	_mm_storeu_si128((__m128i*)sums, total);
+	*sum += sums[0] + sums[1];
+	columnMinMaxSum_scalar(values + i, count - i, min, max, sum);
+}
+#endif
+
+#ifdef SAVE64_AVX2
+TARGET_AVX2 static void
+columnMinMaxSum_avx2(const uint32_t* values, size_t count, uint32_t* min, uint32_t* max, uint64_t* sum)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i low = _mm256_set1_epi32((int)*min);
+	__m256i high = _mm256_set1_epi32((int)*max);
+	__m256i total = zero;
+	uint32_t lanes[8];
+	uint64_t sums[4];
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+		low = _mm256_min_epu32(low, v);
+		high = _mm256_max_epu32(high, v);
+		total = _mm256_add_epi64(total, _mm256_add_epi64(_mm256_unpacklo_epi32(v, zero),
+		                                                 _mm256_unpackhi_epi32(v, zero)));
+	}
+
+	_mm256_storeu_si256((__m256i*)lanes, low);
+	for (int l = 0; l < 8; l++) {
+		*min = lanes[l] < *min ? lanes[l] : *min;
+	}
+	_mm256_storeu_si256((__m256i*)lanes, high);
+	for (int l = 0; l < 8; l++) {
+		*max = lanes[l] > *max ? lanes[l] : *max;
+	}
+	_mm256_storeu_si256((__m256i*)sums, total);
+	*sum += sums[0] + sums[1] + sums[2] + sums[3];
+	columnMinMaxSum_scalar(values + i, count - i, min, max, sum);
+}
+#endif
+
+// min and max of the values (UINT32_MAX and 0 for an empty column) and their 64-bit sum
+void
+columnMinMaxSum(const uint32_t* values, size_t count, uint32_t* min, uint32_t* max, uint64_t* sum)
+{
+	*min = UINT32_MAX;
+	*max = 0;
+	*sum = 0;
+#ifdef SAVE64_AVX2
+	if (cpuHasAvx2()) {
+		columnMinMaxSum_avx2(values, count, min, max, sum);
+		return;
+	}
+#endif
+#ifdef SAVE64_SSE2
+	columnMinMaxSum_sse2(values, count, min, max, sum);
+#else
+	columnMinMaxSum_scalar(values, count, min, max, sum);
+#endif
+}
+
+// Counts values into binCount bins of width values from min. Four partial tables keep
+// runs of equal values from serializing on one counter.
+void
+columnHistogram(const uint32_t* values, size_t count, uint32_t min, uint32_t width, int binCount, uint64_t* bins)
+{
+	uint32_t partial[4][AGG_MAX_BINS];
+	size_t i = 0;
+
+	memset(partial, 0, sizeof(partial));
+	memset(bins, 0, (size_t)binCount * sizeof(uint64_t));
+	while (i < count) {
+		// flush before the 32-bit partial counters can overflow
+		size_t end = count - i > 0x40000000 ? i + 0x40000000 : count;
+		for (; i + 4 <= end; i += 4) {
+			partial[0][(values[i] - min) / width]++;
+			partial[1][(values[i + 1] - min) / width]++;
+			partial[2][(values[i + 2] - min) / width]++;
+			partial[3][(values[i + 3] - min) / width]++;
+		}
+		for (; i < end; i++) {
+			partial[0][(values[i] - min) / width]++;
+		}
+		for (int b = 0; b < binCount; b++) {
+			bins[b] += (uint64_t)partial[0][b] + partial[1][b] + partial[2][b] + partial[3][b];
+			partial[0][b] = partial[1][b] = partial[2][b] = partial[3][b] = 0;
+		}
+	}
+}
+
+// Star counts from rows of 16 stage flag bytes (15 courses and a zero pad), 7 stars per course.
+// The vector versions count bits per byte and let psadbw add up each half row.
+static void
+countStarRows_scalar(const uint8_t* rows, size_t count, uint32_t* stars)
+{
+	for (size_t r = 0; r < count; r++) {
+		uint32_t total = 0;
+		for (int s = 0; s < AGG_STAGES; s++) {
+			total += (uint32_t)countSetBits(rows[r * 16 + s]);
+		}
+		stars[r] = total;
+	}
+}
+
+#ifdef SAVE64_SSE2
+static void
+countStarRows_sse2(const uint8_t* rows, size_t count, uint32_t* stars)
+{
+	const __m128i low7 = _mm_set1_epi8(0x7F);
+	const __m128i m1 = _mm_set1_epi8(0x55);
+	const __m128i m2 = _mm_set1_epi8(0x33);
+	const __m128i m4 = _mm_set1_epi8(0x0F);
+	const __m128i zero = _mm_setzero_si128();
+	uint64_t halves[2];
+
+	for (size_t r = 0; r < count; r++) {
+		__m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*)(rows + r * 16)), low7);
+		v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+		v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+		v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), m4);
+		_mm_storeu_si128((__m128i*)halves, _mm_sad_epu8(v, zero));
+		stars[r] = (uint32_t)(halves[0] + halves[1]);
+	}
+}
+#endif
+
+#ifdef SAVE64_AVX2
+TARGET_AVX2 static void
+countStarRows_avx2(const uint8_t* rows, size_t count, uint32_t* stars)
+{
+	const __m256i low7 = _mm256_set1_epi8(0x7F);
+	const __m256i nibbles = _mm256_set1_epi8(0x0F);
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+	                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i zero = _mm256_setzero_si256();
+	uint64_t quarters[4];
+	size_t r = 0;
+
+	// two rows per register, nibble lookups with vpshufb
+	for (; r + 2 <= count; r += 2) {
+		__m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(rows + r * 16)), low7);
+		__m256i bits = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, nibbles)),
+		                               _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibbles)));
+		_mm256_storeu_si256((__m256i*)quarters, _mm256_sad_epu8(bits, zero));
+		stars[r] = (uint32_t)(quarters[0] + quarters[1]);
+		stars[r + 1] = (uint32_t)(quarters[2] + quarters[3]);
+	}
+	countStarRows_scalar(rows + r * 16, count - r, stars + r);
+}
+#endif
+
+void
+countStarRows(const uint8_t* rows, size_t count, uint32_t* stars)
+{
+#ifdef SAVE64_AVX2
+	if (cpuHasAvx2()) {
+		countStarRows_avx2(rows, count, stars);
+		return;
+	}
+#endif
+#ifdef SAVE64_SSE2
+	countStarRows_sse2(rows, count, stars);
+#else
+	countStarRows_scalar(rows, count, stars);
+#endif
+}
+
+// The column kernels against their scalar versions, over counts that leave a tail
+void
+benchColumns(long iterations)
+{
+	struct { const char* name; void (*kernel)(const uint32_t*, size_t, uint32_t*, uint32_t*, uint64_t*); } sums[] = {
+		{ "scalar",  columnMinMaxSum_scalar },
+#ifdef SAVE64_SSE2
+		{ "sse2",    columnMinMaxSum_sse2 },
+#endif
+#ifdef SAVE64_AVX2
+		{ "avx2",    cpuHasAvx2() ? columnMinMaxSum_avx2 : NULL },
+#endif
+	};
+	struct { const char* name; void (*kernel)(const uint8_t*, size_t, uint32_t*); } stars[] = {
+		{ "scalar",  countStarRows_scalar },
+#ifdef SAVE64_SSE2
+		{ "sse2",    countStarRows_sse2 },
+#endif
+#ifdef SAVE64_AVX2
+		{ "avx2",    cpuHasAvx2() ? countStarRows_avx2 : NULL },
+#endif
+	};
+	const size_t count = (1 << 16) + 5;
+	uint32_t* values = malloc(count * sizeof(uint32_t));
+	uint8_t* rows = malloc(count * 16);
+	uint32_t* counted = malloc(count * sizeof(uint32_t));
+	uint32_t* reference = malloc(count * sizeof(uint32_t));
+	volatile uint64_t sink = 0;
+
+	if (!values || !rows || !counted || !reference) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		free(values);
+		free(rows);
+		free(counted);
+		free(reference);
+		return;
+	}
+	uint64_t state = 14;
+	for (size_t i = 0; i < count; i++) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		values[i] = (uint32_t)(state >> 32);
+	}
+	for (size_t i = 0; i < count * 16; i++) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		rows[i] = i % 16 == AGG_STAGES ? 0 : (uint8_t)(state >> 56);
+	}
+
+	uint32_t min = UINT32_MAX, max = 0;
+	uint64_t sum = 0;
+	columnMinMaxSum_scalar(values, count, &min, &max, &sum);
+	printf("Min, max and sum of %zu values, %ld iterations per kernel\n", count, iterations);
+	for (size_t k = 0; k < sizeof(sums) / sizeof(sums[0]); k++) {
+		uint32_t low = UINT32_MAX, high = 0;
+		uint64_t total = 0;
+		if (!sums[k].kernel) {
+			continue;
+		}
+		sums[k].kernel(values, count, &low, &high, &total);
+		if (low != min || high != max || total != sum) {
+			fprintf(stderr, "%s: result differs from the scalar kernel\n", sums[k].name);
+		}
+		double start = getTimeSeconds();
+		for (long i = 0; i < iterations; i++) {
+			sums[k].kernel(values, count, &low, &high, &total);
+		}
+		sink += total;
+		benchReport(sums[k].name, count * sizeof(uint32_t), iterations, getTimeSeconds() - start);
+	}
+
+	countStarRows_scalar(rows, count, reference);
+	printf("Stars of %zu SM64 rows, %ld iterations per kernel\n", count, iterations);
+	for (size_t k = 0; k < sizeof(stars) / sizeof(stars[0]); k++) {
+		if (!stars[k].kernel) {
+			continue;
+		}
+		stars[k].kernel(rows, count, counted);
+		if (memcmp(counted, reference, count * sizeof(uint32_t)) != 0) {
+			fprintf(stderr, "%s: result differs from the scalar kernel\n", stars[k].name);
+		}
+		double start = getTimeSeconds();
+		for (long i = 0; i < iterations; i++) {
+			stars[k].kernel(rows, count, counted);
+		}
+		sink += counted[0];
+		benchReport(stars[k].name, count * 16, iterations, getTimeSeconds() - start);
+	}
+	(void)sink;
+	free(values);
+	free(rows);
+	free(counted);
+	free(reference);
+}
+
+// Thread of the aggregate: extracts the selected fields of its files into its own columns
+typedef struct {
+    ThreadHandle  thread;
+    ScanQueue*    queue;
+    Column*       spec;             // the selected columns, shared and read-only
+    int           columnCount;
+    const uint16_t* stageOffsets;   // of stage1..stage15 in an SM64 save
+    int           stars;            // a stars column is selected; each row feeds all of them
+    Column        columns[AGG_MAX_COLUMNS];
+    uint8_t*      starRows;         // 16 bytes per SM64 save, turned into the stars column later
+    size_t        starCount;
+    size_t        starCap;
+    size_t        files;
+    size_t        errors;
+    SaveArena     arena;
+} AggregateWorker;
+
+static int
+columnReserve(void** data, size_t* cap, size_t count, size_t size)
+{
+	if (count < *cap) {
+		return 0;
+	}
+	size_t newCap = *cap ? *cap * 2 : 1024;
+	void* grown = realloc(*data, newCap * size);
+	if (!grown) {
+		return -1;
+	}
+	*data = grown;
+	*cap = newCap;
+	return 0;
+}
+
+// appends the selected fields of every valid primary save in the image. MM owl saves
+// are quick saves of files 1 and 2 rather than saves of their own, so they are left out.
+static void
+extractColumns(AggregateWorker* worker, const SaveImage* image)
+{
+	SlotCheck checks[MAX_SLOT_BLOCKS];
+	Game game = image->info.game;
+	int count = verifyImage(image->data, image->size, game, checks);
+
+	for (int i = 0; i < count; i++) {
+		const SlotCheck* check = &checks[i];
+		if (check->layout->backup || !check->layout->hasFields || !check->present || check->stored != check->actual
+		    || (game == Majora && strncmp(check->layout->name, "owl", 3) == 0)) {
+			continue;
+		}
+		const uint8_t* block = image->data + check->layout->offset;
+
+		if (worker->stars && game == Mario
+		    && columnReserve((void**)&worker->starRows, &worker->starCap, worker->starCount, 16) == 0) {
+			uint8_t* row = worker->starRows + worker->starCount++ * 16;
+			for (int s = 0; s < AGG_STAGES; s++) {
+				row[s] = block[worker->stageOffsets[s]];
+			}
+			row[AGG_STAGES] = 0;
+		}
+		for (int c = 0; c < worker->columnCount; c++) {
+			const Column* spec = &worker->spec[c];
+			Column* column = &worker->columns[c];
+
+			if (!spec->derived && spec->fields[game]) {
+				const SaveField* field = spec->fields[game];
+				uint32_t value = readField(block + field->offset, field->width, field->endian);
+				if (field->format == FormatSigned) {
+					int shift = 32 - field->width * 8;
+					value = (uint32_t)((int32_t)(value << shift) >> shift);
+				}
+				if (spec->isSigned) {
+					value ^= 0x80000000u;
+				}
+				if (columnReserve((void**)&column->values, &column->cap, column->count, sizeof(uint32_t)) == 0) {
+					column->values[column->count++] = value;
+				}
+			}
+		}
+	}
+}
+
+THREAD_FUNC(aggregateThread)
+{
+	AggregateWorker* worker = (AggregateWorker*)arg;
+	ScanQueue* queue = worker->queue;
+
+	for (;;) {
+		long index = atomicFetchAdd(&queue->next, 1);
+		if (index < 0 || (size_t)index >= queue->count) {
+			break;
+		}
+		SaveImage image;
+		arenaReset(&worker->arena);
+		if (loadQueuedSave(queue, (size_t)index, &worker->arena, &image) != LoadOK) {
+			worker->errors++;
+			continue;
+		}
+		worker->files++;
+		extractColumns(worker, &image);
+		freeSaveData(&image);
+	}
+	THREAD_RETURN;
+}
+
+static void
+summarizeColumn(const Column* column, int binCount, ColumnSummary* summary)
+{
+	memset(summary, 0, sizeof(ColumnSummary));
+	summary->count = column->count;
+	if (!column->count) {
+		return;
+	}
+	columnMinMaxSum(column->values, column->count, &summary->min, &summary->max, &summary->sum);
+
+	// a column spanning all 2^32 values in one bin needs a width that doesn't fit 32 bits, so
+	// the width is capped and the top value gets a second bin
+	uint64_t range = (uint64_t)summary->max - summary->min + 1;
+	uint64_t width = (range + binCount - 1) / binCount;
+	if (width > UINT32_MAX) width = UINT32_MAX;
+	if (width < 1) width = 1;
+	summary->binWidth = (uint32_t)width;
+	summary->binCount = (int)((range + width - 1) / width);
+	columnHistogram(column->values, column->count, summary->min, summary->binWidth, summary->binCount, summary->bins);
+}
+
+// value of a biased column entry as it was in the save
+static int64_t
+columnValue(const Column* column, uint32_t value)
+{
+	return column->isSigned ? (int64_t)(int32_t)(value ^ 0x80000000u) : (int64_t)value;
+}
+
+static void
+renderSummary(OutBuf* out, OutputFormat format, const Column* column, const ColumnSummary* summary)
+{
+	// the sum of biased values carries count * 0x80000000 too much
+	double mean = summary->count ? (double)summary->sum / (double)summary->count : 0.0;
+	if (column->isSigned) {
+		mean -= 2147483648.0;
+	}
+	int64_t min = summary->count ? columnValue(column, summary->min) : 0;
+	int64_t max = summary->count ? columnValue(column, summary->max) : 0;
+
+	switch (format) {
+		case OutputHuman:
+			outPrintf(out, "%-24s count %-10llu min %-8lld max %-8lld mean %.3f\n", column->name,
+			          (unsigned long long)summary->count, (long long)min, (long long)max, mean);
+			for (int b = 0; b < summary->binCount; b++) {
+				int64_t low = min + (int64_t)b * summary->binWidth;
+				int64_t high = low + summary->binWidth - 1;
+				outPrintf(out, "    %8lld", (long long)low);
+				if (summary->binWidth > 1) {
+					outPrintf(out, "-%-8lld", (long long)(high < max ? high : max));
+				} else {
+					outPuts(out, "         ");
+				}
+				outPrintf(out, " %10llu\n", (unsigned long long)summary->bins[b]);
+			}
+			break;
+
+		case OutputJson:
+			outPuts(out, "{\"field\":");
+			outPutString(out, format, column->name, strlen(column->name));
+			outPrintf(out, ",\"count\":%llu", (unsigned long long)summary->count);
+			if (summary->count) {
+				outPrintf(out, ",\"min\":%lld,\"max\":%lld,\"mean\":%.6f,\"binWidth\":%u,\"bins\":[",
+				          (long long)min, (long long)max, mean, summary->binWidth);
+				for (int b = 0; b < summary->binCount; b++) {
+					outPrintf(out, b ? ",%llu" : "%llu", (unsigned long long)summary->bins[b]);
+				}
+				outPutc(out, ']');
+			}
+			outPuts(out, "}\n");
+			break;
+
+		case OutputCsv:
+			outPutString(out, format, column->name, strlen(column->name));
+			outPrintf(out, ",%llu,%lld,%lld,%.6f,%u,", (unsigned long long)summary->count, (long long)min,
+			          (long long)max, mean, summary->binWidth);
+			for (int b = 0; b < summary->binCount; b++) {
+				outPrintf(out, b ? " %llu" : "%llu", (unsigned long long)summary->bins[b]);
+			}
+			outPutc(out, '\n');
+			break;
+	}
+}
+
+int
+runAggregate(int argc, char* argv[])
+{
+	const char* root = NULL;
+	const char* fieldList = NULL;
+	OutputFormat format = OutputHuman;
+	int binCount = AGG_DEFAULT_BINS;
+	int jobs = getCpuCount();
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--aggregate") == 0 && i + 1 < argc) {
+			root = argv[++i];
+		} else if (strcmp(argv[i], "--fields") == 0 && i + 1 < argc) {
+			fieldList = argv[++i];
+		} else if (strcmp(argv[i], "--bins") == 0 && i + 1 < argc) {
+			binCount = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			jobs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			if (parseOutputFormat(argv[++i], &format) != 0) {
+				return 1;
+			}
+		} else {
+			fprintf(stderr, "Unknown aggregate option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!root || !fieldList) {
+		fprintf(stderr, "Usage: %s --aggregate <dir|list> --fields field,field... [--jobs N] [--bins N]"
+		                " [--format human|json|csv]\n", argv[0]);
+		return 1;
+	}
+	if (binCount < 1) binCount = 1;
+	if (binCount > AGG_MAX_BINS) binCount = AGG_MAX_BINS;
+	if (jobs < 1) jobs = 1;
+	if (jobs > SCAN_MAX_THREADS) jobs = SCAN_MAX_THREADS;
+
+	// resolve every name against each game; "stars" is derived from the SM64 stage flags
+	static char names[AGG_MAX_COLUMNS][64];
+	Column spec[AGG_MAX_COLUMNS];
+	int columnCount = 0;
+	int stars = 0;
+	memset(spec, 0, sizeof(spec));
+	for (const char* name = fieldList; *name; ) {
+		size_t len = strcspn(name, ",");
+		if (len > 0) {
+			if (len >= sizeof(names[0]) || columnCount == AGG_MAX_COLUMNS) {
+				fprintf(stderr, "Too many fields selected.\n");
+				return 1;
+			}
+			Column* column = &spec[columnCount];
+			memcpy(names[columnCount], name, len);
+			names[columnCount][len] = '\0';
+			column->name = names[columnCount];
+			column->derived = strcmp(column->name, "stars") == 0;
+
+			int found = column->derived;
+			stars |= column->derived;
+			for (Game game = Ocarina; game <= Mario && !column->derived; game++) {
+				const SaveField* field = findField(game, column->name);
+				if (field && field->count == 1 && field->format != FormatText && field->format != FormatName) {
+					column->fields[game] = field;
+					column->isSigned |= field->format == FormatSigned;
+					found = 1;
+				}
+			}
+			if (!found) {
+				fprintf(stderr, "No game has a numeric field %s.\n", column->name);
+				return 1;
+			}
+			columnCount++;
+		}
+		name += len;
+		if (*name == ',') {
+			name++;
+		}
+	}
+
+	uint16_t stageOffsets[AGG_STAGES];
+	for (int s = 0; s < AGG_STAGES; s++) {
+		char name[16];
+		snprintf(name, sizeof(name), "stage%d", s + 1);
+		stageOffsets[s] = findField(Mario, name)->offset;
+	}
+
+	ScanQueue queue = { 0 };
+	if (collectSaveFiles(root, &queue) != 0) {
+		return 1;
+	}
+	if ((size_t)jobs > queue.count) {
+		jobs = queue.count ? (int)queue.count : 1;
+	}
+
+	AggregateWorker* workers = calloc((size_t)jobs, sizeof(AggregateWorker));
+	if (!workers) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		return 1;
+	}
+	double start = getTimeSeconds();
+	for (int i = 0; i < jobs; i++) {
+		workers[i].queue = &queue;
+		workers[i].spec = spec;
+		workers[i].columnCount = columnCount;
+		workers[i].stageOffsets = stageOffsets;
+		workers[i].stars = stars;
+		arenaInit(&workers[i].arena, malloc(SAVE_MAP_THRESHOLD), SAVE_MAP_THRESHOLD);
+#ifdef _WIN32
+		workers[i].thread = CreateThread(NULL, 0, aggregateThread, &workers[i], 0, NULL);
+#else
+		pthread_create(&workers[i].thread, NULL, aggregateThread, &workers[i]);
+#endif
+	}
+
+	size_t files = 0, errors = 0, starCount = 0;
+	for (int i = 0; i < jobs; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(workers[i].thread, INFINITE);
+		CloseHandle(workers[i].thread);
+#else
+		pthread_join(workers[i].thread, NULL);
+#endif
+		files += workers[i].files;
+		errors += workers[i].errors;
+		starCount += workers[i].starCount;
+	}
+	double extracted = getTimeSeconds() - start;
+
+	// concatenate the per-thread columns, then run the kernels over each whole column
+	OutBuf out = { 0 };
+	if (format == OutputCsv) {
+		outPuts(&out, "field,count,min,max,mean,binWidth,bins\n");
+	}
+	for (int c = 0; c < columnCount; c++) {
+		Column* column = &spec[c];
+		size_t total = column->derived ? starCount : 0;
+		for (int i = 0; i < jobs && !column->derived; i++) {
+			total += workers[i].columns[c].count;
+		}
+
+		column->values = malloc((total ? total : 1) * sizeof(uint32_t));
+		if (!column->values) {
+			fprintf(stderr, "Memory allocation failed.\n");
+			break;
+		}
+		for (int i = 0; i < jobs; i++) {
+			if (column->derived) {
+				countStarRows(workers[i].starRows, workers[i].starCount, column->values + column->count);
+				column->count += workers[i].starCount;
+			} else {
+				memcpy(column->values + column->count, workers[i].columns[c].values,
+				       workers[i].columns[c].count * sizeof(uint32_t));
+				column->count += workers[i].columns[c].count;
+			}
+		}
+
+		ColumnSummary summary;
+		summarizeColumn(column, binCount, &summary);
+		renderSummary(&out, format, column, &summary);
+		free(column->values);
+	}
+	double elapsed = getTimeSeconds() - start;
+	outFlush(&out, stdout);
+	outFree(&out);
+
+	fprintf(stderr, "Aggregated %zu files (%zu unreadable): extract %.3f s, kernels %.3f s with %d threads\n",
+	        files + errors, errors, extracted, elapsed - extracted, jobs);
+
+	for (int i = 0; i < jobs; i++) {
+		for (int c = 0; c < columnCount; c++) {
+			free(workers[i].columns[c].values);
+		}
+		free(workers[i].starRows);
+		free(workers[i].arena.base);
+	}
+	free(workers);
+	releaseQueue(&queue);
+	return errors ? 2 : 0;
+}
+
+#ifdef SAVE64_BIG_ENDIAN_HOST
+static uint64_t
+swap64(uint64_t value)
+{
+	return (uint64_t)_byteswap_ulong((uint32_t)value) << 32 | _byteswap_ulong((uint32_t)(value >> 32));
+}
+
+// packs are little endian, so the header and index are byteswapped on the way in and out
+static void
+convertPackHeader(PackHeader* header)
+{
+	header->version = _byteswap_ulong(header->version);
+	header->count = _byteswap_ulong(header->count);
+	header->indexOffset = swap64(header->indexOffset);
+	header->namesOffset = swap64(header->namesOffset);
+	header->namesSize = swap64(header->namesSize);
+	header->alignment = _byteswap_ulong(header->alignment);
+}
+
+static void
+convertPackEntry(PackEntry* entry)
+{
+	entry->offset = swap64(entry->offset);
+	entry->length = swap64(entry->length);
+	entry->contentHash = swap64(entry->contentHash);
+	entry->nameOffset = _byteswap_ulong(entry->nameOffset);
+	entry->nameLen = _byteswap_ushort(entry->nameLen);
+}
+#endif
+
+// a pack is recognized by its magic, whatever the file is called
+int
+isPackFile(const char* path)
+{
+	char magic[8];
+	FILE* input = fopen(path, "rb");
+	if (!input) {
+		return 0;
+	}
+	int isPack = fread(magic, 1, sizeof(magic), input) == sizeof(magic) && memcmp(magic, PACK_MAGIC, 8) == 0;
+	fclose(input);
+	return isPack;
+}
+
+// maps a pack and checks that every member and name lies inside it
+int
+openPack(const char* path, PackFile* pack)
+{
+	memset(pack, 0, sizeof(PackFile));
+	if (mapFile(path, &pack->file) != 0) {
+		fprintf(stderr, "Couldn't open the pack %s.\n", path);
+		return -1;
+	}
+
+	PackHeader header;
+	int valid = pack->file.size >= sizeof(PackHeader);
+	if (valid) {
+		memcpy(&header, pack->file.data, sizeof(PackHeader));
+#ifdef SAVE64_BIG_ENDIAN_HOST
+		convertPackHeader(&header);
+#endif
+		// every operand is bounded by the file size before it is added, so no sum can wrap
+		uint64_t size = pack->file.size;
+		valid = memcmp(header.magic, PACK_MAGIC, 8) == 0 && header.version == PACK_VERSION
+		        && header.alignment != 0 && header.indexOffset % 8 == 0
+		        && header.indexOffset <= size && header.count <= (size - header.indexOffset) / sizeof(PackEntry)
+		        && header.namesOffset <= size && header.namesSize <= size - header.namesOffset
+		        && header.indexOffset + (uint64_t)header.count * sizeof(PackEntry) <= header.namesOffset;
+	}
+	if (valid) {
+		pack->entries = (const PackEntry*)(pack->file.data + header.indexOffset);
+		pack->count = header.count;
+		pack->names = (const char*)pack->file.data + header.namesOffset;
+#ifdef SAVE64_BIG_ENDIAN_HOST
+		pack->converted = malloc((size_t)header.count * sizeof(PackEntry) + 1);
+		if (!pack->converted) {
+			fprintf(stderr, "Memory allocation failed.\n");
+			unmapFile(&pack->file);
+			return -1;
+		}
+		memcpy(pack->converted, pack->entries, (size_t)header.count * sizeof(PackEntry));
+		for (uint32_t i = 0; i < header.count; i++) {
+			convertPackEntry(&pack->converted[i]);
+		}
+		pack->entries = pack->converted;
+#endif
+	}
+	for (uint32_t i = 0; valid && i < pack->count; i++) {
+		const PackEntry* entry = &pack->entries[i];
+		valid = entry->offset <= pack->file.size && entry->length <= pack->file.size - entry->offset
+		        && (uint64_t)entry->nameOffset + entry->nameLen < header.namesSize
+		        && pack->names[entry->nameOffset + entry->nameLen] == '\0';
+	}
+	if (!valid) {
+		fprintf(stderr, "%s is not a usable pack.\n", path);
+		closePack(pack);
+		return -1;
+	}
+	return 0;
+}
+
+// Big endian members are parsed in place from the mapping. The others have to be byteswapped,
+// so they are copied into the arena first, or a heap buffer when it is full or NULL.
+LoadStatus
+loadPackMember(const PackFile* pack, size_t index, SaveArena* arena, SaveImage* image)
+{
+	const PackEntry* entry = &pack->entries[index];
+	const char* name = pack->names + entry->nameOffset;
+	const uint8_t* payload = pack->file.data + entry->offset;
+	size_t length = (size_t)entry->length;
+	uint8_t* data = (uint8_t*)payload;
+	int owned = 0;
+	FileInfo info;
+	STATS_BEGIN(start);
+	STATS_COUNT(CounterFiles, 1);
+
+	if (getFileInfo(&info, payload, length) == 0 && info.endian == LittleE) {
+		data = arena ? arenaAlloc(arena, length) : NULL;
+		if (!data) {
+			data = malloc(length);
+			owned = 1;
+		}
+		if (!data) {
+			memset(image, 0, sizeof(SaveImage));
+			image->info.path = name;
+			return LoadNoMemory;
+		}
+		memcpy(data, payload, length);
+	}
+	STATS_COUNT(CounterBytesRead, length);
+	STATS_END(StageLoad, start);
+
+	LoadStatus status = parseSaveData(data, length, name, image);
+	image->info.extension = strrchr((char*)name, '.');
+	image->borrowed = !owned;
+	if (status != LoadOK) {
+		freeSaveData(image);
+	}
+	return status;
+}
+
+void
+closePack(PackFile* pack)
+{
+	unmapFile(&pack->file);
+	free(pack->converted);
+	pack->converted = NULL;
+	pack->entries = NULL;
+	pack->names = NULL;
+	pack->count = 0;
+}
+
+// member name: relative to the packed directory, with forward slashes
+static size_t
+getMemberName(const char* path, const char* root, char* name, size_t size)
+{
+	size_t rootLen = strlen(root);
+	if (strncmp(path, root, rootLen) == 0 && (path[rootLen] == '/' || path[rootLen] == '\\')) {
+		path += rootLen;
+	}
+	while (*path == '/' || *path == '\\') {
+		path++;
+	}
+	size_t len = 0;
+	for (; path[len] && len + 1 < size; len++) {
+		name[len] = path[len] == '\\' ? '/' : path[len];
+	}
+	name[len] = '\0';
+	return len;
+}
+
+// the bytes of the queue's index-th file, straight from the pack the queue was filled from
+static int
+openPackSource(const ScanQueue* queue, size_t index, MappedFile* file)
+{
+	if (queue->pack.file.data) {
+		const PackEntry* member = &queue->pack.entries[index];
+		file->data = queue->pack.file.data + member->offset;
+		file->size = (size_t)member->length;
+		return 0;
+	}
+	return mapFile(queue->paths[index], file);
+}
+
+static void
+closePackSource(const ScanQueue* queue, MappedFile* file)
+{
+	if (!queue->pack.file.data) {
+		unmapFile(file);
+	}
+}
+
+// Packs every save under a directory (or listed in a file, or in another pack) into one file.
+// It is written to a temporary file next to the pack, which replaces it once complete.
+int
+runPack(int argc, char* argv[])
+{
+	if (argc != 4) {
+		fprintf(stderr, "Usage: %s --pack <pack> <dir|list>\n", argv[0]);
+		return 1;
+	}
+	const char* packPath = argv[2];
+	const char* root = argv[3];
+	ScanQueue queue = { 0 };
+	if (collectSaveFiles(root, &queue) != 0) {
+		return 1;
+	}
+
+	static const uint8_t padding[PACK_ALIGN];
+	char temp[4096];
+#ifdef _WIN32
+	snprintf(temp, sizeof(temp), "%s.%lu.tmp", packPath, (unsigned long)GetCurrentProcessId());
+#else
+	snprintf(temp, sizeof(temp), "%s.%ld.tmp", packPath, (long)getpid());
+#endif
+	// identical files are stored once: earlier members are found by content hash and compared
+	size_t tableSize = 1024;
+	while (tableSize < queue.count * 2) {
+		tableSize *= 2;
+	}
+	PackEntry* entries = calloc(queue.count + 1, sizeof(PackEntry));
+	size_t* sources = calloc(queue.count + 1, sizeof(size_t));
+	uint32_t* stored = calloc(tableSize, sizeof(uint32_t));
+	FILE* output = entries && sources && stored ? fopen(temp, "wb") : NULL;
+	if (!output) {
+		fprintf(stderr, "Couldn't create %s\n", temp);
+		free(entries);
+		free(sources);
+		free(stored);
+		releaseQueue(&queue);
+		return 1;
+	}
+
+	// the header goes in last, once the index is written
+	OutBuf names = { 0 };
+	uint8_t* scratch = NULL;
+	size_t scratchSize = 0;
+	uint64_t offset = PACK_ALIGN;
+	uint32_t count = 0;
+	uint32_t duplicates = 0;
+	int failed = fwrite(padding, 1, PACK_ALIGN, output) != PACK_ALIGN;
+	double start = getTimeSeconds();
+
+	for (size_t i = 0; i < queue.count && !failed; i++) {
+		MappedFile file;
+		if (openPackSource(&queue, i, &file) != 0) {
+			fprintf(stderr, "Couldn't read %s, leaving it out.\n", queue.paths[i]);
+			continue;
+		}
+
+		char name[4096];
+		PackEntry* entry = &entries[count];
+		uint64_t hash = hashBytes64(file.data, file.size, 0);
+		size_t position = (size_t)hash & (tableSize - 1);
+		const PackEntry* same = NULL;
+		for (; stored[position]; position = (position + 1) & (tableSize - 1)) {
+			const PackEntry* earlier = &entries[stored[position] - 1];
+			MappedFile original;
+			if (earlier->contentHash != hash || earlier->length != file.size
+			    || openPackSource(&queue, sources[stored[position] - 1], &original) != 0) {
+				continue;
+			}
+			int equal = memcmp(original.data, file.data, file.size) == 0;
+			closePackSource(&queue, &original);
+			if (equal) {
+				same = earlier;
+				break;
+			}
+		}
+
+		if (same) {
+			*entry = *same;
+			duplicates++;
+		} else {
+			entry->offset = offset;
+			entry->length = file.size;
+			entry->contentHash = hash;
+			stored[position] = count + 1;
+
+			// the index records what a scan of the member would find
+			if (scratchSize < file.size) {
+				free(scratch);
+				scratch = malloc(file.size);
+				scratchSize = scratch ? file.size : 0;
+			}
+			SaveImage image;
+			SaveReport report;
+			LoadStatus status = LoadNoMemory;
+			if (scratch) {
+				memcpy(scratch, file.data, file.size);
+				status = parseSaveData(scratch, file.size, queue.paths[i], &image);
+			}
+			entry->status = (uint8_t)status;
+			if (status == LoadOK) {
+				entry->game = (uint8_t)image.info.game;
+				entry->endian = (uint8_t)image.info.endian;
+				entry->blockCount = (uint8_t)checkSaveData(&image, 0, &report);
+				for (int b = 0; b < report.blockCount; b++) {
+					entry->failedBlocks += report.checks[b].present
+					                       && report.checks[b].stored != report.checks[b].actual;
+				}
+			}
+
+			size_t pad = (size_t)(-file.size & (PACK_ALIGN - 1));
+			failed = fwrite(file.data, 1, file.size, output) != file.size || fwrite(padding, 1, pad, output) != pad;
+			offset += file.size + pad;
+		}
+		entry->nameOffset = (uint32_t)names.len;
+		entry->nameLen = (uint16_t)getMemberName(queue.paths[i], root, name, sizeof(name));
+		outPut(&names, name, entry->nameLen);
+		outPutc(&names, '\0');
+		sources[count++] = i;
+		closePackSource(&queue, &file);
+	}
+	free(scratch);
+
+	PackHeader header = { PACK_MAGIC, PACK_VERSION, count, offset, offset + count * sizeof(PackEntry), names.len,
+	                      PACK_ALIGN, 0 };
+#ifdef SAVE64_BIG_ENDIAN_HOST
+	for (uint32_t i = 0; i < count; i++) {
+		convertPackEntry(&entries[i]);
+	}
+	convertPackHeader(&header);
+#endif
+	failed = failed || names.truncated
+	         || fwrite(entries, sizeof(PackEntry), count, output) != count
+	         || fwrite(names.data, 1, names.len, output) != names.len
+	         || fseek(output, 0, SEEK_SET) != 0
+	         || fwrite(&header, sizeof(header), 1, output) != 1
+	         || fflush(output) != 0;
+#ifndef _WIN32
+	failed = failed || fsync(fileno(output)) != 0;
+#endif
+	failed = fclose(output) != 0 || failed;
+	if (!failed) {
+#ifdef _WIN32
+		failed = !MoveFileExA(temp, packPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		failed = rename(temp, packPath) != 0;
+#endif
+	}
+	if (failed) {
+		fprintf(stderr, "Couldn't write %s.\n", packPath);
+		remove(temp);
+	} else {
+		fprintf(stderr, "Packed %u files (%u stored once as duplicates, %llu bytes) into %s in %.3f s\n", count,
+		        duplicates, (unsigned long long)(offset + count * sizeof(PackEntry) + names.len), packPath,
+		        getTimeSeconds() - start);
+	}
+
+	outFree(&names);
+	free(entries);
+	free(sources);
+	free(stored);
+	releaseQueue(&queue);
+	return failed ? 1 : 0;
+}
+
+// creates the directories of a path one level at a time, from the first slash after skip
+static void
+makeParentDirectories(char* path, size_t skip)
+{
+	for (char* slash = path + skip; (slash = strchr(slash, '/')) != NULL; slash++) {
+		*slash = '\0';
+		makeDirectory(path);
+		*slash = '/';
+	}
+}
+
+// member names come from the pack, so nothing may point outside the destination
+static int
+isSafeMemberName(const char* name)
+{
+	if (name[0] == '\0' || name[0] == '/' || name[0] == '\\' || strchr(name, ':')) {
+		return 0;
+	}
+	for (const char* part = name; *part; ) {
+		size_t len = strcspn(part, "/\\");
+		if (len == 0 || (len == 2 && part[0] == '.' && part[1] == '.')) {
+			return 0;
+		}
+		part += len;
+		if (*part) {
+			part++;
+		}
+	}
+	return 1;
+}
+
+// Writes every member of a pack back out under dir, after checking its content hash
+int
+runUnpack(int argc, char* argv[])
+{
+	if (argc != 4) {
+		fprintf(stderr, "Usage: %s --unpack <pack> <dir>\n", argv[0]);
+		return 1;
+	}
+	const char* root = argv[3];
+	PackFile pack;
+	if (openPack(argv[2], &pack) != 0) {
+		return 1;
+	}
+	if (makeDirectory(root) != 0) {
+		fprintf(stderr, "Couldn't create %s\n", root);
+		closePack(&pack);
+		return 1;
+	}
+
+	size_t errors = 0;
+	uint64_t bytes = 0;
+	double start = getTimeSeconds();
+	for (uint32_t i = 0; i < pack.count; i++) {
+		const PackEntry* entry = &pack.entries[i];
+		const char* name = pack.names + entry->nameOffset;
+		const uint8_t* payload = pack.file.data + entry->offset;
+		char path[4096];
+
+		if (!isSafeMemberName(name)) {
+			fprintf(stderr, "Skipping the member %s, its name leaves the destination.\n", name);
+			errors++;
+			continue;
+		}
+		if (hashBytes64(payload, (size_t)entry->length, 0) != entry->contentHash) {
+			fprintf(stderr, "Skipping the member %s, its content hash doesn't match.\n", name);
+			errors++;
+			continue;
+		}
+		if ((size_t)snprintf(path, sizeof(path), "%s/%s", root, name) >= sizeof(path)) {
+			fprintf(stderr, "Skipping the member %s, its path is too long.\n", name);
+			errors++;
+			continue;
+		}
+
+		makeParentDirectories(path, strlen(root) + 1);
+		FILE* output = fopen(path, "wb");
+		if (!output || fwrite(payload, 1, (size_t)entry->length, output) != entry->length) {
+			fprintf(stderr, "Couldn't write %s\n", path);
+			errors++;
+		} else {
+			bytes += entry->length;
+		}
+		if (output && fclose(output) != 0) {
+			errors++;
+		}
+	}
+
+	fprintf(stderr, "Unpacked %u files (%llu bytes, %zu errors) to %s in %.3f s\n", pack.count - (uint32_t)errors,
+	        (unsigned long long)bytes, errors, root, getTimeSeconds() - start);
+	closePack(&pack);
+	return errors ? 2 : 0;
+}
+
+static int
+compareFieldOffsets(const void* a, const void* b)
+{
+	const SaveField* x = *(const SaveField* const*)a;
+	const SaveField* y = *(const SaveField* const*)b;
+	return (int)x->offset - (int)y->offset;
+}
+
+// one changed field element, or a run of changed bytes no field covers
+static void
+renderChange(OutBuf* out, OutputFormat format, int* first, const char* block, const char* name, long index,
+             uint32_t offset, const uint8_t* oldData, const uint8_t* newData, size_t len,
+             const SaveField* field, const SaveImage* a, const SaveImage* b)
+{
+	const uint8_t* data[2] = { oldData, newData };
+	const SaveImage* images[2] = { a, b };
+
+	switch (format) {
+		case OutputHuman:
+			outPuts(out, block);
+			outPutc(out, '\t');
+			outPuts(out, name);
+			if (index >= 0) {
+				outPrintf(out, "[%ld]", index);
+			}
+			outPuts(out, "\t0x");
+			outPutHex(out, offset, 4);
+			outPutc(out, '\t');
+			break;
+		case OutputJson:
+			outPuts(out, *first ? "{\"slot\":\"" : ",{\"slot\":\"");
+			outPuts(out, block);
+			outPuts(out, "\",\"field\":\"");
+			outPuts(out, name);
+			outPutc(out, '"');
+			if (index >= 0) {
+				outPrintf(out, ",\"index\":%ld", index);
+			}
+			outPrintf(out, ",\"offset\":%u,\"old\":", offset);
+			break;
+		case OutputCsv:
+			outPrintf(out, "%s,%s,", block, name);
+			if (index >= 0) {
+				outPrintf(out, "%ld", index);
+			}
+			outPrintf(out, ",%u,", offset);
+			break;
+	}
+	*first = 0;
+
+	for (int side = 0; side < 2; side++) {
+		if (side) {
+			outPuts(out, format == OutputHuman ? " -> " : format == OutputJson ? ",\"new\":" : ",");
+		}
+		if (field) {
+			putField(out, format, field, data[side], images[side]->info.charset);
+			continue;
+		}
+		// raw bytes as hex, long runs cut short
+		if (format != OutputHuman) outPutc(out, '"');
+		for (size_t i = 0; i < len && i < 32; i++) {
+			outPutHex(out, data[side][i], 2);
+		}
+		if (len > 32) {
+			outPuts(out, "...");
+		}
+		if (format != OutputHuman) outPutc(out, '"');
+	}
+	outPuts(out, format == OutputJson ? "}" : "\n");
+}
+
+// Finds the changed regions of two normalized images of the same game with the vectorized
+// compare, and renders only the field elements those regions touch. Returns the number of
+// changes, bytes receives the number of differing bytes.
+size_t
+diffImages(OutBuf* out, OutputFormat format, const SaveImage* a, const SaveImage* b, size_t* bytes)
+{
+	int blockCount = 0;
+	const SlotLayout* layout = getSlotLayout(a->info.game, &blockCount);
+	size_t tableSize = 0;
+	const SaveField* table = getFieldTable(a->info.game, &tableSize);
+	const SaveField* fields[MAX_SELECTED_FIELDS];
+	size_t fieldCount = 0;
+	size_t size = a->size < b->size ? a->size : b->size;
+	size_t changes = 0;
+	int first = 1;
+
+	for (size_t f = 0; f < tableSize && f < MAX_SELECTED_FIELDS; f++) {
+		fields[fieldCount++] = &table[f];
+	}
+	qsort(fields, fieldCount, sizeof(fields[0]), compareFieldOffsets);
+
+	*bytes = 0;
+	for (size_t start = 0; ; ) {
+		start += compareBlocks(a->data + start, b->data + start, size - start);
+		if (start >= size) {
+			break;
+		}
+		size_t end = start + 1;
+		while (end < size && a->data[end] != b->data[end]) {
+			end++;
+		}
+		*bytes += end - start;
+
+		// the region may cross block boundaries, so it's taken a block (or gap) at a time
+		while (start < end) {
+			const SlotLayout* block = NULL;
+			size_t blockEnd = end;
+			for (int i = 0; i < blockCount; i++) {
+				size_t blockStart = layout[i].offset;
+				size_t length = (size_t)layout[i].chkOffset + sizeof(uint16_t);
+				if (start >= blockStart && start < blockStart + length) {
+					block = &layout[i];
+					blockEnd = blockStart + length < end ? blockStart + length : end;
+					break;
+				}
+				if (blockStart > start && blockStart < blockEnd) {
+					blockEnd = blockStart;
+				}
+			}
+			if (!block || !block->hasFields) {
+				renderChange(out, format, &first, block ? block->name : "-", "bytes", -1, (uint32_t)start,
+				             a->data + start, b->data + start, blockEnd - start, NULL, a, b);
+				changes++;
+				start = blockEnd;
+				continue;
+			}
+
+			// walk the block's fields in offset order over the changed part of the block
+			const uint8_t* oldBlock = a->data + block->offset;
+			const uint8_t* newBlock = b->data + block->offset;
+			size_t rel = start - block->offset;
+			size_t relEnd = blockEnd - block->offset;
+			size_t f = 0;
+			while (rel < relEnd) {
+				while (f < fieldCount && fields[f]->offset + (size_t)fields[f]->width * fields[f]->count <= rel) {
+					f++;
+				}
+				const SaveField* field = f < fieldCount ? fields[f] : NULL;
+				if (!field || field->offset > rel) {
+					size_t gapEnd = field && field->offset < relEnd ? field->offset : relEnd;
+					renderChange(out, format, &first, block->name, "bytes", -1, (uint32_t)(block->offset + rel),
+					             oldBlock + rel, newBlock + rel, gapEnd - rel, NULL, a, b);
+					changes++;
+					rel = gapEnd;
+					continue;
+				}
+
+				// text and names change as a whole, arrays one element at a time
+				SaveField element = *field;
+				long index = -1;
+				size_t next = field->offset + (size_t)field->width * field->count;
+				if (field->count > 1 && field->format != FormatText && field->format != FormatName) {
+					index = (long)((rel - field->offset) / field->width);
+					element.offset = (uint16_t)(field->offset + index * field->width);
+					element.count = 1;
+					next = element.offset + field->width;
+				}
+				if (compareBlocks(oldBlock + element.offset, newBlock + element.offset,
+				                  (size_t)element.width * element.count) < (size_t)element.width * element.count) {
+					renderChange(out, format, &first, block->name, field->name, index,
+					             (uint32_t)(block->offset + element.offset), oldBlock, newBlock, 0, &element, a, b);
+					changes++;
+				}
+				rel = next;
+			}
+			start = blockEnd;
+
+			// a field reaching past the region was reported whole, so its other bytes are skipped
+			for (size_t consumed = block->offset + rel; start < consumed && start < size; start++) {
+				*bytes += a->data[start] != b->data[start];
+			}
+		}
+	}
+	return changes;
+}
+
+// Compares two saves of the same game. Exits with 0 when they are identical, 1 when they
+// differ and 2 when they can't be compared, like diff(1).
+int
+runDiff(int argc, char* argv[])
+{
+	const char* paths[2] = { NULL, NULL };
+	OutputFormat format = OutputHuman;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			if (parseOutputFormat(argv[++i], &format) != 0) {
+				return 2;
+			}
+		} else if (!paths[0]) {
+			paths[0] = argv[i];
+		} else if (!paths[1]) {
+			paths[1] = argv[i];
+		} else {
+			fprintf(stderr, "Too many arguments provided.\n");
+			return 2;
+		}
+	}
+	if (!paths[1]) {
+		fprintf(stderr, "Usage: %s --diff <old> <new> [--format human|json|csv]\n", argv[0]);
+		return 2;
+	}
+
+	SaveImage images[2];
+	for (int i = 0; i < 2; i++) {
+		LoadStatus status = loadSaveFile(paths[i], NULL, &images[i]);
+		if (status != LoadOK) {
+			fprintf(stderr, "%s: %s.\n", paths[i], getLoadError(status));
+			if (i) {
+				freeSaveData(&images[0]);
+			}
+			return 2;
+		}
+	}
+	if (images[0].info.game != images[1].info.game) {
+		fprintf(stderr, "%s is %s, but %s is %s.\n", paths[0], getGameName(images[0].info.game), paths[1],
+		        getGameName(images[1].info.game));
+		freeSaveData(&images[0]);
+		freeSaveData(&images[1]);
+		return 2;
+	}
+
+	OutBuf out = { 0 };
+	size_t bytes = 0;
+	if (format == OutputCsv) {
+		outPuts(&out, "slot,field,index,offset,old,new\n");
+	} else if (format == OutputJson) {
+		outPuts(&out, "{\"old\":");
+		outPutString(&out, format, paths[0], strlen(paths[0]));
+		outPuts(&out, ",\"new\":");
+		outPutString(&out, format, paths[1], strlen(paths[1]));
+		outPuts(&out, ",\"game\":\"");
+		outPuts(&out, getGameName(images[0].info.game));
+		outPuts(&out, "\",\"changes\":[");
+	}
+	size_t changes = diffImages(&out, format, &images[0], &images[1], &bytes);
+	if (format == OutputJson) {
+		outPuts(&out, "]}\n");
+	}
+	outFlush(&out, stdout);
+	outFree(&out);
+
+	if (images[0].size != images[1].size) {
+		fprintf(stderr, "The images differ in size: %zu and %zu bytes, only the common part was compared.\n",
+		        images[0].size, images[1].size);
+	}
+	fprintf(stderr, "%zu bytes differ, %zu changes\n", bytes, changes);
+	int differ = bytes != 0 || images[0].size != images[1].size;
+	freeSaveData(&images[0]);
+	freeSaveData(&images[1]);
+	return differ ? 1 : 0;
+}
+
+#ifdef __linux__
+static WatchedFile*
+findWatchedFile(WatchedFile* files, size_t count, const char* path)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (strcmp(files[i].path, path) == 0) {
+			return &files[i];
+		}
+	}
+	return NULL;
+}
+
+static WatchedFile*
+addWatchedFile(WatchedFile** files, size_t* count, size_t* capacity, const char* path)
+{
+	if (*count == *capacity) {
+		size_t grown = *capacity ? *capacity * 2 : 16;
+		WatchedFile* resized = realloc(*files, grown * sizeof(WatchedFile));
+		if (!resized) {
+			return NULL;
+		}
+		*files = resized;
+		*capacity = grown;
+	}
+	WatchedFile* file = &(*files)[*count];
+	memset(file, 0, sizeof(WatchedFile));
+	file->path = malloc(strlen(path) + 1);
+	if (!file->path) {
+		return NULL;
+	}
+	strcpy(file->path, path);
+	(*count)++;
+	return file;
+}
+
+// watches a directory once, however many of its files are named
+static WatchedDir*
+addWatchedDir(int notify, WatchedDir* dirs, size_t* count, const char* path)
+{
+	for (size_t i = 0; i < *count; i++) {
+		if (strcmp(dirs[i].path, path) == 0) {
+			return &dirs[i];
+		}
+	}
+	if (*count == WATCH_MAX_PATHS) {
+		fprintf(stderr, "Too many directories to watch.\n");
+		return NULL;
+	}
+	int wd = inotify_add_watch(notify, path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM);
+	char* copy = malloc(strlen(path) + 1);
+	if (wd < 0 || !copy) {
+		perror(path);
+		free(copy);
+		return NULL;
+	}
+	strcpy(copy, path);
+	WatchedDir* dir = &dirs[(*count)++];
+	dir->wd = wd;
+	dir->path = copy;
+	dir->all = 0;
+	return dir;
+}
+
+// Reloads a file and emits one event with the blocks that differ from the last image.
+// Rewrites that leave every block as it was emit nothing.
+static void
+updateWatchedFile(OutBuf* out, WatchedFile* file, const char* event, const SaveField* const fields[3][MAX_SELECTED_FIELDS],
+                  const int* fieldCount)
+{
+	uint64_t start = getTimeNs();
+	SaveImage image;
+	LoadStatus status = loadSaveFile(file->path, NULL, &image);
+
+	if (status != LoadOK) {
+		outPuts(out, "{\"event\":\"error\",\"path\":");
+		outPutString(out, OutputJson, file->path, strlen(file->path));
+		outPrintf(out, ",\"error\":\"%s\"}\n", status == LoadUnknownGame ? "UNKNOWN" : "UNREADABLE");
+		return;
+	}
+
+	int layoutCount = 0;
+	const SlotLayout* layout = getSlotLayout(image.info.game, &layoutCount);
+	int comparable = file->previous && file->game == image.info.game && file->size == image.size;
+	SlotCheck checks[MAX_SLOT_BLOCKS];
+	int changed = 0;
+	for (int i = 0; i < layoutCount && i < MAX_SLOT_BLOCKS; i++) {
+		size_t length = (size_t)layout[i].chkOffset + sizeof(uint16_t);
+		if (layout[i].offset + length > image.size) {
+			break;
+		}
+		if (comparable && compareBlocks(file->previous + layout[i].offset, image.data + layout[i].offset,
+		                                length) == length) {
+			continue;
+		}
+		checkBlock(image.data + layout[i].offset, &layout[i], &checks[changed++]);
+	}
+
+	if (changed) {
+		Game game = image.info.game;
+		outPrintf(out, "{\"event\":\"%s\",\"blocks\":%d,\"decodeUs\":%.1f,\"record\":", event, changed,
+		          (double)(getTimeNs() - start) / 1e3);
+		renderRecord(out, OutputJson, &image, checks, changed, fields[game], fieldCount[game], NULL, 0);
+		if (out->len && out->data[out->len - 1] == '\n') {
+			out->len--;
+		}
+		outPuts(out, "}\n");
+	}
+
+	if (file->size != image.size || !file->previous) {
+		uint8_t* resized = realloc(file->previous, image.size);
+		if (!resized) {
+			free(file->previous);
+		}
+		file->previous = resized;
+	}
+	if (file->previous) {
+		memcpy(file->previous, image.data, image.size);
+	}
+	file->size = image.size;
+	file->game = image.info.game;
+	freeSaveData(&image);
+}
+#endif
+
+// Follows files (or every save file in a directory) with inotify and streams an NDJSON event
+// for each write that changes any block. Only the changed blocks are checked and decoded.
+int
+runWatch(int argc, char* argv[])
+{
+#ifndef __linux__
+	fprintf(stderr, "%s --watch needs Linux inotify.\n", argv[0]);
+	return 1;
+#else
+	const char* fieldList = NULL;
+	const char* paths[WATCH_MAX_PATHS];
+	int pathCount = 0;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--fields") == 0 && i + 1 < argc) {
+			fieldList = argv[++i];
+		} else if (pathCount < WATCH_MAX_PATHS) {
+			paths[pathCount++] = argv[i];
+		} else {
+			fprintf(stderr, "Too many paths to watch.\n");
+			return 1;
+		}
+	}
+	if (pathCount == 0) {
+		fprintf(stderr, "Usage: %s --watch <file|dir>... [--fields field,field...]\n", argv[0]);
+		return 1;
+	}
+
+	// every field of the game unless some were picked
+	const SaveField* fields[3][MAX_SELECTED_FIELDS];
+	int fieldCount[3] = { 0 };
+	for (Game game = Ocarina; game <= Mario; game++) {
+		if (fieldList) {
+			fieldCount[game] = selectFields(game, fieldList, fields[game], MAX_SELECTED_FIELDS, 0);
+			if (fieldCount[game] < 0) {
+				return 1;
+			}
+		} else {
+			size_t tableSize = 0;
+			const SaveField* table = getFieldTable(game, &tableSize);
+			for (size_t f = 0; f < tableSize && f < MAX_SELECTED_FIELDS; f++) {
+				fields[game][fieldCount[game]++] = &table[f];
+			}
+		}
+	}
+
+	int notify = inotify_init1(IN_CLOEXEC);
+	if (notify < 0) {
+		perror("inotify_init1");
+		return 1;
+	}
+	WatchedDir dirs[WATCH_MAX_PATHS];
+	size_t dirCount = 0;
+	WatchedFile* files = NULL;
+	size_t fileCount = 0, fileCapacity = 0;
+	OutBuf out = { 0 };
+	char path[4096];
+
+	for (int i = 0; i < pathCount; i++) {
+		struct stat st;
+		if (stat(paths[i], &st) != 0) {
+			perror(paths[i]);
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			WatchedDir* dir = addWatchedDir(notify, dirs, &dirCount, paths[i]);
+			DIR* handle = dir ? opendir(paths[i]) : NULL;
+			struct dirent* entry;
+			if (dir) {
+				dir->all = 1;
+			}
+			while (handle && (entry = readdir(handle)) != NULL) {
+				snprintf(path, sizeof(path), "%s/%s", paths[i], entry->d_name);
+				if (hasSaveExtension(entry->d_name) && stat(path, &st) == 0 && S_ISREG(st.st_mode)
+				    && !findWatchedFile(files, fileCount, path)) {
+					addWatchedFile(&files, &fileCount, &fileCapacity, path);
+				}
+			}
+			if (handle) {
+				closedir(handle);
+			}
+			continue;
+		}
+
+		const char* slash = strrchr(paths[i], '/');
+		if (slash) {
+			snprintf(path, sizeof(path), "%.*s", (int)(slash == paths[i] ? 1 : slash - paths[i]), paths[i]);
+		} else {
+			strcpy(path, ".");
+		}
+		if (addWatchedDir(notify, dirs, &dirCount, path) && !findWatchedFile(files, fileCount, paths[i])) {
+			addWatchedFile(&files, &fileCount, &fileCapacity, paths[i]);
+		}
+	}
+	if (dirCount == 0) {
+		close(notify);
+		return 1;
+	}
+
+	// the state everything later is compared against
+	for (size_t i = 0; i < fileCount; i++) {
+		updateWatchedFile(&out, &files[i], "initial", fields, fieldCount);
+	}
+	outFlush(&out, stdout);
+	fflush(stdout);
+	fprintf(stderr, "Watching %zu files in %zu directories\n", fileCount, dirCount);
+
+	// blocks in read() until something is written: no polling
+	_Alignas(struct inotify_event) char events[16 * 1024];
+	for (;;) {
+		ssize_t len = read(notify, events, sizeof(events));
+		if (len < 0 && errno == EINTR) {
+			continue;
+		}
+		if (len <= 0) {
+			perror("inotify");
+			break;
+		}
+		for (char* next = events; next < events + len; ) {
+			const struct inotify_event* event = (const struct inotify_event*)next;
+			next += sizeof(struct inotify_event) + event->len;
+
+			const WatchedDir* dir = NULL;
+			for (size_t d = 0; d < dirCount && !dir; d++) {
+				dir = dirs[d].wd == event->wd ? &dirs[d] : NULL;
+			}
+			if (!dir || event->len == 0) {
+				continue;
+			}
+			if (strcmp(dir->path, ".") == 0) {
+				snprintf(path, sizeof(path), "%s", event->name);
+			} else {
+				snprintf(path, sizeof(path), "%s/%s", dir->path, event->name);
+			}
+
+			WatchedFile* file = findWatchedFile(files, fileCount, path);
+			if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				if (file && file->previous) {
+					outPuts(&out, "{\"event\":\"removed\",\"path\":");
+					outPutString(&out, OutputJson, file->path, strlen(file->path));
+					outPuts(&out, "}\n");
+					free(file->previous);
+					file->previous = NULL;
+				}
+				continue;
+			}
+			if (!file && dir->all && hasSaveExtension(event->name)) {
+				file = addWatchedFile(&files, &fileCount, &fileCapacity, path);
+			}
+			if (file) {
+				updateWatchedFile(&out, file, file->previous ? "change" : "initial", fields, fieldCount);
+			}
+		}
+		// one write per batch of inotify events keeps the latency to a single syscall
+		outFlush(&out, stdout);
+		fflush(stdout);
+	}
+
+	for (size_t i = 0; i < fileCount; i++) {
+		free(files[i].path);
+		free(files[i].previous);
+	}
+	for (size_t d = 0; d < dirCount; d++) {
+		free(dirs[d].path);
+	}
+	free(files);
+	outFree(&out);
+	close(notify);
+	return 1;
+#endif
+}
+
+// Thread of the converter: reads, re-checks, byteswaps and writes whole files
+typedef struct {
+	ThreadHandle  thread;
+	int           id;               // tells the temporary files of the threads apart
+	ScanQueue*    queue;
+	const char*   root;             // source, stripped from the paths to name the outputs
+	const char*   destination;
+	Endian        target;
+	SaveArena     arena;
+	size_t        swapped;          // files written in the other byte order
+	size_t        copied;           // files already in the target order, or SM64 EEPROMs
+	size_t        errors;
+	size_t        failed;           // slots with a checksum mismatch, converted all the same
+	uint64_t      bytes;
+} ConvertWorker;
+
+// Writes the whole image with one unbuffered write, to a temporary name first. The source may
+// be mapped, and replacing it by rename keeps the mapping valid if both are the same file.
+static int
+writeConverted(const char* path, int worker, const uint8_t* data, size_t size)
+{
+	char temp[4096 + 32];
+#ifdef _WIN32
+	snprintf(temp, sizeof(temp), "%s.%lu-%d.tmp", path, (unsigned long)GetCurrentProcessId(), worker);
+#else
+	snprintf(temp, sizeof(temp), "%s.%ld-%d.tmp", path, (long)getpid(), worker);
+#endif
+	FILE* output = fopen(temp, "wb");
+	if (!output) {
+		return -1;
+	}
+	setvbuf(output, NULL, _IONBF, 0);
+	int failed = fwrite(data, 1, size, output) != size;
+	failed = fclose(output) != 0 || failed;
+#ifdef _WIN32
+	failed = failed || !MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+	failed = failed || rename(temp, path) != 0;
+#endif
+	if (failed) {
+		remove(temp);
+	}
+	return failed ? -1 : 0;
+}
+
+// Every thread runs a file through all the stages, so with more threads than cores the reads
+// and writes of some files overlap the byteswapping of others.
+THREAD_FUNC(convertThread)
+{
+	ConvertWorker* worker = (ConvertWorker*)arg;
+	ScanQueue* queue = worker->queue;
+	char path[4096];
+	char name[4096];
+
+	for (;;) {
+		long index = atomicFetchAdd(&queue->next, 1);
+		if (index < 0 || (size_t)index >= queue->count) {
+			break;
+		}
+		const char* source = queue->paths[index];
+		SaveImage image;
+		SaveReport report;
+
+		arenaReset(&worker->arena);
+		LoadStatus status = loadQueuedSave(queue, (size_t)index, &worker->arena, &image);
+		if (status != LoadOK) {
+			fprintf(stderr, "%s: %s, not converted.\n", source, getLoadError(status));
+			worker->errors++;
+			continue;
+		}
+
+		// the image is big endian now, whatever it was on disk
+		checkSaveData(&image, 0, &report);
+		for (int i = 0; i < report.blockCount; i++) {
+			const SlotCheck* check = &report.checks[i];
+			if (check->present && check->stored != check->actual) {
+				fprintf(stderr, "%s: slot %s checksum %04x, expected %04x\n", source, check->layout->name,
+				        check->stored, check->actual);
+				worker->failed++;
+			}
+		}
+		Endian target = image.info.game == Mario ? BigE : worker->target;
+		uint8_t* output = image.data;
+		uint8_t* copy = NULL;
+		if (target == LittleE) {
+			// big endian pack members are the read-only mapping itself
+			const PackFile* pack = &queue->pack;
+			if (pack->file.data && image.data >= pack->file.data && image.data < pack->file.data + pack->file.size) {
+				output = arenaAlloc(&worker->arena, image.size);
+				if (!output) {
+					output = copy = malloc(image.size);
+				}
+				if (!output) {
+					fprintf(stderr, "%s: %s, not converted.\n", source, getLoadError(LoadNoMemory));
+					worker->errors++;
+					continue;
+				}
+				memcpy(output, image.data, image.size);
+			}
+			STATS_BEGIN(swapStart);
+			swapWords32(output, image.size);
+			STATS_END(StageSwap, swapStart);
+		}
+
+		getMemberName(source, worker->root, name, sizeof(name));
+		if ((size_t)snprintf(path, sizeof(path), "%s/%s", worker->destination, name) >= sizeof(path)) {
+			fprintf(stderr, "%s: the output path is too long.\n", source);
+			worker->errors++;
+			free(copy);
+			freeSaveData(&image);
+			continue;
+		}
+		makeParentDirectories(path, strlen(worker->destination) + 1);
+		if (writeConverted(path, worker->id, output, image.size) != 0) {
+			fprintf(stderr, "Couldn't write %s\n", path);
+			worker->errors++;
+		} else {
+			if (target == image.info.endian) {
+				worker->copied++;
+			} else {
+				worker->swapped++;
+			}
+			worker->bytes += image.size;
+		}
+		free(copy);
+		freeSaveData(&image);
+	}
+	THREAD_RETURN;
+}
+
+// Converts every save under a directory (or listed in a file, or in a pack) to one byte order,
+// keeping the relative paths and the names
+int
+runConvert(int argc, char* argv[])
+{
+	const char* root = NULL;
+	const char* destination = NULL;
+	const char* order = NULL;
+	int jobs = getCpuCount() * 2;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+			order = argv[++i];
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			jobs = atoi(argv[++i]);
+		} else if (!root) {
+			root = argv[i];
+		} else if (!destination) {
+			destination = argv[i];
+		} else {
+			fprintf(stderr, "Too many arguments provided.\n");
+			return 1;
+		}
+	}
+	if (!destination || !order || (strcmp(order, "big") != 0 && strcmp(order, "little") != 0)) {
+		fprintf(stderr, "Usage: %s --convert <dir|list|pack> <dir> --to big|little [--jobs N]\n", argv[0]);
+		return 1;
+	}
+	if (jobs < 1) jobs = 1;
+	if (jobs > SCAN_MAX_THREADS) jobs = SCAN_MAX_THREADS;
+
+	ScanQueue queue = { 0 };
+	if (collectSaveFiles(root, &queue) != 0) {
+		return 1;
+	}
+	if (makeDirectory(destination) != 0) {
+		fprintf(stderr, "Couldn't create %s\n", destination);
+		releaseQueue(&queue);
+		return 1;
+	}
+	if ((size_t)jobs > queue.count) {
+		jobs = queue.count ? (int)queue.count : 1;
+	}
+
+	ConvertWorker workers[SCAN_MAX_THREADS];
+	memset(workers, 0, sizeof(workers));
+	double start = getTimeSeconds();
+	for (int i = 0; i < jobs; i++) {
+		workers[i].id = i;
+		workers[i].queue = &queue;
+		workers[i].root = root;
+		workers[i].destination = destination;
+		workers[i].target = strcmp(order, "big") == 0 ? BigE : LittleE;
+		arenaInit(&workers[i].arena, malloc(SAVE_MAP_THRESHOLD), SAVE_MAP_THRESHOLD);
+#ifdef _WIN32
+		workers[i].thread = CreateThread(NULL, 0, convertThread, &workers[i], 0, NULL);
+#else
+		pthread_create(&workers[i].thread, NULL, convertThread, &workers[i]);
+#endif
+	}
+
+	ConvertWorker total = { 0 };
+	for (int i = 0; i < jobs; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(workers[i].thread, INFINITE);
+		CloseHandle(workers[i].thread);
+#else
+		pthread_join(workers[i].thread, NULL);
+#endif
+		total.swapped += workers[i].swapped;
+		total.copied  += workers[i].copied;
+		total.errors  += workers[i].errors;
+		total.failed  += workers[i].failed;
+		total.bytes   += workers[i].bytes;
+		free(workers[i].arena.base);
+	}
+	double elapsed = getTimeSeconds() - start;
+
+	fprintf(stderr, "Converted %zu files to %s endian (%zu byteswapped, %zu already in order, %zu not converted),"
+	                " %zu checksum failures\n", total.swapped + total.copied, order, total.swapped, total.copied,
+	        total.errors, total.failed);
+	fprintf(stderr, "%.3f s with %d threads: %.1f MB/s\n", elapsed, jobs,
+	        elapsed > 0.0 ? (double)total.bytes / elapsed / 1e6 : 0.0);
+	releaseQueue(&queue);
+	return total.errors || total.failed ? 2 : 0;
+}
+
+// Where a save can start relative to one of the magic words found in a dump
+typedef struct {
+	uint32_t      back;             // bytes from the start of the save to the magic
+	Game          game;
+} CarveStart;
+
+// Checks whether a save of the given game starts at offset start of the dump: it has to be
+// identified as that game, and its blocks are checked. Returns the number of blocks holding a
+// save with a matching checksum, 0 when the candidate doesn't hold up.
+static int
+verifyCarveCandidate(const MappedFile* dump, uint64_t start, Game game, uint8_t* scratch, SaveReport* report,
+                     size_t* length, Endian* endian)
+{
+	SaveImage image;
+	int valid = 0;
+
+	*length = getMediaSize(game);
+	if (start >= dump->size) {
+		return 0;
+	}
+	if (*length > dump->size - start) {
+		*length = (size_t)(dump->size - start);
+	}
+	if (*length < getSaveSize(game)) {
+		return 0;
+	}
+
+	// identified in the dump first, as most candidates fail here. The image is normalized in
+	// place, so it is checked in a copy.
+	FileInfo info;
+	if (getFileInfo(&info, dump->data + start, *length) != 0 || info.game != game) {
+		return 0;
+	}
+	memcpy(scratch, dump->data + start, *length);
+	if (parseSaveData(scratch, *length, NULL, &image) != LoadOK || image.info.game != game) {
+		return 0;
+	}
+	checkSaveData(&image, 0, report);
+	for (int i = 0; i < report->blockCount; i++) {
+		valid += report->checks[i].present && report->checks[i].stored == report->checks[i].actual;
+	}
+	*endian = image.info.endian;
+	return valid;
+}
+
+static void
+renderCarved(OutBuf* out, OutputFormat format, uint64_t offset, Game game, Endian endian, size_t length,
+             const SaveReport* report, const char* path)
+{
+	int present = 0, valid = 0;
+	for (int i = 0; i < report->blockCount; i++) {
+		present += report->checks[i].present;
+		valid += report->checks[i].present && report->checks[i].stored == report->checks[i].actual;
+	}
+	const char* order = endian == LittleE ? "little" : "big";
+	int truncated = length < getMediaSize(game);
+
+	switch (format) {
+		case OutputHuman:
+			outPrintf(out, "0x%012llx  %-8s %-6s %6zu bytes%s  %d/%d blocks valid  %s\n", (unsigned long long)offset,
+			          getGameName(game), order, length, truncated ? " (truncated)" : "", valid, present,
+			          path ? path : "-");
+			break;
+		case OutputJson:
+			outPrintf(out, "{\"offset\":%llu,\"game\":\"%s\",\"endian\":\"%s\",\"size\":%zu,\"truncated\":%s,"
+			          "\"blocks\":%d,\"valid\":%d,\"path\":", (unsigned long long)offset, getGameName(game), order,
+			          length, truncated ? "true" : "false", present, valid);
+			if (path) {
+				outPutString(out, format, path, strlen(path));
+			} else {
+				outPuts(out, "null");
+			}
+			outPuts(out, "}\n");
+			break;
+		case OutputCsv:
+			outPrintf(out, "%llu,%s,%s,%zu,%d,%d,", (unsigned long long)offset, getGameName(game), order, length,
+			          present, valid);
+			if (path) {
+				outPutString(out, format, path, strlen(path));
+			}
+			outPutc(out, '\n');
+			break;
+	}
+}
+
+// Finds saves embedded at any offset of a raw dump (an SD card image, an emulator state bundle,
+// a damaged copy) and writes each one that checks out to dir, named after its offset. Without
+// a directory the saves are only listed.
+int
+runCarve(int argc, char* argv[])
+{
+	static const char* extensions[] = { "sra", "fla", "eep" };
+	// The Zelda magic is the Ocarina header ID, or the file magic of either game. The Mario
+	// magic ends both copies of the menu data.
+	static const CarveStart zeldaStarts[CARVE_STARTS] = {
+		{ 7, Ocarina }, { MAGIC_OFFSET_MM, Majora }, { MAGIC_OFFSET_OOT, Ocarina },
+	};
+	static const CarveStart marioStarts[CARVE_STARTS] = {
+		{ 0x1FC, Mario }, { 0x1DC, Mario },
+	};
+	const char* input = NULL;
+	const char* destination = NULL;
+	OutputFormat format = OutputHuman;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			if (parseOutputFormat(argv[++i], &format) != 0) {
+				return 2;
+			}
+		} else if (!input) {
+			input = argv[i];
+		} else if (!destination) {
+			destination = argv[i];
+		} else {
+			fprintf(stderr, "Too many arguments provided.\n");
+			return 2;
+		}
+	}
+	if (!input) {
+		fprintf(stderr, "Usage: %s --carve <dump> [dir] [--format human|json|csv]\n", argv[0]);
+		return 2;
+	}
+
+	MappedFile dump;
+	if (mapFile(input, &dump) != 0) {
+		fprintf(stderr, "Couldn't open %s\n", input);
+		return 2;
+	}
+#ifndef _WIN32
+	// read once front to back: let the kernel read ahead and drop the pages behind
+	madvise((void*)dump.data, dump.size, MADV_SEQUENTIAL);
+#endif
+	if (destination && makeDirectory(destination) != 0) {
+		fprintf(stderr, "Couldn't create %s\n", destination);
+		unmapFile(&dump);
+		return 2;
+	}
+
+	uint8_t* scratch = malloc(getMediaSize(Majora));
+	uint32_t* hits = malloc(CARVE_MAX_HITS * sizeof(uint32_t));
+	if (!scratch || !hits) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		free(scratch);
+		free(hits);
+		unmapFile(&dump);
+		return 2;
+	}
+
+	OutBuf out = { 0 };
+	size_t candidates = 0, carved = 0, errors = 0;
+	uint64_t next = 0;              // end of the last save carved, the magic inside it is its own
+	size_t position = 0;
+	double start = getTimeSeconds();
+
+	if (format == OutputCsv) {
+		outPuts(&out, "offset,game,endian,size,blocks,valid,path\n");
+	}
+	while (position + sizeof(uint32_t) <= dump.size) {
+		size_t len = dump.size - position;
+		size_t end = 0;
+		if (len > CARVE_CHUNK + 3) {
+			len = CARVE_CHUNK + 3;
+		}
+		size_t count = findMagic(dump.data + position, len, hits, CARVE_MAX_HITS, &end);
+
+		for (size_t h = 0; h < count; h++) {
+			uint64_t at = (uint64_t)position + hits[h];
+			const CarveStart* starts = readLE32(dump.data + at) == MAGIC_MARIO ? marioStarts : zeldaStarts;
+			SaveReport reports[2];
+			int spare = 0;          // the report the next candidate is checked into
+			int bestValid = 0;
+			uint64_t bestOffset = 0;
+			size_t bestLength = 0;
+			Endian bestEndian = BigE;
+			Game bestGame = Ocarina;
+
+			if (at < next) {
+				continue;
+			}
+			candidates++;
+			// every way the magic can sit in a save is tried, and the one with the most valid blocks wins
+			for (size_t s = 0; s < CARVE_STARTS && starts[s].back; s++) {
+				if (at < starts[s].back || at - starts[s].back < next) {
+					continue;
+				}
+				size_t length = 0;
+				Endian endian = BigE;
+				int valid = verifyCarveCandidate(&dump, at - starts[s].back, starts[s].game, scratch,
+				                                 &reports[spare], &length, &endian);
+				if (valid > bestValid) {
+					bestValid = valid;
+					bestOffset = at - starts[s].back;
+					bestLength = length;
+					bestEndian = endian;
+					bestGame = starts[s].game;
+					spare ^= 1;
+				}
+			}
+			if (!bestValid) {
+				continue;
+			}
+
+			char path[4096];
+			const char* written = NULL;
+			if (destination) {
+				snprintf(path, sizeof(path), "%s/%012llx.%s", destination, (unsigned long long)bestOffset,
+				         extensions[bestGame]);
+				if (writeFileAtomic(path, dump.data + bestOffset, bestLength) == 0) {
+					written = path;
+				} else {
+					errors++;
+				}
+			}
+			renderCarved(&out, format, bestOffset, bestGame, bestEndian, bestLength, &reports[spare ^ 1], written);
+			carved++;
+			next = bestOffset + bestLength;
+		}
+		if (out.len >= 0x10000) {
+			outFlush(&out, stdout);
+		}
+		position += end;
+	}
+	outFlush(&out, stdout);
+	outFree(&out);
+
+	double elapsed = getTimeSeconds() - start;
+	fprintf(stderr, "Carved %zu saves from %zu candidates in %.1f MB (%zu not written)\n", carved, candidates,
+	        (double)dump.size / 1e6, errors);
+	fprintf(stderr, "%.3f s: %.1f MB/s\n", elapsed, elapsed > 0.0 ? (double)dump.size / elapsed / 1e6 : 0.0);
+	free(scratch);
+	free(hits);
+	unmapFile(&dump);
+	return errors ? 2 : carved ? 0 : 1;
+}
+
+// Controller Pak note names use the N64 font: space, digits, capitals and a little punctuation,
+// then kana that read as '?'. 0x00 pads the name like the space does.
+static const char pakGlyphs[257] =
+	" ?????????????? " "0123456789ABCDEF" "GHIJKLMNOPQRSTUV" "WXYZ!\"#'*+,-./:="
+	"?@??????????????" "????????????????" "????????????????" "????????????????"
+	"????????????????" "????????????????" "????????????????" "????????????????"
+	"????????????????" "????????????????" "????????????????" "????????????????";
+
+// game codes and publishers are ASCII
+static void
+decodePakCode(const uint8_t* raw, size_t len, char* text)
+{
+	for (size_t i = 0; i < len; i++) {
+		text[i] = raw[i] >= 0x20 && raw[i] < 0x7F ? (char)raw[i] : '?';
+	}
+	text[len] = '\0';
+}
+
+// An ID block is valid when its 14 big endian halfwords sum to the halfword after them,
+// and the next one is 0xFFF2 minus that sum
+static int
+checkMpkIdBlock(const uint8_t* block)
+{
+	uint16_t sum = 0;
+
+	for (int i = 0; i < 0x1C; i += 2) {
+		sum = (uint16_t)(sum + (block[i] << 8 | block[i + 1]));
+	}
+	return (uint16_t)(block[0x1C] << 8 | block[0x1D]) == sum
+	    && (uint16_t)(block[0x1E] << 8 | block[0x1F]) == (uint16_t)(0xFFF2 - sum);
+}
+
+// The second byte of an inode page is the low byte of the sum of its data page entries
+static int
+checkMpkInodes(const uint8_t* page)
+{
+	uint8_t sum = 0;
+
+	for (int i = MPK_FIRST_PAGE * 2; i < MPK_PAGE_SIZE; i++) {
+		sum = (uint8_t)(sum + page[i]);
+	}
+	return page[1] == sum;
+}
+
+// Decodes the ID area, the inode table and the note table from the first MPK_INDEX_SIZE bytes
+// of a pak. The index is filled in any case; returns 0 when at least one ID block checks out.
+int
+parseMpkIndex(const uint8_t* data, MpkIndex* index)
+{
+	static const uint16_t idBlocks[4] = { 0x20, 0x60, 0x80, 0xC0 };
+	const uint8_t* inodes = data + MPK_PAGE_SIZE;
+
+	memset(index, 0, sizeof(*index));
+	for (int i = 0; i < 4; i++) {
+		index->idBlocks += checkMpkIdBlock(data + idBlocks[i]);
+	}
+
+	// the backup is used only when the primary table is corrupt, the way the console does
+	if (checkMpkInodes(inodes)) {
+		index->inodeCopy = 1;
+	} else if (checkMpkInodes(inodes + MPK_PAGE_SIZE)) {
+		index->inodeCopy = 2;
+		inodes += MPK_PAGE_SIZE;
+	}
+	for (int page = MPK_FIRST_PAGE; page < MPK_PAGES; page++) {
+		uint8_t bank = inodes[page * 2];
+		uint8_t next = inodes[page * 2 + 1];
+		index->next[page] = bank == 0 && next < MPK_PAGES ? next : 0;
+		index->freePages += index->next[page] == MPK_FREE_PAGE;
+	}
+
+	for (int i = 0; i < MPK_NOTES; i++) {
+		const uint8_t* entry = data + 3 * MPK_PAGE_SIZE + i * 32;
+		uint16_t start = (uint16_t)(entry[0x06] << 8 | entry[0x07]);
+		if (readLE32(entry) == 0 || start < MPK_FIRST_PAGE || start >= MPK_PAGES) {
+			continue;
+		}
+
+		MpkNote* note = &index->notes[index->noteCount++];
+		note->entry = (uint8_t)i;
+		note->startPage = (uint8_t)start;
+		decodePakCode(entry, 4, note->gameCode);
+		decodePakCode(entry + 0x04, 2, note->publisher);
+
+		size_t len = 0;
+		for (int c = 0; c < 16; c++) {
+			note->name[c] = pakGlyphs[entry[0x10 + c]];
+			if (note->name[c] != ' ') {
+				len = c + 1;
+			}
+		}
+		if (entry[0x0C] != 0) {
+			note->name[len++] = '.';
+			for (int c = 0; c < 4 && entry[0x0C + c] != 0; c++) {
+				note->name[len++] = pakGlyphs[entry[0x0C + c]];
+			}
+		}
+		note->name[len] = '\0';
+
+		// a chain can't be longer than the data pages, so a longer one loops
+		int page = start;
+		for (;;) {
+			note->pages++;
+			int next = index->next[page];
+			if (next == MPK_CHAIN_END) {
+				note->chainOK = index->inodeCopy != 0;
+				break;
+			}
+			if (next < MPK_FIRST_PAGE || note->pages == MPK_PAGES - MPK_FIRST_PAGE) {
+				break;
+			}
+			page = next;
+		}
+	}
+	return index->idBlocks ? 0 : -1;
+}
+
+// Reads the index pages of a pak, and nothing else
+LoadStatus
+readMpkIndex(const char* path, MpkIndex* index)
+{
+	uint8_t data[MPK_INDEX_SIZE];
+
+	FILE* fp = fopen(path, "rb");
+	if (!fp) {
+		return LoadOpenFailed;
+	}
+	// unbuffered, so the read stops at the note table instead of filling a stdio buffer
+	setvbuf(fp, NULL, _IONBF, 0);
+	size_t got = fread(data, 1, sizeof(data), fp);
+	fclose(fp);
+	if (got < sizeof(data)) {
+		return LoadTooShort;
+	}
+	return parseMpkIndex(data, index) == 0 ? LoadOK : LoadUnknownGame;
+}
+
+// Reads the pages of one note in chain order into payload, which needs room for MPK_SIZE
+// bytes. Returns the note's size, 0 when its chain is broken or a page can't be read.
+size_t
+loadMpkNote(const char* path, const MpkIndex* index, int note, uint8_t* payload)
+{
+	const MpkNote* entry = &index->notes[note];
+	size_t size = 0;
+
+	if (!entry->chainOK) {
+		return 0;
+	}
+	FILE* fp = fopen(path, "rb");
+	if (!fp) {
+		return 0;
+	}
+	for (int page = entry->startPage; page != MPK_CHAIN_END; page = index->next[page]) {
+		if (fseek(fp, (long)page * MPK_PAGE_SIZE, SEEK_SET) != 0
+		    || fread(payload + size, 1, MPK_PAGE_SIZE, fp) != MPK_PAGE_SIZE) {
+			fclose(fp);
+			return 0;
+		}
+		size += MPK_PAGE_SIZE;
+	}
+	fclose(fp);
+	return size;
+}
+
+static const char*
+getInodeStatus(const MpkIndex* index)
+{
+	switch (index->inodeCopy) {
+		case 1:  return "primary";
+		case 2:  return "backup";
+		default: return "corrupt";
+	}
+}
+
+static void
+renderMpkIndex(OutBuf* out, OutputFormat format, const char* path, const MpkIndex* index)
+{
+	size_t pathLen = strlen(path);
+
+	switch (format) {
+		case OutputHuman:
+			outPrintf(out, "%s\tID %d/4\tinodes %s%s%s\t%d notes\t%d pages free\n", path, index->idBlocks,
+			          index->inodeCopy == 1 ? "" : ANSI_BG_RED ANSI_COLOR_WHITE, getInodeStatus(index),
+			          index->inodeCopy == 1 ? "" : ANSI_COLOR_RESET, index->noteCount, index->freePages);
+			for (int i = 0; i < index->noteCount; i++) {
+				const MpkNote* note = &index->notes[i];
+				outPrintf(out, "%s\t%2d\t%s\t%s\t%-21s\t%3d pages\t%s%s" ANSI_COLOR_RESET "\n", path, note->entry,
+				          note->gameCode, note->publisher, note->name, note->pages,
+				          note->chainOK ? ANSI_BG_GREEN ANSI_COLOR_WHITE : ANSI_BG_RED ANSI_COLOR_WHITE,
+				          note->chainOK ? "OK" : "BROKEN");
+			}
+			break;
+		case OutputJson:
+			outPuts(out, "{\"path\":");
+			outPutString(out, format, path, pathLen);
+			outPrintf(out, ",\"idBlocks\":%d,\"inodes\":\"%s\",\"freePages\":%d,\"notes\":[", index->idBlocks,
+			          getInodeStatus(index), index->freePages);
+			for (int i = 0; i < index->noteCount; i++) {
+				const MpkNote* note = &index->notes[i];
+				outPrintf(out, "%s{\"note\":%d,\"game\":", i ? "," : "", note->entry);
+				outPutString(out, format, note->gameCode, strlen(note->gameCode));
+				outPuts(out, ",\"publisher\":");
+				outPutString(out, format, note->publisher, strlen(note->publisher));
+				outPuts(out, ",\"name\":");
+				outPutString(out, format, note->name, strlen(note->name));
+				outPrintf(out, ",\"startPage\":%d,\"pages\":%d,\"chain\":\"%s\"}", note->startPage, note->pages,
+				          note->chainOK ? "OK" : "BROKEN");
+			}
+			outPuts(out, "]}\n");
+			break;
+		case OutputCsv:
+			// one row per note, and one without a note for an empty pak
+			for (int i = 0; i < index->noteCount || (i == 0 && index->noteCount == 0); i++) {
+				const MpkNote* note = i < index->noteCount ? &index->notes[i] : NULL;
+				outPutString(out, format, path, pathLen);
+				outPrintf(out, ",%d,%s,%d,", index->idBlocks, getInodeStatus(index), index->freePages);
+				if (note) {
+					outPrintf(out, "%d,", note->entry);
+					outPutString(out, format, note->gameCode, strlen(note->gameCode));
+					outPutc(out, ',');
+					outPutString(out, format, note->publisher, strlen(note->publisher));
+					outPutc(out, ',');
+					outPutString(out, format, note->name, strlen(note->name));
+					outPrintf(out, ",%d,%s", note->pages, note->chainOK ? "OK" : "BROKEN");
+				} else {
+					outPuts(out, ",,,,,");
+				}
+				outPutc(out, '\n');
+			}
+			break;
+	}
+}
+
+// a file that isn't a readable pak, in the columns of the pak records; the error takes
+// the place of the inode status
+static void
+renderMpkError(OutBuf* out, OutputFormat format, const char* path, const char* error)
+{
+	switch (format) {
+		case OutputHuman:
+			outPrintf(out, "%s\t" ANSI_BG_RED ANSI_COLOR_WHITE "%s" ANSI_COLOR_RESET "\n", path, error);
+			break;
+		case OutputJson:
+			outPuts(out, "{\"path\":");
+			outPutString(out, format, path, strlen(path));
+			outPrintf(out, ",\"error\":\"%s\"}\n", error);
+			break;
+		case OutputCsv:
+			outPutString(out, format, path, strlen(path));
+			outPrintf(out, ",,%s,,,,,,,\n", error);
+			break;
+	}
+}
+
+// Thread of the pak lister: one read of the index pages per pak
+typedef struct {
+	ThreadHandle  thread;
+	ScanQueue*    queue;
+	OutBuf        out;
+	size_t        paks;
+	size_t        notes;
+	size_t        errors;           // files that aren't readable paks
+	size_t        damaged;          // paks with a corrupt inode table or a broken chain
+} MpkWorker;
+
+THREAD_FUNC(mpkThread)
+{
+	MpkWorker* worker = (MpkWorker*)arg;
+	ScanQueue* queue = worker->queue;
+
+	for (;;) {
+		long index = atomicFetchAdd(&queue->next, 1);
+		if (index < 0 || (size_t)index >= queue->count) {
+			break;
+		}
+		const char* path = queue->paths[index];
+		MpkIndex pak;
+
+		LoadStatus status = readMpkIndex(path, &pak);
+		if (status != LoadOK) {
+			renderMpkError(&worker->out, queue->format, path, status == LoadUnknownGame ? "NOT A PAK" : "UNREADABLE");
+			worker->errors++;
+		} else {
+			int damaged = pak.inodeCopy == 0;
+			for (int i = 0; i < pak.noteCount; i++) {
+				damaged |= !pak.notes[i].chainOK;
+			}
+			renderMpkIndex(&worker->out, queue->format, path, &pak);
+			worker->paks++;
+			worker->notes += pak.noteCount;
+			worker->damaged += damaged;
+		}
+		// one write per pak keeps the records of different threads apart
+		outFlush(&worker->out, stdout);
+	}
+	THREAD_RETURN;
+}
+
+// Shows one note of a pak. A note holding the image of a supported game's save is checked like
+// any other save; otherwise only its size is shown. --extract writes the note's pages as they are.
+static int
+showMpkNote(const char* path, int entry, const char* extract, OutputFormat format)
+{
+	MpkIndex index;
+	LoadStatus status = readMpkIndex(path, &index);
+	if (status != LoadOK) {
+		fprintf(stderr, "%s: %s\n", path, status == LoadUnknownGame ? "Not a Controller Pak" : getLoadError(status));
+		return 2;
+	}
+	int note = 0;
+	while (note < index.noteCount && index.notes[note].entry != entry) {
+		note++;
+	}
+	if (note == index.noteCount) {
+		fprintf(stderr, "%s: note %d is empty.\n", path, entry);
+		return 1;
+	}
+
+	uint8_t* payload = malloc(MPK_SIZE);
+	if (!payload) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		return 2;
+	}
+	size_t size = loadMpkNote(path, &index, note, payload);
+	if (size == 0) {
+		fprintf(stderr, "%s: the pages of note %d can't be read, its inode chain is broken.\n", path, entry);
+		free(payload);
+		return 2;
+	}
+	if (extract && writeFileAtomic(extract, payload, size) != 0) {
+		fprintf(stderr, "Couldn't write %s\n", extract);
+		free(payload);
+		return 2;
+	}
+
+	char name[4096];
+	snprintf(name, sizeof(name), "%s:%d", path, entry);
+	OutBuf out = { 0 };
+	SaveImage image;
+	SaveReport report;
+	int result = 0;
+	if (parseSaveData(payload, size, name, &image) == LoadOK) {
+		int count = checkSaveData(&image, 1, &report);
+		for (int i = 0; i < count; i++) {
+			result |= report.checks[i].present && report.checks[i].stored != report.checks[i].actual;
+		}
+		renderRecord(&out, format, &image, report.checks, count, NULL, 0, report.pairs, report.pairCount);
+	} else {
+		const MpkNote* found = &index.notes[note];
+		switch (format) {
+			case OutputHuman:
+				outPrintf(&out, "%s\t%s\t%s\t%s\t%zu bytes\n", name, found->gameCode, found->publisher, found->name, size);
+				break;
+			case OutputJson:
+				outPuts(&out, "{\"path\":");
+				outPutString(&out, format, name, strlen(name));
+				outPuts(&out, ",\"game\":");
+				outPutString(&out, format, found->gameCode, strlen(found->gameCode));
+				outPuts(&out, ",\"publisher\":");
+				outPutString(&out, format, found->publisher, strlen(found->publisher));
+				outPuts(&out, ",\"name\":");
+				outPutString(&out, format, found->name, strlen(found->name));
+				outPrintf(&out, ",\"size\":%zu}\n", size);
+				break;
+			case OutputCsv:
+				outPutString(&out, format, name, strlen(name));
+				outPutc(&out, ',');
+				outPutString(&out, format, found->gameCode, strlen(found->gameCode));
+				outPutc(&out, ',');
+				outPutString(&out, format, found->publisher, strlen(found->publisher));
+				outPutc(&out, ',');
+				outPutString(&out, format, found->name, strlen(found->name));
+				outPrintf(&out, ",%zu\n", size);
+				break;
+		}
+	}
+	outFlush(&out, stdout);
+	outFree(&out);
+	free(payload);
+	return result ? 2 : 0;
+}
+
+// Lists the notes of every Controller Pak dump (.mpk) under a directory or listed in a file.
+// Only the index pages are read, so a large library lists at the speed of one small read per
+// pak; the notes themselves are read one at a time with --note.
+int
+runMpk(int argc, char* argv[])
+{
+	const char* root = NULL;
+	const char* extract = NULL;
+	int entry = -1;
+	int jobs = getCpuCount() * 2;
+	OutputFormat format = OutputHuman;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			if (parseOutputFormat(argv[++i], &format) != 0) {
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--note") == 0 && i + 1 < argc) {
+			entry = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--extract") == 0 && i + 1 < argc) {
+			extract = argv[++i];
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			jobs = atoi(argv[++i]);
+		} else if (!root) {
+			root = argv[i];
+		} else {
+			fprintf(stderr, "Too many arguments provided.\n");
+			return 2;
+		}
+	}
+	if (!root || (extract && entry < 0) || entry >= MPK_NOTES) {
+		fprintf(stderr, "Usage: %s --mpk <pak|dir|list> [--note N [--extract file]] [--jobs N]"
+		                " [--format human|json|csv]\n", argv[0]);
+		return 2;
+	}
+	if (entry >= 0) {
+		return showMpkNote(root, entry, extract, format);
+	}
+	if (jobs < 1) jobs = 1;
+	if (jobs > SCAN_MAX_THREADS) jobs = SCAN_MAX_THREADS;
+
+	ScanQueue queue = { 0 };
+	queue.paks = 1;
+	queue.format = format;
+	if (collectSaveFiles(root, &queue) != 0) {
+		return 2;
+	}
+	if ((size_t)jobs > queue.count) {
+		jobs = queue.count ? (int)queue.count : 1;
+	}
+	if (format == OutputCsv) {
+		fputs("path,idBlocks,inodes,freePages,note,game,publisher,name,pages,chain\n", stdout);
+	}
+
+	MpkWorker workers[SCAN_MAX_THREADS];
+	memset(workers, 0, sizeof(workers));
+	double start = getTimeSeconds();
+	for (int i = 0; i < jobs; i++) {
+		workers[i].queue = &queue;
+#ifdef _WIN32
+		workers[i].thread = CreateThread(NULL, 0, mpkThread, &workers[i], 0, NULL);
+#else
+		pthread_create(&workers[i].thread, NULL, mpkThread, &workers[i]);
+#endif
+	}
+
+	MpkWorker total = { 0 };
+	for (int i = 0; i < jobs; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(workers[i].thread, INFINITE);
+		CloseHandle(workers[i].thread);
+#else
+		pthread_join(workers[i].thread, NULL);
+#endif
+		total.paks    += workers[i].paks;
+		total.notes   += workers[i].notes;
+		total.errors  += workers[i].errors;
+		total.damaged += workers[i].damaged;
+		outFree(&workers[i].out);
+	}
+	double elapsed = getTimeSeconds() - start;
+
+	fprintf(stderr, "Listed %zu notes in %zu paks (%zu damaged, %zu not paks or unreadable)\n", total.notes,
+	        total.paks, total.damaged, total.errors);
+	fprintf(stderr, "%.3f s with %d threads: %.1f paks/sec\n", elapsed, jobs,
+	        elapsed > 0.0 ? (double)(total.paks + total.errors) / elapsed : 0.0);
+	releaseQueue(&queue);
+	return total.errors || total.damaged ? 2 : 0;
+}
+
+// Thread of the rule checker: every valid slot of its files goes through its game's program
+typedef struct {
+	ThreadHandle  thread;
+	ScanQueue*    queue;
+	const RuleProgram* programs;    // one per game, shared and read-only
+	OutBuf        out;
+	SaveArena     arena;
+	size_t        files;
+	size_t        errors;
+	size_t        slots;            // slots with a valid checksum run through the rules
+	size_t        broken;           // slots breaking at least one rule
+	size_t        violations;
+	size_t        counts[3][RULE_MAX_RULES];   // slots breaking each rule
+} LintWorker;
+
+static const char*
+getRuleKind(RuleKind kind)
+{
+	switch (kind) {
+		case RuleAtMost:  return "atMost";
+		case RuleAtLeast: return "atLeast";
+		case RuleBits:    return "bits";
+	}
+	return "unknown";
+}
+
+// Renders the steps of the rules a slot breaks, with the values that break them. This runs
+// only for the few slots the program flags, so it reads the fields the plain way.
+static size_t
+renderViolations(OutBuf* out, OutputFormat format, const char* path, Game game, const char* slot,
+                 const RuleProgram* program, const uint8_t* block, uint64_t broken)
+{
+	size_t pathLen = strlen(path);
+	size_t count = 0;
+
+	for (int i = 0; i < program->stepCount; i++) {
+		const RuleStep* step = &program->steps[i];
+		if (!(broken >> step->rule & 1)) {
+			continue;
+		}
+		int64_t other = loadOperand(&step->b, block);
+		if (step->factor * loadOperand(&step->a, block) + step->otherFactor * other + step->bias <= 0) {
+			continue;
+		}
+		const SaveRule* rule = program->sources[i];
+		const SaveField* field = program->fields[i][0];
+		int64_t value = readField(block + field->offset, field->width, field->endian);
+		if (field->format == FormatSigned) {
+			int shift = 64 - field->width * 8;
+			value = (int64_t)((uint64_t)value << shift) >> shift;
+		}
+		int64_t limit = rule->kind == RuleBits ? (int64_t)rule->mask
+		              : (program->fields[i][1] ? rule->scale * other : 0) + rule->limit;
+		const char* otherName = program->fields[i][1] ? program->fields[i][1]->name : NULL;
+
+		switch (format) {
+			case OutputHuman:
+				outPrintf(out, "%s\t%s\t%s\t" ANSI_BG_RED ANSI_COLOR_WHITE "%s" ANSI_COLOR_RESET "\t", path,
+				          getGameName(game), slot, rule->name);
+				if (rule->kind == RuleBits) {
+					outPrintf(out, "%s=0x%08llx has bits outside 0x%08llx\n", field->name, (unsigned long long)value,
+					          (unsigned long long)limit);
+				} else {
+					outPrintf(out, "%s=%lld %s %lld%s%s%s\n", field->name, (long long)value,
+					          rule->kind == RuleAtMost ? ">" : "<", (long long)limit, otherName ? " (from " : "",
+					          otherName ? otherName : "", otherName ? ")" : "");
+				}
+				break;
+			case OutputJson:
+				outPuts(out, "{\"path\":");
+				outPutString(out, format, path, pathLen);
+				outPrintf(out, ",\"game\":\"%s\",\"slot\":\"%s\",\"rule\":\"%s\",\"kind\":\"%s\",\"field\":\"%s\","
+				          "\"value\":%lld,\"limit\":%lld,\"other\":", getGameName(game), slot, rule->name,
+				          getRuleKind(rule->kind), field->name, (long long)value, (long long)limit);
+				if (otherName) {
+					outPrintf(out, "\"%s\"}\n", otherName);
+				} else {
+					outPuts(out, "null}\n");
+				}
+				break;
+			case OutputCsv:
+				outPutString(out, format, path, pathLen);
+				outPrintf(out, ",%s,%s,%s,%s,%s,%lld,%lld,%s\n", getGameName(game), slot, rule->name,
+				          getRuleKind(rule->kind), field->name, (long long)value, (long long)limit,
+				          otherName ? otherName : "");
+				break;
+		}
+		count++;
+	}
+	return count;
+}
+
+// a file the rules couldn't be run on, in the columns of the violation records. It has no
+// rule, so the error takes the place of the rule's kind.
+static void
+renderLintError(OutBuf* out, OutputFormat format, const char* path, const char* error)
+{
+	switch (format) {
+		case OutputHuman:
+			outPrintf(out, "%s\t-\t-\t" ANSI_BG_RED ANSI_COLOR_WHITE "%s" ANSI_COLOR_RESET "\n", path, error);
+			break;
+		case OutputJson:
+			outPuts(out, "{\"path\":");
+			outPutString(out, format, path, strlen(path));
+			outPrintf(out, ",\"error\":\"%s\"}\n", error);
+			break;
+		case OutputCsv:
+			outPutString(out, format, path, strlen(path));
+			outPrintf(out, ",,,,%s,,,,\n", error);
+			break;
+	}
+}
+
+THREAD_FUNC(lintThread)
+{
+	LintWorker* worker = (LintWorker*)arg;
+	ScanQueue* queue = worker->queue;
+	SlotCheck checks[MAX_SLOT_BLOCKS];
+
+	for (;;) {
+		long index = atomicFetchAdd(&queue->next, 1);
+		if (index < 0 || (size_t)index >= queue->count) {
+			break;
+		}
+		const char* path = queue->paths[index];
+		SaveImage image;
+
+		arenaReset(&worker->arena);
+		LoadStatus status = loadQueuedSave(queue, (size_t)index, &worker->arena, &image);
+		if (status != LoadOK) {
+			renderLintError(&worker->out, queue->format, path, status == LoadUnknownGame ? "UNKNOWN" : "UNREADABLE");
+			outFlush(&worker->out, stdout);
+			worker->errors++;
+			continue;
+		}
+		worker->files++;
+
+		// slots that fail their checksum are reported by --scan, the rules only look at the others
+		Game game = image.info.game;
+		const RuleProgram* program = &worker->programs[game];
+		int count = verifyImage(image.data, image.size, game, checks);
+		for (int i = 0; i < count; i++) {
+			const SlotCheck* check = &checks[i];
+			if (!check->present || !check->layout->hasFields || check->stored != check->actual) {
+				continue;
+			}
+			const uint8_t* block = image.data + check->layout->offset;
+			uint64_t broken = evaluateRules(program, block);
+			worker->slots++;
+			if (!broken) {
+				continue;
+			}
+			worker->broken++;
+			worker->violations += renderViolations(&worker->out, queue->format, path, game, check->layout->name,
+			                                       program, block, broken);
+			for (int r = 0; r < program->ruleCount; r++) {
+				worker->counts[game][r] += broken >> r & 1;
+			}
+		}
+		freeSaveData(&image);
+		// one write per file keeps the records of different threads apart
+		outFlush(&worker->out, stdout);
+	}
+	THREAD_RETURN;
+}
+
+// Runs each game's consistency rules over every valid slot of a corpus. The images are decoded
+// once, as for --scan, and the rules are a compiled list of loads and compares on each slot.
+int
+runLint(int argc, char* argv[])
+{
+	const char* root = NULL;
+	const char* selection = NULL;
+	int jobs = getCpuCount() * 2;
+	OutputFormat format = OutputHuman;
+
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+			selection = argv[++i];
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			jobs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			if (parseOutputFormat(argv[++i], &format) != 0) {
+				return 1;
+			}
+		} else if (!root) {
+			root = argv[i];
+		} else {
+			fprintf(stderr, "Too many arguments provided.\n");
+			return 1;
+		}
+	}
+	if (!root) {
+		fprintf(stderr, "Usage: %s --lint <dir|list|pack> [--rules rule,rule...] [--jobs N]"
+		                " [--format human|json|csv]\n", argv[0]);
+		return 1;
+	}
+	if (jobs < 1) jobs = 1;
+	if (jobs > SCAN_MAX_THREADS) jobs = SCAN_MAX_THREADS;
+
+	// every name selected has to be a rule of at least one game
+	for (const char* name = selection; name && *name; ) {
+		size_t len = strcspn(name, ",");
+		int found = 0;
+		for (Game game = Ocarina; game <= Mario && !found && len > 0; game++) {
+			size_t count = 0;
+			const SaveRule* rules = getRuleTable(game, &count);
+			for (size_t r = 0; r < count && !found; r++) {
+				found = strlen(rules[r].name) == len && strncmp(rules[r].name, name, len) == 0;
+			}
+		}
+		if (len > 0 && !found) {
+			fprintf(stderr, "Unknown rule: %.*s\n", (int)len, name);
+			return 1;
+		}
+		name += len;
+		if (*name == ',') {
+			name++;
+		}
+	}
+
+	static RuleProgram programs[3];
+	int steps = 0;
+	for (Game game = Ocarina; game <= Mario; game++) {
+		int count = compileRules(game, selection, &programs[game]);
+		if (count < 0) {
+			return 1;
+		}
+		steps += count;
+	}
+
+	ScanQueue queue = { 0 };
+	queue.format = format;
+	if (collectSaveFiles(root, &queue) != 0) {
+		return 1;
+	}
+	if ((size_t)jobs > queue.count) {
+		jobs = queue.count ? (int)queue.count : 1;
+	}
+	if (format == OutputCsv) {
+		fputs("path,game,slot,rule,kind,field,value,limit,other\n", stdout);
+	}
+
+	LintWorker* workers = calloc((size_t)jobs, sizeof(LintWorker));
+	if (!workers) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		releaseQueue(&queue);
+		return 1;
+	}
+	double start = getTimeSeconds();
+	for (int i = 0; i < jobs; i++) {
+		workers[i].queue = &queue;
+		workers[i].programs = programs;
+		arenaInit(&workers[i].arena, malloc(SAVE_MAP_THRESHOLD), SAVE_MAP_THRESHOLD);
+#ifdef _WIN32
+		workers[i].thread = CreateThread(NULL, 0, lintThread, &workers[i], 0, NULL);
+#else
+		pthread_create(&workers[i].thread, NULL, lintThread, &workers[i]);
+#endif
+	}
+
+	LintWorker total = { 0 };
+	for (int i = 0; i < jobs; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(workers[i].thread, INFINITE);
+		CloseHandle(workers[i].thread);
+#else
+		pthread_join(workers[i].thread, NULL);
+#endif
+		total.files      += workers[i].files;
+		total.errors     += workers[i].errors;
+		total.slots      += workers[i].slots;
+		total.broken     += workers[i].broken;
+		total.violations += workers[i].violations;
+		for (Game game = Ocarina; game <= Mario; game++) {
+			for (int r = 0; r < programs[game].ruleCount; r++) {
+				total.counts[game][r] += workers[i].counts[game][r];
+			}
+		}
+		outFree(&workers[i].out);
+		free(workers[i].arena.base);
+	}
+	double elapsed = getTimeSeconds() - start;
+
+	fprintf(stderr, "Checked %zu slots of %zu files (%zu unreadable) against %d rule steps: %zu violations"
+	                " in %zu slots\n", total.slots, total.files + total.errors, total.errors, steps,
+	        total.violations, total.broken);
+	for (Game game = Ocarina; game <= Mario; game++) {
+		for (int r = 0; r < programs[game].ruleCount; r++) {
+			if (total.counts[game][r]) {
+				fprintf(stderr, "    %-8s %-24s %zu slots\n", getGameName(game), programs[game].names[r],
+				        total.counts[game][r]);
+			}
+		}
+	}
+	fprintf(stderr, "%.3f s with %d threads: %.1f files/sec\n", elapsed, jobs,
+	        elapsed > 0.0 ? (double)(total.files + total.errors) / elapsed : 0.0);
+	free(workers);
+	releaseQueue(&queue);
+	return total.errors || total.violations ? 2 : 0;
 }
@@ -0,0 +1,78 @@
+#!/bin/sh
+# Golden checks over a generated corpus: tests/run.sh [path/to/save64]
+# Every check compares two runs of the program, so no expected output is stored.
+
+SAVE64=${1:-./save64}
+case $SAVE64 in
+	/*) ;;
+	*) SAVE64=$(pwd)/$SAVE64 ;;
+esac
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+failed=0
+
+fail() {
+	echo "FAIL: $*"
+	failed=1
+}
+
+# scan records in a stable order, threads and the cache finish files in any order
+scan() {
+	"$SAVE64" --scan "$@" 2>"$WORK/summary" | sort
+}
+
+cd "$WORK" || exit 1
+"$SAVE64" --gen corpus --count 300 --seed 64 >/dev/null 2>&1 || { echo "FAIL: --gen"; exit 1; }
+
+# --scan: the same records with and without --jobs, and with --cache cold and warm. The
+# cache is only used without --fields, it keeps no field values.
+for format in csv json; do
+	scan corpus --format "$format" --fields rupees,,currentHealth,capLevel >plain.$format
+	grep -q " 0 checksum failures" summary || fail "--scan reports checksum failures in the generated corpus"
+	scan corpus --format "$format" --fields rupees,,currentHealth,capLevel --jobs 4 >jobs.$format
+	cmp -s plain.$format jobs.$format || fail "--scan --jobs 4 --format $format differs"
+
+	scan corpus --format "$format" >plain.$format
+	rm -f scan.cache
+	for pass in cold warm; do
+		scan corpus --format "$format" --jobs 3 --cache scan.cache >$pass.$format
+		cmp -s plain.$format $pass.$format || fail "--scan --cache ($pass) --format $format differs"
+	done
+	grep -q "300 from cache" summary || fail "--scan --cache didn't answer the warm run from the cache"
+done
+
+# --convert: both byte orders from the corpus, then each one back from the other
+"$SAVE64" --convert corpus big --to big >/dev/null 2>&1 || fail "--convert --to big"
+"$SAVE64" --convert corpus little --to little >/dev/null 2>&1 || fail "--convert --to little"
+"$SAVE64" --convert little big2 --to big >/dev/null 2>&1 || fail "--convert little --to big"
+"$SAVE64" --convert big little2 --to little >/dev/null 2>&1 || fail "--convert big --to little"
+diff -r big big2 >/dev/null || fail "--convert doesn't round-trip to big endian"
+diff -r little little2 >/dev/null || fail "--convert doesn't round-trip to little endian"
+
+# --pack and --unpack give back the tree they were given
+"$SAVE64" --pack corpus.pack corpus >/dev/null 2>&1 || fail "--pack"
+"$SAVE64" --unpack corpus.pack unpacked >/dev/null 2>&1 || fail "--unpack"
+diff -r corpus unpacked >/dev/null || fail "--unpack doesn't give back the packed tree"
+scan corpus.pack --format csv >pack.csv
+scan corpus --format csv | sed 's|^"corpus/|"|' >tree.csv
+cmp -s pack.csv tree.csv || fail "--scan of the pack differs from the tree"
+
+# --set keeps the checksums of every game, in both byte orders, and reads back
+for file in $(ls corpus/*/* | grep -E '_(dlez|zeld)\.(sra|fla)$|\.eep$' | sort -t_ -k2 -u); do
+	case $file in
+		*.eep) field=capPos_x value=-5 ;;
+		*)     field=rupees value=123 ;;
+	esac
+	"$SAVE64" "$file" 1 --set "$field=$value" >/dev/null 2>&1 || fail "--set $field=$value on $file"
+	"$SAVE64" "$file" 1 --fields "$field" | grep -q " $value\$" || fail "$file doesn't read back $field=$value"
+done
+scan corpus --format csv >/dev/null
+grep -q " 0 checksum failures" summary || fail "--set left checksum failures behind"
+
+# the SIMD kernels against their scalar versions
+for bench in swap checksum compare hash carve columns; do
+	"$SAVE64" --bench "$bench" --iterations 1 2>&1 >/dev/null | grep "differs" && fail "--bench $bench"
+done
+
+[ $failed -eq 0 ] && echo "All checks passed."
+exit $failed